@@ -311,13 +311,15 @@ bool ConfigurationManager::run()
   try
   {
     const int decimator = 100;
-    ros::Rate lp(decimator);
     size_t cnt = 0;
+    // the loop is woken up by any state transition of the drivers, otherwise it checks the signals at 100Hz
+    uint64_t epoch = cnr_hardware_driver_interface::HwStateChannel::epoch();
+    bool state_changed = true;
     CNR_WARN(m_logger, "********************* RUN ****************************");
     while (ros::ok())
     {
       bool full_check = (((cnt++) % decimator) == 0);
-      if (!isOk())
+      if ((state_changed || full_check) && !isOk())
       {
         CNR_WARN_THROTTLE(m_logger, 2, "\n\nRaised an Error by one of the Hw! Stop Configuration start!\n\n");
         configuration_msgs::StopConfiguration srv;
@@ -349,7 +351,7 @@ bool ConfigurationManager::run()
         }
         break;    // exit normally after SIGINT
       }
-      lp.sleep();
+      state_changed = cnr_hardware_driver_interface::HwStateChannel::waitEpoch(epoch, ros::WallDuration(1.0 / decimator));
     }
   }
   catch (std::exception& e)
@@ -387,6 +389,14 @@ bool ConfigurationManager::isOk( )
                               << "' is " << cnr_hardware_interface::to_string(hw_status));
         return false;
       }
+
+      if(m_conf_loader.getDriver(hw) && m_conf_loader.getDriver(hw)->overrunAlarm())
+      {
+        CNR_FATAL(m_logger, prefix << "The RT loop of the HW '" << hw << "' overran "
+                              << m_conf_loader.getDriver(hw)->overrunPolicy().streak_limit << " consecutive cycles");
+        m_conf_loader.getDriver(hw)->clearOverrunAlarm();
+        return false;
+      }
     }
 
   }
@@ -511,28 +521,16 @@ bool ConfigurationManager::callback(const ConfigurationStruct& next_configuratio
 
   auto check = [&](const std::string& hw_to_load_name) -> bool
   {
-    ros::Rate r(250);
-    ros::Time st=ros::Time::now();
-    while(ros::ok())
+    cnr_hardware_driver_interface::RobotHwDriverInterfacePtr driver = m_conf_loader.getDriver(hw_to_load_name);
+    cnr_hardware_interface::StatusHw reached;
+    if(!driver || !driver->waitForState({cnr_hardware_interface::INITIALIZED, cnr_hardware_interface::RUNNING},
+                                        ros::Duration(4.0), &reached))
     {
-      if(checkRobotHwState(hw_to_load_name, cnr_hardware_interface::INITIALIZED))
-      {
-        CNR_INFO(m_logger, "The '" + hw_to_load_name + "' is INITIALIZED. Good!");
-        return true;
-      }
-      else if(checkRobotHwState(hw_to_load_name, cnr_hardware_interface::RUNNING))
-      {
-        CNR_INFO(m_logger, "The '" + hw_to_load_name + "' is RUNNING. Good!");
-        return true;
-      }
-      if((ros::Time::now()-st).toSec() > 4.0)
-      {
-        CNR_ERROR(m_logger, "Timeout in loading and activating the '" + hw_to_load_name + "'");
-        return false;
-      }
-      r.sleep();
+      CNR_ERROR(m_logger, "Timeout in loading and activating the '" + hw_to_load_name + "'");
+      return false;
     }
-    return false;
+    CNR_INFO(m_logger, "The '" + hw_to_load_name + "' is " + cnr_hardware_interface::to_string(reached) + ". Good!");
+    return true;
   };
 
   std::vector<std::future<bool>> oks; 
@@ -48,12 +48,40 @@
 
 #include <cnr_logger/cnr_logger.h>
 #include <realtime_utilities/diagnostics_interface.h>
+#include <cnr_controller_interface_params/allocation_sentinel.h>
+#include <cnr_controller_interface_params/loop_status.h>
+#include <cnr_controller_interface_params/fork_join_executor.h>
+#include <cnr_controller_interface_params/controller_cost.h>
+#include <cnr_controller_interface_params/realtime_publisher.h>
+#include <cnr_controller_interface_params/topic_watchdog.h>
+#include <cnr_controller_interface/utils/tracker_handle.h>
 #include <subscription_notifier/subscription_notifier.h> //ros_helper::WallTimeMTPr
 namespace cnr
 {
 namespace control
 {
 
+/**
+ * @brief Realtime publisher of a controller, resolved to its message type once by add_realtime_publisher(),
+ * so that publish_realtime() does not cast. Valid until the controller is shut down
+ */
+template<typename M>
+struct RealtimePublisherHandle
+{
+  size_t                idx = 0;
+  RealtimePublisher<M>* pub = nullptr;
+};
+
+/**
+ * @brief Mailbox of a subscriber of a controller, resolved to its message type once by add_mailbox_subscriber(),
+ * so that read_mailbox() does not cast. Valid until the controller is shut down
+ */
+template<typename M>
+struct MailboxHandle
+{
+  size_t      idx = 0;  //!< the index of the subscriber
+  Mailbox<M>* mailbox = nullptr;
+};
 
 template<class T>
 class Controller: public controller_interface::Controller<T>,
@@ -75,6 +103,9 @@ public:
   void aborting(const ros::Time& time)                                       final;
 
   cnr_logger::TraceLoggerPtr logger() { return m_logger; }
+  const CycleContext& cycleContext() const { return m_cycle_context; }
+  //! The update runs every decimation() cycles of the loop of the hw
+  unsigned int decimation() const { return m_decimation; }
 
 public:
   virtual bool doInit()
@@ -89,6 +120,15 @@ public:
   {
     return true;
   }
+  /** @brief The update with the timing of the cycle of the driver (index, measured dt, deadline, overruns)
+   *
+   * The default implementation calls doUpdate(ctx.time, ctx.period). If the controller is not updated by a
+   * RobotHwDriverInterface, the context holds the time and the period of the call.
+   */
+  virtual bool doUpdate(const CycleContext& ctx)
+  {
+    return doUpdate(ctx.time, ctx.period);
+  }
   virtual bool doStopping(const ros::Time& time)
   {
     return true;
@@ -156,6 +196,33 @@ public:
   template<typename M>
   bool publish(const size_t& idx, const boost::shared_ptr<M>& message);
 
+  /**
+   * @brief add_realtime_publisher: a publisher that can be used in doUpdate() without allocating and serializing
+   *
+   * The messages are copied in a preallocated pool, and a non-RT thread of the controller publishes them.
+   * @param decimation only one call of publish_realtime() out of 'decimation' is published
+   * @return the handle to be used in publish_realtime(); its index is the one of getRealtimePublisher()
+   */
+  template<typename M>
+  RealtimePublisherHandle<M> add_realtime_publisher(const std::string &topic,
+                                uint32_t queue_size,
+                                unsigned int decimation = 1,
+                                bool latch = false,
+                                bool enable_watchdog = false);
+
+  /**
+   * @brief publish_realtime: RT-safe, the message is copied in a slot of the pool
+   * @return false if the handle is empty, the pool is full, or the watchdog expired
+   */
+  template<typename M>
+  bool publish_realtime(const RealtimePublisherHandle<M>& handle, const M &message);
+
+  /**
+   * @brief getRealtimePublisher: to fill the slots in place (acquire()/commit()) or to size them (reset())
+   */
+  template<typename M>
+  std::shared_ptr<RealtimePublisher<M>> getRealtimePublisher(const size_t& idx);
+
   /**
    * @brief Allows the user to easily add a subscriber, eith the correct callback queue, 
    *        and the timing check
@@ -180,6 +247,34 @@ public:
                         boost::function<void(const boost::shared_ptr<M const>& msg)> callback,
                         bool enable_watchdog = true);
 
+  /**
+   * @brief add_mailbox_subscriber: a subscriber whose callback is not executed by the RT loop
+   *
+   * The messages are received by a non-RT spinner of the controller, and they are written in a lock-free
+   * mailbox; doUpdate() reads the latest one through read_mailbox(). The watchdog is the same of add_subscriber().
+   * @return the handle to be used in read_mailbox(); its index is in the same space of add_subscriber()
+   */
+  template<typename M>
+  MailboxHandle<M> add_mailbox_subscriber(const std::string &topic,
+                                uint32_t queue_size,
+                                bool enable_watchdog = true);
+
+  /**
+   * @brief read_mailbox: RT-safe, O(1)
+   * @param[out] fresh true if the message arrived after the previous call
+   * @return the latest message, nullptr if nothing has been received yet (or the handle is empty)
+   */
+  template<typename M>
+  const M* read_mailbox(const MailboxHandle<M>& handle, bool* fresh = nullptr);
+
+  /**
+   * @brief addTimeTrackerHandle: register a time tracker (non-RT, e.g., in doInit())
+   *
+   * The tracker is shown in the diagnostics as the ones added through addTimeTracker(), and the returned handle
+   * ticks it in doUpdate() without the lookup by name. In the lean build profile, nothing is registered.
+   */
+  TrackerHandle addTimeTrackerHandle(const std::string& name, const double& period);
+
   std::shared_ptr<ros::Subscriber> getSubscriber(const size_t& id);
   std::shared_ptr<ros::Publisher>  getPublisher(const size_t &id);
 
@@ -222,15 +317,66 @@ private:
   ros::NodeHandle     m_controller_nh;
   ros::CallbackQueue  m_controller_nh_callback_queue;
 
+  //! The last call of publish() per publisher (the epoch if never called), tracked if the watchdog is enabled
   std::vector<std::shared_ptr<ros::Publisher>>                 m_pub;
-  std::vector<std::chrono::high_resolution_clock::time_point*> m_pub_start;
-  std::vector<std::chrono::high_resolution_clock::time_point*> m_pub_last;
+  std::vector<std::chrono::high_resolution_clock::time_point>  m_pub_last;
   std::vector<bool>                                            m_pub_time_track;
 
+  std::vector<std::shared_ptr<RealtimePublisherBase>>          m_rt_pub;
+  std::vector<std::chrono::high_resolution_clock::time_point>  m_rt_pub_last;
+  std::vector<bool>                                            m_rt_pub_time_track;
+  RealtimePublishingThread                                     m_rt_pub_thread;
+
   std::vector<std::shared_ptr<void>>            m_sub_notifier;
   std::vector<std::shared_ptr<ros::Subscriber>> m_sub;
-  std::vector<ros_helper::TimeMTPtr>            m_sub_time;
-  std::vector<bool>                             m_sub_time_track;
+
+  //! Arrival times of the subscribed topics, stamped by the callbacks and checked in exitUpdate() against the
+  //! time of the cycle; reported by the ControllerManagerInterface diagnostics
+  TopicWatchdog                                 m_topic_watchdog;
+  //! The time of the last cycle [ns], published by update(): the callbacks stamp the arrivals with it, so that
+  //! the watchdog works on the time base of the cycles (simulated in lockstep, also when ROS time is the wall one)
+  std::atomic<int64_t>                          m_cycle_time_ns{0};
+
+  //! The mailboxes of the subscribers added through add_mailbox_subscriber() (nullptr for the others), written
+  //! by m_mailbox_spinner that serves m_mailbox_callback_queue
+  std::vector<std::shared_ptr<MailboxBase>>     m_mailbox;
+  ros::CallbackQueue                            m_mailbox_callback_queue;
+  std::shared_ptr<ros::AsyncSpinner>            m_mailbox_spinner;
+
+  //! Allocations done in update(), registered as '<hw_name>/<ctrl_name>' in the allocation sentinel
+  AllocationCounter                             m_alloc_counter;
+
+  //! The trackers of the phases of the update
+  TrackerHandle                                 m_update_tracker;
+  TrackerHandle                                 m_enter_update_tracker;
+  TrackerHandle                                 m_do_update_tracker;
+  TrackerHandle                                 m_exit_update_tracker;
+
+  //! Execution time of the update and cycles in which it crossed the deadline of the loop, aggregated per hw
+  //! by the ControllerManagerInterface diagnostics
+  ControllerCost                                m_cost;
+
+  //! If the loop of the hw is degraded, the update is skipped unless the controller is 'critical'
+  HwLoopStatus*                                 m_loop_status = nullptr;
+  bool                                          m_critical = true;
+
+  //! The context of the running cycle, copied from m_loop_status in update()
+  CycleContext                                  m_cycle_context;
+
+  //! Multi-rate: the update runs at the cycles where 'cycle % m_decimation == m_update_phase', and it gets
+  //! the time elapsed since the previous update (params 'decimation' or 'rate' of the controller)
+  unsigned int                                  m_decimation = 1;
+  unsigned int                                  m_update_phase = 0;
+  ros::Duration                                 m_skipped_period;
+
+  //! Parallel update: the controllers are forked on the lane of their group of claimed resources. A worker
+  //! only records the failure of the update: the controller is stopped by the loop thread, once joined
+  const std::atomic<int>*                       m_claims_group = nullptr;
+  bool                                          m_forked_failed = false;
+  static void forkedUpdate(void* ctrl);
+  static void joinedUpdate(void* ctrl);
+  bool updateCycle();  //!< false if the controller has to be stopped (an exception is only logged)
+  void stopOnUpdateFailure();
 
   bool callAvailable( );
 };
@@ -35,7 +35,10 @@
 #ifndef CNR_CONTROLLER_INTERFACE__JOINT_COMMAND_CONTROLLER_INTERFACE_H
 #define CNR_CONTROLLER_INTERFACE__JOINT_COMMAND_CONTROLLER_INTERFACE_H
 
+#include <array>
+#include <atomic>
 #include <mutex>
+#include <thread>
 #include <Eigen/Core>
 #include <ros/ros.h>
 #include <std_msgs/Int64.h>
@@ -44,6 +47,7 @@
 #include <cnr_logger/cnr_logger.h>
 #include <rosdyn_chain_state/chain_state.h>
 #include <rosdyn_chain_state/chain_state_publisher.h>
+#include <cnr_controller_interface_params/realtime_buffers.h>
 #include <cnr_controller_interface/cnr_joint_controller_interface.h>
 
 #include <urdf_model/model.h>
@@ -55,14 +59,41 @@ namespace cnr
 namespace control
 {
 
+/**
+ * @brief Command fields set by the producers (callbacks, other threads), with the generation of each joint value
+ */
+struct JointCommandBlock
+{
+  enum Field {POSITION, VELOCITY, ACCELERATION, EFFORT, FIELDS};
+
+  std::array<rosdyn::VectorXd, FIELDS>      value;
+  std::array<std::vector<uint64_t>, FIELDS> stamp;       //!< generation of the last set of each joint
+  uint64_t                                  generation = 0;
+
+  void resize(size_t n)
+  {
+    for (size_t f = 0; f < FIELDS; f++)
+    {
+      value[f].setZero(n);
+      stamp[f].assign(n, 0);
+    }
+  }
+};
+
 /**
  *
  *
  *
  * Base class to log the controller status
+ *
+ * The setCommand*() and the getCommand*() are wait-free for the RT thread:
+ * - called from the update thread (e.g., in doUpdate()), they act directly on the target;
+ * - called from any other thread, the setters write a command block that is handed over through
+ *   a TripleBuffer and merged at the next enterUpdate(), while the getters read the snapshot of the
+ *   target that the RT thread publishes through a SeqLock at the end of each cycle.
  */
-template<class H, class T>
-class JointCommandController: public cnr::control::JointController<H,T>
+template<class H, class T, int N = Eigen::Dynamic>
+class JointCommandController: public cnr::control::JointController<H,T,N>
 {
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -86,13 +117,20 @@ public:
   virtual bool exitStopping() override;
 
 protected:
+  //! update thread only: the target itself, not guarded. From the other threads, use getCommandSnapshot()
   const rosdyn::ChainState& chainCommand() const;
   rosdyn::ChainState&       chainCommand();
 
-  const rosdyn::VectorXd& getCommandPosition    ( ) const;
-  const rosdyn::VectorXd& getCommandVelocity    ( ) const;
-  const rosdyn::VectorXd& getCommandAcceleration( ) const;
-  const rosdyn::VectorXd& getCommandEffort      ( ) const;
+  //! Copy of the target from the update thread, of its last snapshot from the other threads.
+  //! They allocate: in doUpdate(), prefer the scalar getters or chainCommand()
+  rosdyn::VectorXd getCommandPosition    ( ) const;
+  rosdyn::VectorXd getCommandVelocity    ( ) const;
+  rosdyn::VectorXd getCommandAcceleration( ) const;
+  rosdyn::VectorXd getCommandEffort      ( ) const;
+
+  //! Thread-safe, consistent copy of the last target sent to the hw (null arguments are skipped)
+  void getCommandSnapshot(rosdyn::VectorXd* q, rosdyn::VectorXd* qd = nullptr,
+                          rosdyn::VectorXd* qdd = nullptr, rosdyn::VectorXd* effort = nullptr) const;
 
   double getCommandPosition    (size_t idx) const;
   double getCommandVelocity    (size_t idx) const;
@@ -113,14 +151,37 @@ protected:
 
   void setPriority( const InputType& priority ) { m_priority = priority; }
 
+  //! not used by the command setters/getters anymore: kept for the derived classes
   mutable std::mutex m_mtx;
 
 private:
   InputType          m_priority;
   rosdyn::ChainState m_target;
   rosdyn::ChainState m_last_target;
+
+  // scratch of exitUpdate(), sized in enterInit(): the cycle does not allocate
+  typename JointController<H,T,N>::Vector m_nominal_qd;
+  rosdyn::VectorXd                        m_saturated_qd;
+  ros::WallTime                           m_last_report;  //!< of the NaN/saturation report of exitUpdate()
   rosdyn::ChainStatePublisherPtr m_target_pub;
-  
+
+  bool isUpdateThread() const { return std::this_thread::get_id() == m_update_thread.load(std::memory_order_relaxed); }
+  rosdyn::VectorXd& commandField(JointCommandBlock::Field field);
+  const rosdyn::VectorXd& commandField(JointCommandBlock::Field field) const;
+  double getCommand(JointCommandBlock::Field field, size_t idx) const;
+  rosdyn::VectorXd getCommand(JointCommandBlock::Field field) const;
+  void setCommand(JointCommandBlock::Field field, const rosdyn::VectorXd& in);
+  void setCommand(JointCommandBlock::Field field, const double& in, size_t idx);
+  void mergeCommand();
+  void publishCommandSnapshot();
+
+  std::atomic<std::thread::id>          m_update_thread;
+  std::mutex                            m_cmd_mtx;       //!< producers only, never taken by the RT thread
+  JointCommandBlock                     m_cmd_pending;   //!< guarded by m_cmd_mtx
+  TripleBuffer<JointCommandBlock>       m_cmd_buffer;
+  uint64_t                              m_cmd_applied;   //!< RT thread: last generation merged in the target
+  SeqLock<JointCommandBlock>            m_cmd_snapshot;  //!< written by the RT thread
+  TripleBuffer<rosdyn::ChainState>      m_target_kin_buffer;  //!< Cartesian target, from the kinematics thread
 
   double m_override;
   void overrideCallback(const std_msgs::Int64ConstPtr& msg);
@@ -131,7 +192,7 @@ private:
   void safeOverrideCallback_1(const std_msgs::Int64ConstPtr& msg);
   void safeOverrideCallback_2(const std_msgs::Int64ConstPtr& msg);
 
-  virtual void updateTransformationsThread(int ffwd_kin_type, double hz);
+  virtual bool subscribeKinematics(int ffwd_kin_type, double hz) override;
 };
 
 }  // namespace control
@@ -37,6 +37,7 @@
 #ifndef CNR_CONTROLLER_INTERFACE__JOINT_CONTROLLER_INTERFACE_H
 #define CNR_CONTROLLER_INTERFACE__JOINT_CONTROLLER_INTERFACE_H
 
+#include <atomic>
 #include <mutex>
 #include <thread>
 #include <Eigen/Core>
@@ -47,8 +48,11 @@
 #include <rosdyn_core/primitives.h>
 #include <rosdyn_chain_state/chain_state.h>
 
+#include <cnr_controller_interface_params/realtime_buffers.h>
 #include <cnr_controller_interface/cnr_controller_interface.h>
 #include <cnr_controller_interface/internal/cnr_handles.h>
+#include <cnr_controller_interface/utils/chain_cache.h>
+#include <cnr_controller_interface/utils/kinematics_service.h>
 
 namespace cnr
 {
@@ -60,19 +64,27 @@ namespace control
  * and the joints must be connected to each other.
  * The class is built aroun a 'rosdyn::ChainState' that stores the state
  * of the joints, and at each cycle time the internal status is updated.
- * The class creates a parallel thread cyclically (as the sampling rate)
- * compute the forward kinematics. Furthermore, the effort may be computed
+ * The forward kinematics is computed cyclically (as the sampling rate) by the KinematicsService,
+ * a pool of workers shared by all the controllers of the process. Furthermore, the effort may be computed
  * from the external force measure id available.
  * The computation is therefore done in parallel to avoid that the 'update' method
  * takes too long, breaking the soft-realtime of the controller
+ * The RT thread publishes the joint state through a SeqLock, and the kinematics thread
+ * hands the Cartesian results back through a TripleBuffer, merged in the state at the next enterUpdate():
+ * neither side waits for the other, and the getters of the update thread see a consistent state.
  *
+ * @tparam N number of axes, if known at compile time (e.g., 6 or 7 for the common arms): the type Vector
+ * is then fixed-size (stack allocated, unrolled by Eigen), and the init fails if the chain has a different
+ * number of axes. The chain state, the target and the other buffers stay dynamic. Eigen::Dynamic is the default
  */
-template<class H, class T>
+template<class H, class T, int N = Eigen::Dynamic>
 class JointController: public cnr::control::Controller<T>
 {
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+  typedef Eigen::Matrix<double, N, 1> Vector;
+
   virtual ~JointController();
 
   virtual bool doInit() override;
@@ -97,10 +109,13 @@ protected:
 
   const rosdyn::Chain& chain() const;
   rosdyn::Chain& chainNonConst();
+  //! Non-RT. It builds another chain with the joints of chain(), on a new Link/Joint tree (e.g., for a thread)
+  bool buildChain(rosdyn::LinkPtr& root_link, rosdyn::Chain& chain) const;
 
   const rosdyn::ChainState& chainState() const;
   rosdyn::ChainState&       chainState();
 
+  //! update thread only (the references point to the state of the cycle)
   const rosdyn::VectorXd& getPosition    ( ) const;
   const rosdyn::VectorXd& getVelocity    ( ) const;
   const rosdyn::VectorXd& getAcceleration( ) const;
@@ -111,28 +126,74 @@ protected:
   double getAcceleration(int idx) const;
   double getEffort      (int idx) const;
 
+  //! update thread only: the last kinematics merged in the state, computed from the joint state of getKinematicsAge() ago
   const Eigen::Affine3d&   getToolPose( ) const;
   const Eigen::Vector6d&   getTwist( ) const;
   const Eigen::Vector6d&   getTwistd( ) const;
   const rosdyn::Matrix6Xd& getJacobian( ) const;
 
+  //! update thread only: time of the cycle minus the time of the joint state used by the kinematics, negative if none
+  ros::Duration getKinematicsAge( ) const;
+
+  //! Thread-safe copies of the last kinematics merged by the update thread (identity/zero before the first one)
+  Eigen::Affine3d   getToolPoseSnapshot( ) const;
+  Eigen::Vector6d   getTwistSnapshot( ) const;
+  Eigen::Vector6d   getTwistdSnapshot( ) const;
+  rosdyn::Matrix6Xd getJacobianSnapshot( ) const;
+
+  //! Thread-safe, consistent copy of the last kinematics merged by the update thread (null arguments are skipped)
+  //! @param[out] stamp time of the joint state the kinematics comes from (zero before the first one)
+  void getKinematicsSnapshot(Eigen::Affine3d* pose, Eigen::Vector6d* twist = nullptr, Eigen::Vector6d* twistd = nullptr,
+                             rosdyn::Matrix6Xd* jacobian = nullptr, ros::Time* stamp = nullptr) const;
+
+  //! Thread-safe, consistent copy of the joint state of the last cycle (only the joint part of 'rstate' is written)
+  void getStateSnapshot(rosdyn::ChainState& rstate, ros::Time* stamp = nullptr) const;
+
+  //! kinematics thread: hand over the Cartesian part of 'rstate', computed from the joint state at 'stamp'
+  void publishKinematics(const rosdyn::ChainState& rstate, const ros::Time& stamp);
+
+  //! The kinematics is computed by the KinematicsService, shared with the other controllers of the process
   bool startUpdateTransformationsThread(int ffwd_kin_type, double hz = 10.0);
   void stopUpdateTransformationsThread();
-  virtual void updateTransformationsThread(int ffwd_kin_type, double hz);
 
-  std::thread         update_transformations_;
-  bool                stop_update_transformations_;
-  bool                update_transformations_runnig_;
+  //! It subscribes the kinematics jobs of the controller, and it stores their ids in 'kinematics_jobs_'
+  virtual bool subscribeKinematics(int ffwd_kin_type, double hz);
+
+  std::vector<size_t> kinematics_jobs_;
+  std::atomic<bool>   update_transformations_runnig_;
   mutable std::mutex  mtx_;
 
   double getKinUpdatePeriod() const { return m_fkin_update_period; }
   void setKinUpdatePeriod(const double& fkin_update_period) { m_fkin_update_period = fkin_update_period; }
 
 private:
+  ChainTemplateConstPtr m_chain_template;
   rosdyn::LinkPtr    m_root_link;  //link primitivo da cui parte la catena cinematica(world ad esempio)
-  rosdyn::Chain      m_chain;
+  rosdyn::Chain      m_chain;      //!< on the private tree m_root_link, used by the update only
   rosdyn::ChainState m_rstate;
   Eigen::IOFormat    m_cfrmt;
+  std::string        m_kin_key;  //!< the controllers with the same key share the kinematics computation
+
+  struct StateSample
+  {
+    rosdyn::ChainState state;
+    ros::Time          stamp;
+  };
+  SeqLock<StateSample>      m_joint_snapshot;  //!< written by the RT thread
+  TripleBuffer<StateSample> m_kin_buffer;      //!< written by the kinematics thread, read by the RT thread
+  ros::Time                 m_kin_stamp;       //!< RT thread: joint state time of the kinematics in m_rstate
+
+  struct CartesianSample
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Eigen::Affine3d   pose;
+    Eigen::Vector6d   twist;
+    Eigen::Vector6d   twistd;
+    rosdyn::Matrix6Xd jacobian;
+    ros::Time         stamp;
+  };
+  SeqLock<CartesianSample>  m_cart_snapshot;   //!< written by the RT thread when it merges new kinematics
+  void publishJointState();
   double             m_fkin_update_period;
 };
 
@@ -38,6 +38,8 @@
 #ifndef CNR_CONTROLLER_INTFERFACE_CNR_CONTROLLER_INTFERFACE_IMPL_H
 #define CNR_CONTROLLER_INTFERFACE_CNR_CONTROLLER_INTFERFACE_IMPL_H
 
+#include <set>
+#include <cmath>
 #include <stdexcept>
 #include <mutex>
 #include <ros/ros.h>
@@ -54,12 +56,32 @@ namespace cnr
 namespace control
 {
 
+//! The resources claimed on 'hw' (none, if the interface has not the claim policy)
+template<class H>
+auto claimed_resources(H* hw, int) -> decltype(hw->getClaims())
+{
+  return hw->getClaims();
+}
+
+template<class H>
+std::set<std::string> claimed_resources(H* /*hw*/, long)
+{
+  return std::set<std::string>();
+}
 
 template<class T>
 Controller<T>::~Controller()
 {
   CNR_TRACE_START(m_logger);
   shutdown("UNLOADED");
+  allocation_sentinel::unregisterCounter(m_hw_name + "/" + m_ctrl_name, &m_alloc_counter);
+  unregister_controller_cost(m_hw_name, m_ctrl_name, &m_cost);
+  unregister_topic_watchdog(m_hw_name, m_ctrl_name, &m_topic_watchdog);
+  if(m_claims_group)
+  {
+    unregister_claims(m_hw_name, m_ctrl_name);
+  }
+  release_update_phase(m_hw_name, m_decimation, m_update_phase);
   CNR_TRACE(m_logger, "[ DONE]");
 }
 
@@ -97,6 +119,9 @@ bool Controller<T>::init(T* hw, ros::NodeHandle& root_nh, ros::NodeHandle& contr
     {
       CNR_RETURN_FALSE(m_logger);
     }
+
+    // the claims of this controller only: the controller manager clears them before the init
+    m_claims_group = register_claims(m_hw_name, m_ctrl_name, claimed_resources(hw, 0));
   }
   catch(std::exception& e)
   {
@@ -228,15 +253,59 @@ bool Controller<T>::prepareInit(T* hw,
       }
     }
     CNR_DEBUG(m_logger, "Watchdog: " << m_watchdog);
+    m_topic_watchdog.setTimeout(m_watchdog);
+    register_topic_watchdog(m_hw_name, m_ctrl_name, &m_topic_watchdog);
+
+    m_critical = true;
+    if(!rosparam_utilities::get(m_controller_nh.getNamespace()+"/critical", m_critical, what, &m_critical))
+    {
+      m_critical = true;
+    }
+    m_loop_status = hw_loop_status(m_hw_name);
+
+    int decimation = 1;
+    double rate = 0.0;
+    if(rosparam_utilities::get(m_controller_nh.getNamespace()+"/decimation", decimation, what, &decimation))
+    {
+      if(decimation < 1)
+      {
+        CNR_ERROR(m_logger, "The param 'decimation' must be a positive integer (it is " << decimation << ")");
+        CNR_RETURN_FALSE(m_logger);
+      }
+    }
+    else if(rosparam_utilities::get(m_controller_nh.getNamespace()+"/rate", rate, what, &rate) && (rate > 0.0))
+    {
+      const double cycles = 1.0 / (rate * m_sampling_period);
+      decimation = std::max(1, static_cast<int>(std::round(cycles)));
+      if(std::fabs(cycles - decimation) > 1e-6)
+      {
+        CNR_WARN(m_logger, "The rate " << rate << "Hz is not a divisor of the rate of the hw: the controller runs at "
+                           << 1.0 / (decimation * m_sampling_period) << "Hz");
+      }
+    }
+    else
+    {
+      decimation = 1;
+    }
+    m_decimation = static_cast<unsigned int>(decimation);
+    m_update_phase = acquire_update_phase(m_hw_name, m_decimation);
+    if(m_decimation > 1)
+    {
+      CNR_DEBUG(m_logger, "Updated every " << m_decimation << " cycles, phase: " << m_update_phase);
+    }
 
     m_controller_nh.setCallbackQueue(&m_controller_nh_callback_queue);
     //m_status_history.clear();
 
     realtime_utilities::DiagnosticsInterface::init( m_hw_name, "Ctrl", m_ctrl_name );
-    realtime_utilities::DiagnosticsInterface::addTimeTracker("update", m_sampling_period);
-    realtime_utilities::DiagnosticsInterface::addTimeTracker("enterUpdate", m_sampling_period);
-    realtime_utilities::DiagnosticsInterface::addTimeTracker("doUpdate", m_sampling_period);
-    realtime_utilities::DiagnosticsInterface::addTimeTracker("exitUpdate", m_sampling_period);
+    m_update_tracker       = addTimeTrackerHandle("update", m_sampling_period);
+    m_enter_update_tracker = addTimeTrackerHandle("enterUpdate", m_sampling_period);
+    m_do_update_tracker    = addTimeTrackerHandle("doUpdate", m_sampling_period);
+    m_exit_update_tracker  = addTimeTrackerHandle("exitUpdate", m_sampling_period);
+
+    allocation_sentinel::registerCounter(m_hw_name + "/" + m_ctrl_name, &m_alloc_counter);
+    m_cost.reset(static_cast<int64_t>(m_sampling_period * 1e9));
+    register_controller_cost(m_hw_name, m_ctrl_name, &m_cost);
   }
   catch(std::exception& e)
 
@@ -255,6 +324,7 @@ template<class T>
 void Controller<T>::starting(const ros::Time& time)
 {
   CNR_TRACE_START(m_logger);
+  m_skipped_period = ros::Duration(0);
   try
   {
     if(enterStarting() && doStarting(time) && exitStarting())
@@ -287,55 +357,131 @@ template<class T>
 void Controller<T>::update(const ros::Time& time, const ros::Duration& period)
 {
   CNR_TRACE_START_THROTTLE_DEFAULT(m_logger);
-  try
+  if(m_loop_status && m_loop_status->context.time == time)
+  {
+    m_cycle_context = m_loop_status->context;
+  }
+  else
+  {
+    m_cycle_context.cycle  = m_cycle_context.time.isZero() ? 0 : m_cycle_context.cycle + 1;
+    m_cycle_context.dt     = period.toNSec();
+    m_cycle_context.time   = time;
+    m_cycle_context.period = period;
+  }
+  m_cycle_time_ns.store(m_cycle_context.time.toNSec(), std::memory_order_relaxed);
+  const bool skip_cycle = (m_decimation > 1) && (m_cycle_context.cycle % m_decimation != m_update_phase);
+  const bool degraded   = !m_critical && m_loop_status && m_loop_status->degraded.load(std::memory_order_relaxed);
+  if(skip_cycle || degraded)
+  {
+    m_cost.tick();
+    m_skipped_period += m_cycle_context.period;
+    CNR_RETURN_OK_THROTTLE_DEFAULT(m_logger, void());
+  }
+  // the effective period: the time elapsed since the previous update
+  m_cycle_context.period += m_skipped_period;
+  m_cycle_context.dt      = m_cycle_context.period.toNSec();
+  m_skipped_period        = ros::Duration(0);
+
+  // the controllers of disjoint groups of resources run in parallel, the driver joins them before write()
+  // (a group of -1 has not been swapped in by the loop yet, and no update is forked while a switch of the
+  // controllers is pending: the update runs on the loop thread)
+  ForkJoinExecutor* executor = m_loop_status ? m_loop_status->executor.load(std::memory_order_acquire) : nullptr;
+  const int group = m_claims_group ? m_claims_group->load(std::memory_order_relaxed) : -1;
+  if(executor && group >= 0 && !m_loop_status->serial.load(std::memory_order_relaxed)
+     && executor->fork(static_cast<size_t>(group), &Controller<T>::forkedUpdate, this, &Controller<T>::joinedUpdate))
+  {
+    CNR_RETURN_OK_THROTTLE_DEFAULT(m_logger, void());
+  }
+  if(!updateCycle())
+  {
+    stopOnUpdateFailure();
+  }
+  CNR_RETURN_OK_THROTTLE_DEFAULT(m_logger, void());
+}
+
+template<class T>
+void Controller<T>::forkedUpdate(void* ctrl)
+{
+  Controller<T>* c = static_cast<Controller<T>*>(ctrl);
+  c->m_forked_failed = !c->updateCycle();
+}
+
+template<class T>
+void Controller<T>::joinedUpdate(void* ctrl)
+{
+  Controller<T>* c = static_cast<Controller<T>*>(ctrl);
+  if(c->m_forked_failed)
+  {
+    c->m_forked_failed = false;
+    c->stopOnUpdateFailure();
+  }
+}
+
+template<class T>
+void Controller<T>::stopOnUpdateFailure()
+{
+  CNR_ERROR(m_logger, "Error in update, stop request called to stop the controller quietly.");
+  if(controller_interface::Controller<T>::stopRequest(m_cycle_context.time))
   {
+    //dump_state("STOPPED");
+  }
+  else
+  {
+    //dump_state("ERROR");
+  }
+}
 
-    timeSpanStrakcer("update")->tick();
-    timeSpanStrakcer("enterUpdate")->tick();
+template<class T>
+bool Controller<T>::updateCycle()
+{
+  CNR_TRACE_START_THROTTLE_DEFAULT(m_logger);
+  AllocationScope alloc_scope(&m_alloc_counter);
+  try
+  {
+    const int64_t t_start = ControllerCost::now();
+    m_update_tracker.tick();
+    m_enter_update_tracker.tick();
     bool ok = enterUpdate();
-    timeSpanStrakcer("enterUpdate")->tock();
+    m_enter_update_tracker.tock();
 
     if(ok)
     {
-      m_dt = period.toSec() > 1e-4 ? period : ros::Duration(1e-4);
-      timeSpanStrakcer("doUpdate")->tick();
-      ok = doUpdate(time, period);
-      timeSpanStrakcer("doUpdate")->tock();
+      m_dt = m_cycle_context.period.toSec() > 1e-4 ? m_cycle_context.period : ros::Duration(1e-4);
+      m_do_update_tracker.tick();
+      ok = doUpdate(m_cycle_context);
+      m_do_update_tracker.tock();
       if(ok)
       {
-        timeSpanStrakcer("exitUpdate")->tick();
+        m_exit_update_tracker.tick();
         ok = exitUpdate();
-        timeSpanStrakcer("exitUpdate")->tick();
+        m_exit_update_tracker.tock();
       }
     }
 
-    timeSpanStrakcer("update")->tock();
+    m_update_tracker.tock();
+
+    // the controller is blamed if the deadline of the cycle (wake-up + sampling period) falls within its update
+    const int64_t t_end = ControllerCost::now();
+    const int64_t deadline = m_cycle_context.deadline + static_cast<int64_t>(m_sampling_period * 1e9);
+    m_cost.record(t_end - t_start, !m_cycle_context.simulated && (m_cycle_context.deadline > 0)
+                                     && (t_start <= deadline) && (t_end > deadline));
 
     if(!ok)
     {
-      CNR_ERROR(m_logger, "Error in update, stop request called to stop the controller quietly.");
-      if(controller_interface::Controller<T>::stopRequest(time))
-      {
-        //dump_state("STOPPED");
-      }
-      else
-      {
-        //dump_state("ERROR");
-      }
-      CNR_RETURN_NOTOK_THROTTLE(m_logger, void(), 10.0);
+      CNR_RETURN_NOTOK_THROTTLE(m_logger, false, 10.0);
     }
   }
   catch(const std::exception& e)
   {
     CNR_ERROR_THROTTLE(m_logger, 10.0, "The update of the controller failed. Exception:" << e.what() );
-    CNR_RETURN_NOTOK_THROTTLE(m_logger, void(), 10.0);
+    CNR_RETURN_NOTOK_THROTTLE(m_logger, true, 10.0);
   }
   catch(...)
   {
     CNR_ERROR_THROTTLE(m_logger, 10.0, "The update of the controller failed. Unhandled Exception");
-    CNR_RETURN_NOTOK_THROTTLE(m_logger, void(), 10.0);
+    CNR_RETURN_NOTOK_THROTTLE(m_logger, true, 10.0);
   }
-  CNR_RETURN_OK_THROTTLE_DEFAULT(m_logger, void());
+  CNR_RETURN_OK_THROTTLE_DEFAULT(m_logger, true);
 }
 
 template<class T>
@@ -475,32 +621,8 @@ template<class T>
 bool Controller<T>::exitUpdate()
 {
   CNR_TRACE_START_THROTTLE_DEFAULT(m_logger);
-  if(m_sub.size() > 0)
-  {
-    ros::Time now = ros::Time::now();
-    ros::Time last_message_time = ros::Time::now();
-    for(size_t idx=0; idx<m_sub.size(); idx++)
-    {
-      if(m_sub_time.at(idx) == nullptr)
-      {
-        CNR_WARN_THROTTLE(m_logger, 5.0, "The topic '" + m_sub.at(idx)->getTopic() + "' seems not yet published..");
-      }
-      else
-      {
-        if(m_sub_time_track.at(idx))
-        {
-          m_sub_time.at(idx)->get(last_message_time);
-          ros::Duration time_span = (now - last_message_time);
-          if(time_span.toSec() > m_watchdog)
-          {
-            CNR_ERROR_THROTTLE(m_logger, 5.0, "Watchdog on subscribed topic '" + m_sub.at(idx)->getTopic()+ "' " +
-                                               std::string("time span: ")+std::to_string(time_span.toSec())+
-                                               std::string(" watchdog: ")+std::to_string(m_watchdog));
-          }
-        }
-      }
-    }
-  }
+  // the topics in timeout are reported by the diagnostics, nothing is formatted here
+  m_topic_watchdog.check(m_cycle_context.time.toNSec());
   CNR_RETURN_TRUE_THROTTLE_DEFAULT(m_logger);
 }
 
@@ -596,6 +718,11 @@ template<class T>
 bool Controller<T>::shutdown(const std::string& state_final)
 {
   CNR_TRACE_START(m_logger);
+  if(m_mailbox_spinner)
+  {
+    m_mailbox_spinner->stop();
+    m_mailbox_spinner.reset();
+  }
   for(auto & t : m_sub)
   {
     t->shutdown();
@@ -604,26 +731,26 @@ bool Controller<T>::shutdown(const std::string& state_final)
   {
     t->shutdown();
   }
+  m_rt_pub_thread.stop();
+  m_rt_pub.clear();
+  m_rt_pub_last.clear();
+  m_rt_pub_time_track.clear();
 
   for( size_t idx=0; idx<m_sub.size();idx++)
   {
     m_sub.at(idx).reset();
-    m_sub_time.at(idx).reset();
     m_sub_notifier.at(idx).reset();
   }
   m_sub.clear();
-  m_sub_time.clear();
-  m_sub_time_track.clear();
+  m_topic_watchdog.clear();
   m_sub_notifier.clear();
+  m_mailbox.clear();
 
   for( size_t idx=0; idx<m_pub.size();idx++)
   {
     m_pub.at(idx).reset();
-    delete m_pub_start.at(idx);
-    delete m_pub_last.at(idx);
   }
   m_pub.clear();
-  m_pub_start.clear();
   m_pub_last.clear();
   m_pub_time_track.clear();
 
@@ -636,12 +763,57 @@ size_t Controller<T>::add_publisher(const std::string &topic, uint32_t queue_siz
 {
   m_pub.push_back(std::shared_ptr<ros::Publisher>(
       new ros::Publisher(m_controller_nh.advertise< M >(topic, queue_size, latch))) );
-  m_pub_start.push_back(nullptr);
-  m_pub_last.push_back(nullptr);
+  m_pub_last.push_back(std::chrono::high_resolution_clock::time_point());
   m_pub_time_track.push_back(enable_watchdog);
   return m_pub.size()-1;
 }
 
+template<typename T> template<typename M>
+RealtimePublisherHandle<M> Controller<T>::add_realtime_publisher(const std::string &topic, uint32_t queue_size,
+                                                                 unsigned int decimation, bool latch,
+                                                                 bool enable_watchdog)
+{
+  std::shared_ptr<RealtimePublisher<M>> pub(
+      new RealtimePublisher<M>(m_controller_nh, topic, queue_size, latch, decimation, &m_rt_pub_thread));
+  m_rt_pub.push_back(pub);
+  m_rt_pub_last.push_back(std::chrono::high_resolution_clock::time_point());
+  m_rt_pub_time_track.push_back(enable_watchdog);
+  m_rt_pub_thread.add(pub);
+
+  RealtimePublisherHandle<M> handle;
+  handle.idx = m_rt_pub.size()-1;
+  handle.pub = pub.get();
+  return handle;
+}
+
+template<typename T> template<typename M>
+bool Controller<T>::publish_realtime(const RealtimePublisherHandle<M>& handle, const M& message)
+{
+  // no trace and no message built here: this is called in doUpdate()
+  if(!handle.pub)
+  {
+    return false;
+  }
+
+  const size_t& idx = handle.idx;
+  bool ok = handle.pub->publish(message);
+  if(m_rt_pub_time_track[idx])
+  {
+    auto n = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> time_span = n - m_rt_pub_last[idx];
+    bool first = m_rt_pub_last[idx] == std::chrono::high_resolution_clock::time_point();
+    m_rt_pub_last[idx] = n;
+    ok &= first || (time_span.count() <= m_watchdog);
+  }
+  return ok;
+}
+
+template<typename T> template<typename M>
+std::shared_ptr<RealtimePublisher<M>> Controller<T>::getRealtimePublisher(const size_t& idx)
+{
+  return idx < m_rt_pub.size() ? std::dynamic_pointer_cast<RealtimePublisher<M>>(m_rt_pub.at(idx)) : nullptr;
+}
+
 
 template<typename T> template<typename M>
 bool Controller<T>::publish(const size_t& idx, const M& message)
@@ -672,15 +844,12 @@ bool Controller<T>::publish(const size_t& idx, const boost::shared_ptr<M>& messa
   if(m_pub_time_track.at(idx))
   {
     auto n = std::chrono::high_resolution_clock::now();
-    if(m_pub_start.at(idx) == nullptr)
+    if(m_pub_last.at(idx) == std::chrono::high_resolution_clock::time_point())
     {
-      m_pub_start.at(idx) = new std::chrono::high_resolution_clock::time_point();
-      *m_pub_start.at(idx) = n;
-      m_pub_last.at(idx) = new std::chrono::high_resolution_clock::time_point();
-      *m_pub_last.at(idx) = n;
+      m_pub_last.at(idx) = n;
     }
-    std::chrono::duration<double> time_span = (n -  *m_pub_last.at(idx));
-    *m_pub_last.at(idx)  = n;
+    std::chrono::duration<double> time_span = (n -  m_pub_last.at(idx));
+    m_pub_last.at(idx)  = n;
     if(time_span.count() > m_watchdog)
     {
       CNR_RETURN_FALSE(this->m_logger, "The publisher has not been called within the foreseen watchdog."
@@ -697,19 +866,85 @@ size_t Controller<T>::add_subscriber(const std::string &topic,
                                      boost::function<void(const boost::shared_ptr<M const>& msg)> callback,
                                      bool enable_watchdog)
 {
+  std::shared_ptr<TopicArrival> arrival = m_topic_watchdog.add(m_controller_nh.resolveName(topic), enable_watchdog);
+  boost::function<void(const boost::shared_ptr<M const>& msg)> stamped_callback =
+      [this, arrival, callback](const boost::shared_ptr<M const>& msg)
+      {
+        arrival->received(m_cycle_time_ns.load(std::memory_order_relaxed));
+        callback(msg);
+      };
   std::shared_ptr<ros_helper::SubscriptionNotifier<M> > sub(
-        new ros_helper::SubscriptionNotifier<M>(m_controller_nh, topic, queue_size, callback) );
+        new ros_helper::SubscriptionNotifier<M>(m_controller_nh, topic, queue_size, stamped_callback) );
 
   m_sub_notifier.push_back( sub );                    // it's needed to destroy memeory only when ~Controller is called.
                                                       // the trick of using std::shared_ptr<void> allows to do not care
                                                       // with the template type of the object
   m_sub.push_back(sub->getSubscriber());
-  m_sub_time.push_back(sub->getMsgReceivedTime());
-  m_sub_time_track.push_back(enable_watchdog);
+  m_mailbox.push_back(nullptr);
 
   return m_sub.size()-1;
 }
 
+template<typename T> template<typename M>
+MailboxHandle<M> Controller<T>::add_mailbox_subscriber(const std::string &topic, uint32_t queue_size,
+                                                       bool enable_watchdog)
+{
+  std::shared_ptr<Mailbox<M>> mailbox(new Mailbox<M>());
+  std::shared_ptr<TopicArrival> arrival = m_topic_watchdog.add(m_controller_nh.resolveName(topic), enable_watchdog);
+  boost::function<void(const boost::shared_ptr<M const>& msg)> callback =
+      [this, mailbox, arrival](const boost::shared_ptr<M const>& msg)
+      {
+        mailbox->write(*msg);
+        arrival->received(m_cycle_time_ns.load(std::memory_order_relaxed));
+      };
+
+  // same namespace and remapping of the controller nh, served by the spinner instead of the RT loop
+  ros::NodeHandle nh(m_controller_nh);
+  nh.setCallbackQueue(&m_mailbox_callback_queue);
+  std::shared_ptr<ros_helper::SubscriptionNotifier<M> > sub(
+        new ros_helper::SubscriptionNotifier<M>(nh, topic, queue_size, callback) );
+
+  m_sub_notifier.push_back( sub );
+  m_sub.push_back(sub->getSubscriber());
+  m_mailbox.push_back(mailbox);
+
+  if(!m_mailbox_spinner)
+  {
+    m_mailbox_spinner.reset(new ros::AsyncSpinner(1, &m_mailbox_callback_queue));
+    m_mailbox_spinner->start();
+  }
+
+  MailboxHandle<M> handle;
+  handle.idx = m_sub.size()-1;
+  handle.mailbox = mailbox.get();
+  return handle;
+}
+
+template<typename T> template<typename M>
+const M* Controller<T>::read_mailbox(const MailboxHandle<M>& handle, bool* fresh)
+{
+  if(!handle.mailbox)
+  {
+    if(fresh)
+    {
+      *fresh = false;
+    }
+    return nullptr;
+  }
+  return handle.mailbox->read(fresh);
+}
+
+template<class T>
+TrackerHandle Controller<T>::addTimeTrackerHandle(const std::string& name, const double& period)
+{
+#if CNR_LEAN_INSTRUMENTATION
+  return TrackerHandle();
+#else
+  realtime_utilities::DiagnosticsInterface::addTimeTracker(name, period);
+  return TrackerHandle(realtime_utilities::DiagnosticsInterface::timeSpanStrakcer(name));
+#endif
+}
+
 template<class T>
 std::shared_ptr<ros::Subscriber> Controller<T>::getSubscriber(const size_t& idx)
 {
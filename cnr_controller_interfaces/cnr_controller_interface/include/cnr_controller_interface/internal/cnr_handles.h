@@ -2,6 +2,8 @@
 #define CNR_CONTROLLER_INTERFACE__CNR_HANDLES__H
 
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <rosdyn_chain_state/chain_state.h>
 #include <hardware_interface/joint_state_interface.h>
 #include <hardware_interface/joint_command_interface.h>
@@ -30,18 +32,109 @@ typedef const std::shared_ptr<HandleIndexes const> HandleIndexesConstPtr;
 
 HandleIndexes get_index_map(const std::vector<std::string>& names, const rosdyn::Chain& ks);
 
+/**
+ * @brief The handles are resolved once (init()) in structure-of-arrays form, ordered as the active joints of the chain:
+ * the chain index of each handle, and the raw pointers to the state of the hw. The flush() and the update() are
+ * then gather/scatter loops over contiguous arrays, without lookups by name and without allocations.
+ */
 struct HandlerBase
 {
   bool initialized_ = false;
   HandleIndexes indexes_;
 
+  std::vector<size_t>        index_;     //!< chain index of the k-th resolved handle
+  std::vector<const double*> position_;
+  std::vector<const double*> velocity_;
+  std::vector<const double*> effort_;
+
+  //! It returns the handles ordered as index_ (e.g., to resolve the command pointers)
   template<class H>
-  void init(const std::map<std::string, H>& resources, const rosdyn::Chain& chain)
+  std::vector<H> init(const std::map<std::string, H>& resources, const rosdyn::Chain& chain)
   {
     std::vector<std::string> names(resources.size());
     std::transform(resources.begin(), resources.end(), names.begin(), [](const std::pair<std::string, H>& p) { return p.first; });
     indexes_ = get_index_map(names,chain);
+
+    std::vector<H> ordered;
+    index_.clear();
+    position_.clear();
+    velocity_.clear();
+    effort_.clear();
+    for(size_t iAx=0; iAx<chain.getActiveJointsNumber(); iAx++)
+    {
+      auto it = resources.find(chain.getActiveJointName(iAx));
+      if(it == resources.end())
+      {
+        continue;
+      }
+      ordered.push_back(it->second);
+      index_.push_back(iAx);
+      position_.push_back(it->second.getPositionPtr());
+      velocity_.push_back(it->second.getVelocityPtr());
+      effort_.push_back(it->second.getEffortPtr());
+    }
     initialized_ = true;
+    return ordered;
+  }
+
+  void gather(const std::vector<const double*>& src, rosdyn::VectorXd& dst) const
+  {
+    double* out = dst.data();
+    for(size_t k=0; k<index_.size(); k++)
+    {
+      out[index_[k]] = *src[k];
+    }
+  }
+
+  void fill(const double& value, rosdyn::VectorXd& dst) const
+  {
+    double* out = dst.data();
+    for(size_t k=0; k<index_.size(); k++)
+    {
+      out[index_[k]] = value;
+    }
+  }
+
+  void scatter(const rosdyn::VectorXd& src, const std::vector<double*>& dst) const
+  {
+    const double* in = src.data();
+    for(size_t k=0; k<index_.size(); k++)
+    {
+      *dst[k] = in[index_[k]];
+    }
+  }
+
+  //! position, velocity and effort from the hw, zero acceleration
+  void flushState(rosdyn::ChainState& ks) const
+  {
+    gather(position_, ks.q());
+    gather(velocity_, ks.qd());
+    fill(0.0, ks.qdd());
+    gather(effort_, ks.effort());
+  }
+};
+
+/**
+ * @brief The handlers of the hardware_interface::JointHandle, that carry a single command
+ */
+struct JointHandleHandlerBase : public HandlerBase
+{
+  std::map<std::string, hardware_interface::JointHandle> handles_;
+  std::vector<double*> command_;  //!< ordered as index_
+
+  void init(const rosdyn::Chain& chain)
+  {
+    command_.clear();
+    for(hardware_interface::JointHandle& handle : HandlerBase::init(handles_, chain))
+    {
+      command_.push_back(handle.getCommandPtr());
+    }
+  }
+
+  void flush(rosdyn::ChainState& ks, const rosdyn::Chain& chain)
+  {
+    if(!initialized_) init(chain);
+    flushState(ks);
   }
 };
 
@@ -51,6 +144,7 @@ struct Handler : public HandlerBase
 {
   std::map<std::string, Handle> handles_;
 
+  void init(const rosdyn::Chain& /*chain*/) { initialized_ = true; }
   void flush(rosdyn::ChainState& /*ks*/, const rosdyn::Chain& /*chain*/)  {}
   void update(const rosdyn::ChainState& /*ks*/, const rosdyn::Chain& /*chain*/) {}
 };
@@ -65,16 +159,15 @@ struct Handler<hardware_interface::JointStateHandle, hardware_interface::JointSt
 {
   std::map<std::string, hardware_interface::JointStateHandle> handles_;
 
+  void init(const rosdyn::Chain& chain)
+  {
+    HandlerBase::init(handles_, chain);
+  }
+
   void flush(rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      ks.q(ax.second) = handles_.at(ax.first).getPosition();
-      ks.qd(ax.second) = handles_.at(ax.first).getVelocity();
-      ks.qdd(ax.second) = 0.0;
-      ks.effort(ax.second) = handles_.at(ax.first).getEffort();
-    }
+    if(!initialized_) init(chain);
+    flushState(ks);
   }
 
   void update(const rosdyn::ChainState& /*ks*/, const rosdyn::Chain& /*chain*/)
@@ -90,26 +183,28 @@ template<>
 struct Handler<hardware_interface::VelEffJointHandle, hardware_interface::VelEffJointInterface> : public HandlerBase
 {
   std::map<std::string, hardware_interface::VelEffJointHandle> handles_;
+  std::vector<hardware_interface::VelEffJointHandle> axes_;  //!< ordered as index_
+
+  void init(const rosdyn::Chain& chain)
+  {
+    axes_ = HandlerBase::init(handles_, chain);
+  }
 
   void flush(rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const ax : indexes_)
-    {
-      ks.q(ax.second) = handles_.at(ax.first).getPosition();
-      ks.qd(ax.second) = handles_.at(ax.first).getVelocity();
-      ks.qdd(ax.second) = 0.0;
-      ks.effort(ax.second) = handles_.at(ax.first).getEffort();
-    }
+    if(!initialized_) init(chain);
+    flushState(ks);
   }
 
   void update(const rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
+    if(!initialized_) init(chain);
+    const double* qd  = ks.qd().data();
+    const double* eff = ks.effort().data();
+    for(size_t k=0; k<axes_.size(); k++)
     {
-      handles_.at(ax.first).setCommandVelocity(ks.qd(ax.second));
-      handles_.at(ax.first).setCommandEffort(ks.effort(ax.second));
+      axes_[k].setCommandVelocity(qd[index_[k]]);
+      axes_[k].setCommandEffort(eff[index_[k]]);
     }
   }
 };
@@ -121,29 +216,32 @@ template<>
 struct Handler<hardware_interface::PosVelEffJointHandle, hardware_interface::PosVelEffJointInterface> : public HandlerBase
 {
   std::map<std::string, hardware_interface::PosVelEffJointHandle> handles_;
+  std::vector<hardware_interface::PosVelEffJointHandle> axes_;  //!< ordered as index_
+
+  void init(const rosdyn::Chain& chain)
+  {
+    axes_ = HandlerBase::init(handles_, chain);
+  }
 
   void flush(rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      ks.q(ax.second) = handles_.at(ax.first).getPosition();
-      ks.qd(ax.second) = handles_.at(ax.first).getVelocity();
-      ks.qdd(ax.second) = 0.0;
-      ks.effort(ax.second) = handles_.at(ax.first).getEffort();
-    }
+    if(!initialized_) init(chain);
+    flushState(ks);
   }
 
 
   void update(const rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
+    if(!initialized_) init(chain);
+    const double* q   = ks.q().data();
+    const double* qd  = ks.qd().data();
+    const double* eff = ks.effort().data();
+    for(size_t k=0; k<axes_.size(); k++)
     {
-      size_t index = ax.second;
-      handles_.at(ax.first).setCommandPosition(ks.q(index));
-      handles_.at(ax.first).setCommandVelocity(ks.qd(index));
-      handles_.at(ax.first).setCommandEffort  (ks.effort(index));
+      const size_t index = index_[k];
+      axes_[k].setCommandPosition(q[index]);
+      axes_[k].setCommandVelocity(qd[index]);
+      axes_[k].setCommandEffort  (eff[index]);
     }
   }
 };
@@ -152,29 +250,12 @@ struct Handler<hardware_interface::PosVelEffJointHandle, hardware_interface::Pos
  * JointCommandInterface
  */
 template<>
-struct Handler<hardware_interface::JointHandle, hardware_interface::JointCommandInterface> : public HandlerBase
+struct Handler<hardware_interface::JointHandle, hardware_interface::JointCommandInterface> : public JointHandleHandlerBase
 {
-  std::map<std::string, hardware_interface::JointHandle> handles_;
-
-  void flush(rosdyn::ChainState& ks, const rosdyn::Chain& chain)
-  {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      ks.q(ax.second) = handles_.at(ax.first).getPosition();
-      ks.qd(ax.second) = handles_.at(ax.first).getVelocity();
-      ks.qdd(ax.second) = 0.0;
-      ks.effort(ax.second) = handles_.at(ax.first).getEffort();
-    }
-  }
-
   void update(const rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      handles_.at(ax.first).setCommand(ks.q(ax.second));
-    }
+    if(!initialized_) init(chain);
+    scatter(ks.q(), command_);
   }
 };
 
@@ -182,30 +263,12 @@ struct Handler<hardware_interface::JointHandle, hardware_interface::JointCommand
  * @brief EffortJointInterface
  */
 template<>
-struct Handler<hardware_interface::JointHandle, hardware_interface::EffortJointInterface> : public HandlerBase
+struct Handler<hardware_interface::JointHandle, hardware_interface::EffortJointInterface> : public JointHandleHandlerBase
 {
-  std::map<std::string, hardware_interface::JointHandle> handles_;
-
-  void flush(rosdyn::ChainState& ks, const rosdyn::Chain& chain)
-  {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      ks.q(ax.second) = handles_.at(ax.first).getPosition();
-      ks.qd(ax.second) = handles_.at(ax.first).getVelocity();
-      ks.qdd(ax.second) = 0.0;
-      ks.effort(ax.second) = handles_.at(ax.first).getEffort();
-    }
-  }
-
-
   void update(const rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      handles_.at(ax.first).setCommand(ks.effort(ax.second));
-    }
+    if(!initialized_) init(chain);
+    scatter(ks.effort(), command_);
   }
 };
 
@@ -213,31 +276,12 @@ struct Handler<hardware_interface::JointHandle, hardware_interface::EffortJointI
  * @brief VelocityJointInterface
  */
 template<>
-struct Handler<hardware_interface::JointHandle, hardware_interface::VelocityJointInterface> : public HandlerBase
+struct Handler<hardware_interface::JointHandle, hardware_interface::VelocityJointInterface> : public JointHandleHandlerBase
 {
-  std::map<std::string, hardware_interface::JointHandle> handles_;
-
-
-  void flush(rosdyn::ChainState& ks, const rosdyn::Chain& chain)
-  {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      ks.q(ax.second) = handles_.at(ax.first).getPosition();
-      ks.qd(ax.second) = handles_.at(ax.first).getVelocity();
-      ks.qdd(ax.second) = 0.0;
-      ks.effort(ax.second) = handles_.at(ax.first).getEffort();
-    }
-  }
-
-
   void update(const rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      handles_.at(ax.first).setCommand(ks.qd(ax.second));
-    }
+    if(!initialized_) init(chain);
+    scatter(ks.qd(), command_);
   }
 };
 
@@ -245,29 +289,12 @@ struct Handler<hardware_interface::JointHandle, hardware_interface::VelocityJoin
  * @brief PositionJointInterface
  */
 template<>
-struct Handler<hardware_interface::JointHandle, hardware_interface::PositionJointInterface> : public HandlerBase
+struct Handler<hardware_interface::JointHandle, hardware_interface::PositionJointInterface> : public JointHandleHandlerBase
 {
-  std::map<std::string, hardware_interface::JointHandle> handles_;
-
-  void flush(rosdyn::ChainState& ks, const rosdyn::Chain& chain)
-  {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      ks.q(ax.second) = handles_.at(ax.first).getPosition();
-      ks.qd(ax.second) = handles_.at(ax.first).getVelocity();
-      ks.qdd(ax.second) = 0.0;
-      ks.effort(ax.second) = handles_.at(ax.first).getEffort();
-    }
-  }
-
   void update(const rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      handles_.at(ax.first).setCommand(ks.q(ax.second));
-    }
+    if(!initialized_) init(chain);
+    scatter(ks.q(), command_);
   }
 };
 
@@ -278,26 +305,31 @@ template<>
 struct Handler<hardware_interface::PosVelJointHandle, hardware_interface::PosVelJointInterface> : public HandlerBase
 {
   std::map<std::string, hardware_interface::PosVelJointHandle> handles_;
+  std::vector<hardware_interface::PosVelJointHandle> axes_;  //!< ordered as index_
+
+  void init(const rosdyn::Chain& chain)
+  {
+    axes_ = HandlerBase::init(handles_, chain);
+  }
 
   void flush(rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
-    {
-      ks.q(ax.second) = handles_.at(ax.first).getPosition();
-      ks.qd(ax.second) = handles_.at(ax.first).getVelocity();
-      ks.qdd(ax.second) = 0.0;
-      ks.effort(ax.second) = 0.0;
-    }
+    if(!initialized_) init(chain);
+    gather(position_, ks.q());
+    gather(velocity_, ks.qd());
+    fill(0.0, ks.qdd());
+    fill(0.0, ks.effort());
   }
 
   void update(const rosdyn::ChainState& ks, const rosdyn::Chain& chain)
   {
-    if(!initialized_) init(handles_, chain);
-    for(auto const & ax : indexes_)
+    if(!initialized_) init(chain);
+    const double* q  = ks.q().data();
+    const double* qd = ks.qd().data();
+    for(size_t k=0; k<axes_.size(); k++)
     {
-      handles_.at(ax.first).setCommandPosition(ks.q(ax.second));
-      handles_.at(ax.first).setCommandVelocity(ks.qd(ax.second));
+      axes_[k].setCommandPosition(q[index_[k]]);
+      axes_[k].setCommandVelocity(qd[index_[k]]);
     }
   }
 };
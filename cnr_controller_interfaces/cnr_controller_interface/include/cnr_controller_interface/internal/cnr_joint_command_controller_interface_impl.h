@@ -37,6 +37,7 @@
 #ifndef CNR_CONTOLLER_INTERFACE__CNR_JOINT_COMMAND_CONTROLLER_INTERFACE_IMPL_H
 #define CNR_CONTOLLER_INTERFACE__CNR_JOINT_COMMAND_CONTROLLER_INTERFACE_IMPL_H
 
+#include <algorithm>
 #include <std_msgs/Int64.h>
 #include <ros/ros.h>
 #include <cnr_logger/cnr_logger.h>
@@ -53,56 +54,56 @@ namespace cnr
 namespace control
 {
 
-template<class H,class T>
-inline JointCommandController<H,T>::~JointCommandController()
+template<class H,class T,int N>
+inline JointCommandController<H,T,N>::~JointCommandController()
 {
   CNR_TRACE_START(this->m_logger);
   this->stopUpdateTransformationsThread();
   CNR_TRACE(this->m_logger, "OK");
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::doInit()
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::doInit()
 {
-  return cnr::control::JointController<H,T>::doInit();
+  return cnr::control::JointController<H,T,N>::doInit();
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::doStarting(const ros::Time& time)
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::doStarting(const ros::Time& time)
 {
-  return cnr::control::JointController<H,T>::doStarting(time);
+  return cnr::control::JointController<H,T,N>::doStarting(time);
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::doUpdate(const ros::Time& time, const ros::Duration& period)
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::doUpdate(const ros::Time& time, const ros::Duration& period)
 {
-  return cnr::control::JointController<H,T>::doUpdate(time,period);
+  return cnr::control::JointController<H,T,N>::doUpdate(time,period);
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::doStopping(const ros::Time& time)
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::doStopping(const ros::Time& time)
 {
   this->stopUpdateTransformationsThread();
-  return cnr::control::JointController<H,T>::doStopping(time);
+  return cnr::control::JointController<H,T,N>::doStopping(time);
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::doWaiting(const ros::Time& time)
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::doWaiting(const ros::Time& time)
 {
-  return cnr::control::JointController<H,T>::doWaiting(time);
+  return cnr::control::JointController<H,T,N>::doWaiting(time);
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::doAborting(const ros::Time& time)
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::doAborting(const ros::Time& time)
 {
-  return cnr::control::JointController<H,T>::doAborting(time);
+  return cnr::control::JointController<H,T,N>::doAborting(time);
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::enterInit()
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::enterInit()
 {
   CNR_TRACE_START(this->m_logger);
-  if(!JointController<H,T>::enterInit())
+  if(!JointController<H,T,N>::enterInit())
   {
     CNR_RETURN_FALSE(this->m_logger);
   }
@@ -110,13 +111,26 @@ inline bool JointCommandController<H,T>::enterInit()
   m_priority = QD_PRIORITY;
   m_target.init(this->chainNonConst());
   m_last_target.init(this->chainNonConst());
+  m_nominal_qd.setZero(this->nAx());
+  m_saturated_qd.setZero(this->nAx());
+
+  // all the buffers are sized here, the hand-over of the commands does not allocate
+  {
+    std::lock_guard<std::mutex> lock(m_cmd_mtx);
+    m_cmd_pending.resize(this->nAx());
+    m_cmd_pending.generation = 0;
+    m_cmd_buffer.reset(m_cmd_pending);
+  }
+  m_cmd_applied = 0;
+  m_cmd_snapshot.reset(m_cmd_pending);
+  m_target_kin_buffer.reset(m_target);
 
   this->template add_subscriber<std_msgs::Int64>("/speed_ovr" , 1,
-                     boost::bind(&JointCommandController<H,T>::overrideCallback, this, _1), false);
+                     boost::bind(&JointCommandController<H,T,N>::overrideCallback, this, _1), false);
   this->template add_subscriber<std_msgs::Int64>("/safe_ovr_1", 1,
-                     boost::bind(&JointCommandController<H,T>::safeOverrideCallback_1, this, _1), false);
+                     boost::bind(&JointCommandController<H,T,N>::safeOverrideCallback_1, this, _1), false);
   this->template add_subscriber<std_msgs::Int64>("/safe_ovr_2", 1,
-                 boost::bind(&JointCommandController<H,T>::safeOverrideCallback_2, this, _1), false);
+                 boost::bind(&JointCommandController<H,T,N>::safeOverrideCallback_2, this, _1), false);
 
   m_max_velocity_multiplier = 10;
   std::string what;
@@ -142,20 +156,26 @@ inline bool JointCommandController<H,T>::enterInit()
   CNR_RETURN_TRUE(this->m_logger);
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::enterStarting()
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::enterStarting()
 {
   CNR_TRACE_START(this->m_logger);
-  if(!JointController<H,T>::enterStarting())
+  if(!JointController<H,T,N>::enterStarting())
   {
     CNR_RETURN_FALSE(this->m_logger);
   }
 
+  m_update_thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
   m_target.setZero(this->chainNonConst());
   m_target.q() = this->getPosition();
   // m_last_target.copy(m_target, m_target.FULL_STATE);
 
+  // the commands set before the start are discarded, as the target is reset to the actual position
+  m_cmd_buffer.update();
+  m_cmd_applied = m_cmd_buffer.readBuffer().generation;
+
   this->m_handler.update(m_target, this->chain());
+  publishCommandSnapshot();
 
   CNR_INFO(this->m_logger, "Target at Start: Position: " << m_target.q().transpose() );
   CNR_INFO(this->m_logger, "Target at Start: Velocity: " << m_target.qd().transpose() );
@@ -166,76 +186,73 @@ inline bool JointCommandController<H,T>::enterStarting()
   CNR_RETURN_TRUE(this->m_logger);
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::enterUpdate()
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::enterUpdate()
 {
   CNR_TRACE_START_THROTTLE_DEFAULT(this->m_logger);
-  if(!JointController<H,T>::enterUpdate())
+  if(!JointController<H,T,N>::enterUpdate())
   {
     CNR_RETURN_FALSE(this->m_logger);
   }
+  m_update_thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
   m_last_target.copy(m_target, m_target.FULL_STATE);
+  mergeCommand();
+  if(m_target_kin_buffer.update())
+  {
+    m_target.copy(m_target_kin_buffer.readBuffer(), m_target.ONLY_CART);
+  }
   CNR_RETURN_TRUE_THROTTLE_DEFAULT(this->m_logger);
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::exitUpdate()
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::exitUpdate()
 #define SP std::fixed  << std::setprecision(5)
 #define TP(X) eigen_utils::to_string(X)
 {
-  std::stringstream report;
-  bool print_report = false;
+  bool nan_position = false;
+  bool nan_velocity = false;
+  bool saturated    = false;
+  bool failure      = false;
   double throttle_time = 1.0;
   CNR_TRACE_START_THROTTLE_DEFAULT(this->m_logger);
 
   try
   {
-    report << "==========\n";
-    report << "Priority           : " << std::to_string(m_priority) << "\n";
-    report << "upper limit        : " << TP(this->chain().getQMax()) << "\n";
-    report << "lower limit        : " << TP(this->chain().getQMin()) << "\n";
-    report << "Speed Limit        : " << TP(this->chain().getDQMax()) << "\n";
-    report << "Acceleration Limit : " << TP(this->chain().getDDQMax()) << "\n";
-    report << "----------\n";
     // ============================== ==============================
-    auto nominal_qd = m_target.q();
+    m_nominal_qd = m_target.q();
     if(m_priority == Q_PRIORITY)
     {
       if(std::isnan(eigen_utils::norm(m_target.q())))
       {
-        print_report = true;
-        report << "SAFETY CHECK - Received a position with nan values... superimposed to zero!\n";
+        nan_position = true;
         m_target.q() = m_last_target.q();
       }
-      // CNR_INFO(this->m_logger,"dif:"<<(m_target.q() - m_last_target.q()).transpose());
-      nominal_qd =(m_target.q() - m_last_target.q()) / this->m_dt.toSec();
+      m_nominal_qd =(m_target.q() - m_last_target.q()) / this->m_dt.toSec();
     }
     else if(m_priority == QD_PRIORITY)
     {
-      nominal_qd = m_target.qd();
-      if(std::isnan(eigen_utils::norm(nominal_qd)))
+      m_nominal_qd = m_target.qd();
+      if(std::isnan(m_nominal_qd.norm()))
       {
-        print_report = true;
-        eigen_utils::setZero(nominal_qd);
+        nan_velocity = true;
+        m_nominal_qd.setZero();
       }
     }
-    report << "Nominal command qd(input)  : " << TP(nominal_qd) << "\n";
-    report << "----------\n";
     // ============================== ==============================
 
 
     // ============================== ==============================
-    auto saturated_qd = nominal_qd;
+    m_saturated_qd = m_nominal_qd;
 
     if (m_priority != NONE)
     {
-      if(rosdyn::saturateSpeed(this->chain(), saturated_qd, m_last_target.qd(), m_last_target.q(),
-                                 this->m_sampling_period, m_max_velocity_multiplier, true, &report))
+      if(rosdyn::saturateSpeed(this->chain(), m_saturated_qd, m_last_target.qd(), m_last_target.q(),
+                                 this->m_sampling_period, m_max_velocity_multiplier, true, nullptr))
       {
-        print_report = true;
-        m_target.qd() = saturated_qd;
+        saturated = true;
+        m_target.qd() = m_saturated_qd;
       }
-      m_target.q()  = m_last_target.q() + saturated_qd * this->m_dt.toSec() +0.5*m_target.qdd()*std::pow(this->m_dt.toSec(),2.0);
+      m_target.q()  = m_last_target.q() + m_saturated_qd * this->m_dt.toSec() +0.5*m_target.qdd()*std::pow(this->m_dt.toSec(),2.0);
     }
     m_last_target.copy(m_target, m_target.ONLY_JOINT);
 
@@ -247,25 +264,52 @@ inline bool JointCommandController<H,T>::exitUpdate()
   }
   catch(...)
   {
-    CNR_WARN(this->m_logger,"something wrong in JointTargetFilter::update");
+    failure = true;
     m_target.q()  = m_last_target.q();
     eigen_utils::setZero(m_target.qd());
   }
 
-  report<< "q  trg: " << TP(m_target.q()) << "\n";
-  report<< "qd trg: " << TP(m_target.qd()) << "\n";
-  report<< "ef trg: " << TP(m_target.effort()) << "\n";
-  // CNR_WARN(this->m_logger,report.str());
   this->m_handler.update(m_target, this->chain());
+  publishCommandSnapshot();
 
-  // CNR_WARN(this->m_logger,"m_tgt:"<<TP(m_target.q()));
-  //for(size_t iAx=0; iAx<this->jointNames().size(); iAx++)
-  //{
-  //  report<< this->m_hw->getHandle(this->chain().getActiveJointName(iAx)) <<"\n";
-  //}
+  if(failure)
+  {
+    CNR_WARN(this->m_logger,"something wrong in JointTargetFilter::update");
+  }
+  // the report is formatted only when it is printed (at most once per 'throttle_time'), not at each cycle
+  // of a saturation
+  if((nan_position || nan_velocity || saturated) && (ros::WallTime::now() - m_last_report).toSec() >= throttle_time)
+  {
+    m_last_report = ros::WallTime::now();
+    std::stringstream report;
+    report << "==========\n";
+    report << "Priority           : " << std::to_string(m_priority) << "\n";
+    report << "upper limit        : " << TP(this->chain().getQMax()) << "\n";
+    report << "lower limit        : " << TP(this->chain().getQMin()) << "\n";
+    report << "Speed Limit        : " << TP(this->chain().getDQMax()) << "\n";
+    report << "Acceleration Limit : " << TP(this->chain().getDDQMax()) << "\n";
+    report << "----------\n";
+    if(nan_position)
+    {
+      report << "SAFETY CHECK - Received a position with nan values... superimposed to zero!\n";
+    }
+    if(nan_velocity)
+    {
+      report << "SAFETY CHECK - Received a velocity with nan values... superimposed to zero!\n";
+    }
+    report << "Nominal command qd(input)  : " << TP(m_nominal_qd) << "\n";
+    if(saturated)
+    {
+      report << "Saturated command qd       : " << TP(m_saturated_qd) << "\n";
+    }
+    report << "----------\n";
+    report<< "q  trg: " << TP(m_target.q()) << "\n";
+    report<< "qd trg: " << TP(m_target.qd()) << "\n";
+    report<< "ef trg: " << TP(m_target.effort()) << "\n";
+    CNR_WARN(this->m_logger, report.str());
+  }
 
-  CNR_WARN_COND_THROTTLE(this->m_logger, print_report, throttle_time, report.str() );
-  if(!JointController<H,T>::exitUpdate())
+  if(!JointController<H,T,N>::exitUpdate())
   {
     CNR_RETURN_FALSE(this->m_logger);
   }
@@ -275,8 +319,8 @@ inline bool JointCommandController<H,T>::exitUpdate()
 #undef SP
 }
 
-template<class H,class T>
-inline bool JointCommandController<H,T>::exitStopping()
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::exitStopping()
 {
   CNR_TRACE_START(this->m_logger);
 
@@ -286,8 +330,9 @@ inline bool JointCommandController<H,T>::exitStopping()
   }
   eigen_utils::setZero(m_target.qd());
   this->m_handler.update(m_target, this->chain());
+  publishCommandSnapshot();
 
-  if(!JointController<H,T>::exitStopping())
+  if(!JointController<H,T,N>::exitStopping())
   {
     CNR_RETURN_FALSE(this->m_logger);
   }
@@ -296,14 +341,14 @@ inline bool JointCommandController<H,T>::exitStopping()
   CNR_RETURN_TRUE(this->m_logger);
 }
 
-template<class H,class T>
-inline double JointCommandController<H,T>::getTargetOverride() const
+template<class H,class T,int N>
+inline double JointCommandController<H,T,N>::getTargetOverride() const
 {
   return m_override * m_safe_override_1 * m_safe_override_2;
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::overrideCallback(const std_msgs::Int64ConstPtr& msg)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::overrideCallback(const std_msgs::Int64ConstPtr& msg)
 {
   double ovr;
   if(msg->data > 100)
@@ -315,8 +360,8 @@ inline void JointCommandController<H,T>::overrideCallback(const std_msgs::Int64C
   m_override = ovr;
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::safeOverrideCallback_1(const std_msgs::Int64ConstPtr& msg)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::safeOverrideCallback_1(const std_msgs::Int64ConstPtr& msg)
 {
   double ovr;
   if(msg->data > 100)
@@ -328,8 +373,8 @@ inline void JointCommandController<H,T>::safeOverrideCallback_1(const std_msgs::
   m_safe_override_1 = ovr;
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::safeOverrideCallback_2(const std_msgs::Int64ConstPtr& msg)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::safeOverrideCallback_2(const std_msgs::Int64ConstPtr& msg)
 {
   double ovr;
   if(msg->data > 100)
@@ -341,184 +386,286 @@ inline void JointCommandController<H,T>::safeOverrideCallback_2(const std_msgs::
   m_safe_override_2 = ovr;
 }
 
-template<class H,class T>
-inline const rosdyn::ChainState& JointCommandController<H,T>::chainCommand() const
+template<class H,class T,int N>
+inline const rosdyn::ChainState& JointCommandController<H,T,N>::chainCommand() const
 {
   if(this->getKinUpdatePeriod()<=0)
     throw std::runtime_error("The 'kin_update_period' has not been set, and therefore the fkin is not computed!");
-
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_target;
 }
 
-template<class H,class T>
-inline rosdyn::ChainState& JointCommandController<H,T>::chainCommand()
+template<class H,class T,int N>
+inline rosdyn::ChainState& JointCommandController<H,T,N>::chainCommand()
 {
   if(this->getKinUpdatePeriod()<=0)
     throw std::runtime_error("The 'kin_update_period' has not been set, and therefore the fkin is not computed!");
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_target;
 }
 
-template<class H,class T>
-inline const rosdyn::VectorXd& JointCommandController<H,T>::getCommandPosition( ) const
+template<class H,class T,int N>
+inline rosdyn::VectorXd& JointCommandController<H,T,N>::commandField(JointCommandBlock::Field field)
+{
+  switch(field)
+  {
+    case JointCommandBlock::VELOCITY:     return m_target.qd();
+    case JointCommandBlock::ACCELERATION: return m_target.qdd();
+    case JointCommandBlock::EFFORT:       return m_target.effort();
+    default:                              return m_target.q();
+  }
+}
+
+template<class H,class T,int N>
+inline const rosdyn::VectorXd& JointCommandController<H,T,N>::commandField(JointCommandBlock::Field field) const
+{
+  switch(field)
+  {
+    case JointCommandBlock::VELOCITY:     return m_target.qd();
+    case JointCommandBlock::ACCELERATION: return m_target.qdd();
+    case JointCommandBlock::EFFORT:       return m_target.effort();
+    default:                              return m_target.q();
+  }
+}
+
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::mergeCommand()
+{
+  if(!m_cmd_buffer.update())
+  {
+    return;
+  }
+  const JointCommandBlock& cmd = m_cmd_buffer.readBuffer();
+  for(size_t f=0; f<JointCommandBlock::FIELDS; f++)
+  {
+    rosdyn::VectorXd& target = commandField(static_cast<JointCommandBlock::Field>(f));
+    for(size_t iAx=0; iAx<cmd.stamp[f].size(); iAx++)
+    {
+      if(cmd.stamp[f][iAx] > m_cmd_applied)
+      {
+        target(iAx) = cmd.value[f](iAx);
+      }
+    }
+  }
+  m_cmd_applied = cmd.generation;
+}
+
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::publishCommandSnapshot()
+{
+  m_cmd_snapshot.write([this](JointCommandBlock& snapshot)
+  {
+    snapshot.value[JointCommandBlock::POSITION]     = m_target.q();
+    snapshot.value[JointCommandBlock::VELOCITY]     = m_target.qd();
+    snapshot.value[JointCommandBlock::ACCELERATION] = m_target.qdd();
+    snapshot.value[JointCommandBlock::EFFORT]       = m_target.effort();
+    snapshot.generation = m_cmd_applied;
+  });
+}
+
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::getCommandSnapshot(rosdyn::VectorXd* q, rosdyn::VectorXd* qd,
+                                                            rosdyn::VectorXd* qdd, rosdyn::VectorXd* effort) const
+{
+  m_cmd_snapshot.read([&](const JointCommandBlock& snapshot)
+  {
+    if(q)      *q      = snapshot.value[JointCommandBlock::POSITION];
+    if(qd)     *qd     = snapshot.value[JointCommandBlock::VELOCITY];
+    if(qdd)    *qdd    = snapshot.value[JointCommandBlock::ACCELERATION];
+    if(effort) *effort = snapshot.value[JointCommandBlock::EFFORT];
+  });
+}
+
+template<class H,class T,int N>
+inline double JointCommandController<H,T,N>::getCommand(JointCommandBlock::Field field, size_t idx) const
+{
+  if(isUpdateThread())
+  {
+    return commandField(field)(idx);
+  }
+  double ret = 0;
+  m_cmd_snapshot.read([&](const JointCommandBlock& snapshot) { ret = snapshot.value[field](idx); });
+  return ret;
+}
+
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommand(JointCommandBlock::Field field, const rosdyn::VectorXd& in)
+{
+  if(isUpdateThread())
+  {
+    commandField(field) = in;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_cmd_mtx);
+  if(in.size() != m_cmd_pending.value[field].size())
+  {
+    CNR_ERROR_THROTTLE(this->m_logger, 1.0, "The command has " << in.size() << " values, while the controller has "
+                        << m_cmd_pending.value[field].size() << " axes. Command discarded.");
+    return;
+  }
+  m_cmd_pending.generation++;
+  m_cmd_pending.value[field] = in;
+  std::fill(m_cmd_pending.stamp[field].begin(), m_cmd_pending.stamp[field].end(), m_cmd_pending.generation);
+  m_cmd_buffer.writeBuffer() = m_cmd_pending;
+  m_cmd_buffer.publish();
+}
+
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommand(JointCommandBlock::Field field, const double& in, size_t idx)
+{
+  if(isUpdateThread())
+  {
+    commandField(field)(idx) = in;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_cmd_mtx);
+  if(idx >= m_cmd_pending.stamp[field].size())
+  {
+    CNR_ERROR_THROTTLE(this->m_logger, 1.0, "The command index " << idx << " is out of range. Command discarded.");
+    return;
+  }
+  m_cmd_pending.generation++;
+  m_cmd_pending.value[field](idx) = in;
+  m_cmd_pending.stamp[field][idx] = m_cmd_pending.generation;
+  m_cmd_buffer.writeBuffer() = m_cmd_pending;
+  m_cmd_buffer.publish();
+}
+
+template<class H,class T,int N>
+inline rosdyn::VectorXd JointCommandController<H,T,N>::getCommand(JointCommandBlock::Field field) const
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  return m_target.q();
+  if(isUpdateThread())
+  {
+    return commandField(field);
+  }
+  rosdyn::VectorXd ret;
+  m_cmd_snapshot.read([&](const JointCommandBlock& snapshot) { ret = snapshot.value[field]; });
+  return ret;
 }
 
-template<class H,class T>
-inline const rosdyn::VectorXd& JointCommandController<H,T>::getCommandVelocity( ) const
+template<class H,class T,int N>
+inline rosdyn::VectorXd JointCommandController<H,T,N>::getCommandPosition( ) const
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  return m_target.qd();
+  return getCommand(JointCommandBlock::POSITION);
 }
 
-template<class H,class T>
-inline const rosdyn::VectorXd& JointCommandController<H,T>::getCommandAcceleration( ) const
+template<class H,class T,int N>
+inline rosdyn::VectorXd JointCommandController<H,T,N>::getCommandVelocity( ) const
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  return m_target.qdd();
+  return getCommand(JointCommandBlock::VELOCITY);
 }
 
-template<class H,class T>
-inline const rosdyn::VectorXd& JointCommandController<H,T>::getCommandEffort( ) const
+template<class H,class T,int N>
+inline rosdyn::VectorXd JointCommandController<H,T,N>::getCommandAcceleration( ) const
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  return m_target.effort();
+  return getCommand(JointCommandBlock::ACCELERATION);
 }
 
-template<class H,class T>
-inline double JointCommandController<H,T>::getCommandPosition(size_t idx) const
+template<class H,class T,int N>
+inline rosdyn::VectorXd JointCommandController<H,T,N>::getCommandEffort( ) const
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  return m_target.q(idx);
+  return getCommand(JointCommandBlock::EFFORT);
 }
 
-template<class H,class T>
-inline double JointCommandController<H,T>::getCommandVelocity(size_t idx) const
+template<class H,class T,int N>
+inline double JointCommandController<H,T,N>::getCommandPosition(size_t idx) const
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  return m_target.qd(idx);
+  return getCommand(JointCommandBlock::POSITION, idx);
 }
 
-template<class H,class T>
-inline double JointCommandController<H,T>::getCommandAcceleration(size_t idx) const
+template<class H,class T,int N>
+inline double JointCommandController<H,T,N>::getCommandVelocity(size_t idx) const
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  return m_target.qdd(idx);
+  return getCommand(JointCommandBlock::VELOCITY, idx);
 }
 
-template<class H,class T>
-inline double JointCommandController<H,T>::getCommandEffort(size_t idx) const
+template<class H,class T,int N>
+inline double JointCommandController<H,T,N>::getCommandAcceleration(size_t idx) const
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  return m_target.effort(idx);
+  return getCommand(JointCommandBlock::ACCELERATION, idx);
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::setCommandPosition(const rosdyn::VectorXd& in)
+template<class H,class T,int N>
+inline double JointCommandController<H,T,N>::getCommandEffort(size_t idx) const
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  m_target.q() = in;
-  // CNR_INFO(this->m_logger,"q:"<<in.transpose());
+  return getCommand(JointCommandBlock::EFFORT, idx);
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::setCommandVelocity(const rosdyn::VectorXd& in)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommandPosition(const rosdyn::VectorXd& in)
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  m_target.qd()     = in;
+  setCommand(JointCommandBlock::POSITION, in);
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::setCommandAcceleration(const rosdyn::VectorXd& in)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommandVelocity(const rosdyn::VectorXd& in)
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  m_target.qdd()    = in;
+  setCommand(JointCommandBlock::VELOCITY, in);
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::setCommandEffort(const rosdyn::VectorXd& in)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommandAcceleration(const rosdyn::VectorXd& in)
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  m_target.effort() = in;
+  setCommand(JointCommandBlock::ACCELERATION, in);
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::setCommandPosition(const double& in, size_t idx)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommandEffort(const rosdyn::VectorXd& in)
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  m_target.q(idx) = in;
+  setCommand(JointCommandBlock::EFFORT, in);
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::setCommandVelocity(const double& in, size_t idx)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommandPosition(const double& in, size_t idx)
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  m_target.qd(idx) = in;
+  setCommand(JointCommandBlock::POSITION, in, idx);
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::setCommandAcceleration(const double& in, size_t idx)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommandVelocity(const double& in, size_t idx)
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  m_target.qdd(idx) = in;
+  setCommand(JointCommandBlock::VELOCITY, in, idx);
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::setCommandEffort(const double& in, size_t idx)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommandAcceleration(const double& in, size_t idx)
 {
-  std::lock_guard<std::mutex> lock(m_mtx);
-  m_target.effort(idx) = in;
+  setCommand(JointCommandBlock::ACCELERATION, in, idx);
 }
 
-template<class H,class T>
-inline void JointCommandController<H,T>::updateTransformationsThread(int ffwd_kin_type, double hz)
+template<class H,class T,int N>
+inline void JointCommandController<H,T,N>::setCommandEffort(const double& in, size_t idx)
 {
-  CNR_TRACE_START(this->logger());
-  rosdyn::ChainState rstate;
-  rosdyn::ChainState target;
+  setCommand(JointCommandBlock::EFFORT, in, idx);
+}
 
+template<class H,class T,int N>
+inline bool JointCommandController<H,T,N>::subscribeKinematics(int ffwd_kin_type, double hz)
+{
+  if(!JointController<H,T,N>::subscribeKinematics(ffwd_kin_type, hz))
   {
-    std::lock_guard<std::mutex> lock(this->mtx_);
-    if(!rstate.init(this->chainNonConst()))
-    {
-       CNR_FATAL(this->m_logger, "Chain failure!");
-       CNR_RETURN_NOTOK(this->m_logger, void());
-    }
-    if(!target.init(this->chainNonConst()))
-    {
-       CNR_FATAL(this->m_logger, "Chain failure!");
-       CNR_RETURN_NOTOK(this->m_logger, void());
-    }
+    return false;
   }
 
-  ros::Rate rt(hz);
-  while(!this->stop_update_transformations_)
-  {
+  // the target is specific of the controller, so it is never shared
+  size_t id = KinematicsService::instance().subscribe(this->getControllerNamespace() + "/target",
+    [this](rosdyn::LinkPtr& root_link, rosdyn::Chain& chain)
     {
-      //std::lock_guard<std::mutex> lock(this->mtx_);
-      rstate.copy(this->chainState(), this->chainState().ONLY_JOINT);
-      target.copy(this->m_target, this->m_target.ONLY_JOINT);
-    }
-    rstate.updateTransformations(this->chainNonConst(), ffwd_kin_type);
-    target.updateTransformations(this->chainNonConst(), ffwd_kin_type);
+      return this->buildChain(root_link, chain);
+    }, ffwd_kin_type, 1.0/hz,
+    [this](rosdyn::ChainState& target, ros::Time& /*stamp*/)
     {
-      //std::lock_guard<std::mutex> lock(this->mtx_);
-      this->chainState().copy(rstate, rstate.ONLY_CART);
-      this->m_target.copy(target, target.ONLY_CART);
-    }
-    if(!this->update_transformations_runnig_)
+      getCommandSnapshot(&target.q(), &target.qd(), &target.qdd(), &target.effort());
+    },
+    [this](const rosdyn::ChainState& target, const ros::Time& /*stamp*/)
     {
-      CNR_INFO(this->logger(), "First state & target update ;)"
-                  << "\nstate:\n" << std::to_string(this->chainState())
-                    << "\ntarget:\n" << std::to_string(this->m_target));
-      this->update_transformations_runnig_ = true;
-    }
-    rt.sleep();
+      m_target_kin_buffer.writeBuffer().copy(target, target.ONLY_CART);
+      m_target_kin_buffer.publish();
+    });
+  if(id == 0)
+  {
+    return false;
   }
-  CNR_RETURN_OK(this->m_logger, void());
+  this->kinematics_jobs_.push_back(id);
+  return true;
 }
 
 
@@ -57,53 +57,53 @@ namespace cnr
 namespace control
 {
 
-template<class H,class T>
-JointController<H,T>::~JointController()
+template<class H,class T,int N>
+JointController<H,T,N>::~JointController()
 {
   CNR_TRACE_START(this->m_logger);
   stopUpdateTransformationsThread();
   CNR_TRACE(this->m_logger, "OK");
 }
 
-template<class H,class T>
-bool JointController<H,T>::doInit()
+template<class H,class T,int N>
+bool JointController<H,T,N>::doInit()
 {
   m_fkin_update_period = -1.0;
   return cnr::control::Controller<T>::doInit();
 }
-template<class H,class T>
-bool JointController<H,T>::doStarting(const ros::Time& time)
+template<class H,class T,int N>
+bool JointController<H,T,N>::doStarting(const ros::Time& time)
 {
   return cnr::control::Controller<T>::doStarting(time);
 }
 
-template<class H,class T>
-bool JointController<H,T>::doUpdate(const ros::Time& time, const ros::Duration& period)
+template<class H,class T,int N>
+bool JointController<H,T,N>::doUpdate(const ros::Time& time, const ros::Duration& period)
 {
   return cnr::control::Controller<T>::doUpdate(time,period);
 }
 
-template<class H,class T>
-bool JointController<H,T>::doStopping(const ros::Time& time)
+template<class H,class T,int N>
+bool JointController<H,T,N>::doStopping(const ros::Time& time)
 {
   stopUpdateTransformationsThread();
   return cnr::control::Controller<T>::doStopping(time);
 }
 
-template<class H,class T>
-bool JointController<H,T>::doWaiting(const ros::Time& time)
+template<class H,class T,int N>
+bool JointController<H,T,N>::doWaiting(const ros::Time& time)
 {
   return cnr::control::Controller<T>::doWaiting(time);
 }
 
-template<class H,class T>
-bool JointController<H,T>::doAborting(const ros::Time& time)
+template<class H,class T,int N>
+bool JointController<H,T,N>::doAborting(const ros::Time& time)
 {
   return cnr::control::Controller<T>::doAborting(time);
 }
 
-template<class H,class T>
-bool JointController<H,T>::enterInit()
+template<class H,class T,int N>
+bool JointController<H,T,N>::enterInit()
 {
   std::string what;
   size_t l = __LINE__;
@@ -176,29 +176,44 @@ bool JointController<H,T>::enterInit()
       }
     }
 
-    std::string urdf_string;
-    if(!ros::param::get(robot_description_param, urdf_string))
+    std::string robot_description_planning_param;
+    if(!ru::get(this->getControllerNamespace() + "/robot_description_planning_param", robot_description_planning_param, what ) )
     {
-      CNR_ERROR(this->m_logger, "\nWeird error in getting the parameter '" << robot_description_param
-                  << "'. It was already checked the existence.\n");
-      CNR_RETURN_FALSE(this->m_logger);
+      if(!ru::get(this->getRootNamespace() + "/robot_description_planning_param", robot_description_planning_param, what ) )
+      {
+        CNR_ERROR(this->m_logger, "'Neither '" + this->getControllerNamespace()
+                  + "/robot_description_planning_param' " + "nor '" + this->getRootNamespace()
+                    + "/robot_description_param' are not in rosparam server.");
+        CNR_RETURN_FALSE(this->m_logger);
+      }
     }
-
-    m_urdf_model = urdf::parseURDF(urdf_string);
-    if(m_urdf_model == nullptr )
+    if(!ros::param::has(robot_description_planning_param))
     {
-      CNR_ERROR(this->m_logger, "Failing in parsing the URDF model from parameter '" + urdf_string + "'");
+      CNR_ERROR(this->m_logger, "The parameter '" << robot_description_planning_param <<
+                " does not exist(check the value of parameter '" << robot_description_planning_param <<"'");
       CNR_RETURN_FALSE(this->m_logger);
     }
 
-    NEW_HEAP(m_root_link, rosdyn::Link() );
-    m_root_link->fromUrdf(GET(m_urdf_model->root_link_));
+    // the URDF is parsed once per process, the controller builds its own tree and chain on it
     std::string error;
-    if(!m_chain.init(error,m_root_link,base_link, tool_link))
+    ChainTemplateConstPtr chain_template = ChainCache::instance().get(robot_description_param, base_link, tool_link,
+                                                                      robot_description_planning_param, error);
+    if(!chain_template)
+    {
+      CNR_ERROR(this->m_logger, error);
+      CNR_RETURN_FALSE(this->m_logger);
+    }
+    if(chain_template->limits_result==0)
+    {
+      CNR_WARN(this->m_logger, "Warning in setting the kin limits.: '" + chain_template->limits_warning + "'");
+    }
+    if(!chain_template->build(m_root_link, m_chain, error))
     {
-      CNR_ERROR(this->m_logger, "Failing in creating the Chain from the URDF model:\n\t" + error + "");
+      CNR_ERROR(this->m_logger, error);
       CNR_RETURN_FALSE(this->m_logger);
     }
+    m_chain_template = chain_template;
+    m_urdf_model     = chain_template->model;
     //=======================================
 
 
@@ -219,43 +234,37 @@ bool JointController<H,T>::enterInit()
       CNR_ERROR(this->m_logger, "Mismatch of the dimension of the chain names and the controlled joint names. Abort.");
       CNR_RETURN_FALSE(this->m_logger);
     }
-    //=======================================
-
-
-    //=======================================
-    // KINEMATICS LIMITS
-    //=======================================
-    std::string robot_description_planning_param;
-    if(!ru::get(this->getControllerNamespace() + "/robot_description_planning_param", robot_description_planning_param, what ) )
-    {
-      if(!ru::get(this->getRootNamespace() + "/robot_description_planning_param", robot_description_planning_param, what ) )
-      {
-        CNR_ERROR(this->m_logger, "'Neither '" + this->getControllerNamespace()
-                  + "/robot_description_planning_param' " + "nor '" + this->getRootNamespace()
-                    + "/robot_description_param' are not in rosparam server.");
-        CNR_RETURN_FALSE(this->m_logger);
-      }
-    }
-    if(!ros::param::has(robot_description_planning_param))
+    if((N != Eigen::Dynamic) && (m_chain.getActiveJointsNumber() != static_cast<unsigned int>(N)))
     {
-      CNR_ERROR(this->m_logger, "The parameter '" << robot_description_planning_param <<
-                " does not exist(check the value of parameter '" << robot_description_planning_param <<"'");
+      CNR_ERROR(this->m_logger, "The controller is compiled for " << N << " axes, while the chain has "
+                  << m_chain.getActiveJointsNumber() << " active joints. Abort.");
       CNR_RETURN_FALSE(this->m_logger);
     }
 
-    int res = m_chain.enforceLimitsFromRobotDescriptionParam(robot_description_planning_param, error);
-    if(res==-1)
-    {
-      CNR_ERROR(this->m_logger, "Failing in setting the kin limits. Error: '" + error + "'");
-      CNR_RETURN_FALSE(this->m_logger);
-    }
-    else if(res==0)
+    m_kin_key = this->getRootNamespace() + "|" + robot_description_param + "|" + base_link + "|" + tool_link;
+    for(const std::string& joint_name : joint_names)
     {
-      CNR_WARN(this->m_logger, "Warning in setting the kin limits.: '" + error + "'");
+      m_kin_key += "|" + joint_name;
     }
+    //=======================================
+
 
 l = __LINE__;
     m_rstate.init(m_chain);
+    {
+      StateSample sample;
+      sample.state.init(m_chain);
+      m_joint_snapshot.reset(sample);
+      m_kin_buffer.reset(sample);
+      m_kin_stamp = ros::Time(0);
+
+      CartesianSample cart;
+      cart.pose.setIdentity();
+      cart.twist.setZero();
+      cart.twistd.setZero();
+      cart.jacobian.setZero(6, m_chain.getActiveJointsNumber());
+      m_cart_snapshot.reset(cart);
+    }
 l = __LINE__;
     for(unsigned int iAx=0; iAx<m_chain.getActiveJointsNumber(); iAx++)
     {
@@ -285,6 +294,8 @@ l = __LINE__;
         "Controller '" + Controller<T>::getControllerNamespace() + std::string("'")
         + "The controlled joint named '" + m_chain.getActiveJointName(iAx) + "' is managed by hardware_interface");
     }
+    // the handles are resolved once, the flush() and update() of each cycle do not look them up
+    m_handler.init(m_chain);
     CNR_DEBUG(this->m_logger, "Q sup  : " << eigen_utils::to_string(m_chain.getQMax()  ));
     CNR_DEBUG(this->m_logger, "Q inf  : " << eigen_utils::to_string(m_chain.getQMin()  ));
     CNR_DEBUG(this->m_logger, "Qd max : " << eigen_utils::to_string(m_chain.getDQMax() ));
@@ -301,8 +312,8 @@ l = __LINE__;
   CNR_RETURN_TRUE(this->m_logger);
 }
 
-template<class H,class T>
-bool JointController<H,T>::enterStarting()
+template<class H,class T,int N>
+bool JointController<H,T,N>::enterStarting()
 {
   CNR_TRACE_START(this->m_logger);
   if(!Controller<T>::enterStarting())
@@ -316,6 +327,7 @@ bool JointController<H,T>::enterStarting()
   CNR_DEBUG(this->m_logger, "Last joint name: " << m_chain.getActiveJointsName().back() );
 
   m_handler.flush(m_rstate, m_chain);
+  publishJointState();
 
   CNR_DEBUG(this->m_logger, "Position: " << eigen_utils::to_string(m_rstate.q()) );
   CNR_DEBUG(this->m_logger, "Velocity: " << eigen_utils::to_string(m_rstate.qd()) );
@@ -324,8 +336,8 @@ bool JointController<H,T>::enterStarting()
   CNR_RETURN_TRUE(this->m_logger);
 }
 
-template<class H,class T>
-bool JointController<H,T>::exitStarting()
+template<class H,class T,int N>
+bool JointController<H,T,N>::exitStarting()
 {
   CNR_TRACE_START(this->m_logger);
 
@@ -342,8 +354,8 @@ bool JointController<H,T>::exitStarting()
   CNR_RETURN_TRUE(this->m_logger);
 }
 
-template<class H,class T>
-bool JointController<H,T>::enterUpdate()
+template<class H,class T,int N>
+bool JointController<H,T,N>::enterUpdate()
 {
   CNR_TRACE_START_THROTTLE_DEFAULT(this->m_logger);
   if(!Controller<T>::enterUpdate())
@@ -352,198 +364,283 @@ bool JointController<H,T>::enterUpdate()
   }
 
   m_handler.flush(m_rstate, m_chain);
+  publishJointState();
   // NOTE: the transformations may take time, especially due the pseudo inversion of the Jacobian, to estimate the external wrench.
-  // Therefore, they are executed in parallel
+  // Therefore, they are executed in parallel, and the last results are merged here
   //m_rstate.updateTransformations();
+  if(m_kin_buffer.update())
+  {
+    m_rstate.copy(m_kin_buffer.readBuffer().state, m_rstate.ONLY_CART);
+    m_kin_stamp = m_kin_buffer.readBuffer().stamp;
+    m_cart_snapshot.write([this](CartesianSample& cart)
+    {
+      cart.pose     = m_rstate.toolPose();
+      cart.twist    = m_rstate.toolTwist();
+      cart.twistd   = m_rstate.toolTwistd();
+      cart.jacobian = m_rstate.toolJacobian();
+      cart.stamp    = m_kin_stamp;
+    });
+  }
 
   CNR_RETURN_TRUE_THROTTLE_DEFAULT(this->m_logger);
 }
 
-template<class H,class T>
-inline bool JointController<H,T>::startUpdateTransformationsThread(int ffwd_kin_type, double hz)
+template<class H,class T,int N>
+inline bool JointController<H,T,N>::startUpdateTransformationsThread(int ffwd_kin_type, double hz)
 {
   CNR_TRACE_START(this->m_logger);
-  stop_update_transformations_ = false;
+  stopUpdateTransformationsThread();
   update_transformations_runnig_ = false;
-  CNR_DEBUG(this->logger(), "Creating the fkin update thread");
-  update_transformations_ = std::thread(
-        &JointController<H,T>::updateTransformationsThread, this, ffwd_kin_type, hz);
-  CNR_DEBUG(this->logger(), "Fkin Thread created");
-  
-  double timeout = 1.0;
-  ros::Time st = ros::Time::now();
-  while(!update_transformations_runnig_)
+  CNR_DEBUG(this->logger(), "Subscribing the fkin update to the kinematics service");
+  if(!subscribeKinematics(ffwd_kin_type, hz))
   {
-    ros::Duration(0.005).sleep();
-    if((ros::Time::now()-st).toSec()>timeout)
-    {
-      CNR_ERROR(this->m_logger,"The thread that updates the fkin didn't start within the timeout of "<< timeout << ". Abort");
-      CNR_RETURN_TRUE(this->m_logger);  
-    }
+    CNR_ERROR(this->m_logger,"The subscription of the fkin update failed (rate: " << hz << "Hz). Abort");
+    stopUpdateTransformationsThread();
+    CNR_RETURN_FALSE(this->m_logger);
   }
+
+  // no wait for the first fkin: this is called by starting(), i.e., on the RT loop thread (in lockstep, the
+  // ROS time does not even advance while the loop is blocked). The first results are merged by enterUpdate()
+  // as soon as they are published, and 'update_transformations_runnig_' is raised then
   CNR_RETURN_TRUE(this->m_logger);
 }
 
-template<class H,class T>
-inline void JointController<H,T>::stopUpdateTransformationsThread()
+template<class H,class T,int N>
+inline void JointController<H,T,N>::stopUpdateTransformationsThread()
 {
   CNR_TRACE_START(this->m_logger);
-  if(m_fkin_update_period>0)
+  for(const size_t& id : kinematics_jobs_)
   {
-    stop_update_transformations_ = true;
-    if(update_transformations_.joinable())
-      update_transformations_.join();
+    KinematicsService::instance().unsubscribe(id);
   }
+  kinematics_jobs_.clear();
   CNR_RETURN_OK(this->m_logger, void());
 }
 
-template<class H,class T>
-inline void JointController<H,T>::updateTransformationsThread(int ffwd_kin_type, double hz)
+template<class H,class T,int N>
+inline bool JointController<H,T,N>::subscribeKinematics(int ffwd_kin_type, double hz)
 {
-  CNR_TRACE_START(this->m_logger);
-  rosdyn::ChainState rstate;
+  size_t id = KinematicsService::instance().subscribe(m_kin_key,
+    [this](rosdyn::LinkPtr& root_link, rosdyn::Chain& chain)
+    {
+      return buildChain(root_link, chain);
+    }, ffwd_kin_type, 1.0/hz,
+    [this](rosdyn::ChainState& rstate, ros::Time& stamp)
+    {
+      getStateSnapshot(rstate, &stamp);
+    },
+    [this](const rosdyn::ChainState& rstate, const ros::Time& stamp)
+    {
+      publishKinematics(rstate, stamp);
+      update_transformations_runnig_ = true;
+    });
+  if(id == 0)
+  {
+    return false;
+  }
+  kinematics_jobs_.push_back(id);
+  return true;
+}
 
+template<class H,class T,int N>
+inline bool JointController<H,T,N>::buildChain(rosdyn::LinkPtr& root_link, rosdyn::Chain& chain) const
+{
+  std::string error;
+  if(!m_chain_template || !m_chain_template->build(root_link, chain, error))
   {
-    std::lock_guard<std::mutex> lock(this->mtx_);
-    if(!rstate.init(m_chain))
-    {
-       CNR_FATAL(this->m_logger, "Chain failure!");
-       CNR_RETURN_NOTOK(this->m_logger, void());
-    }
+    CNR_ERROR(this->m_logger, "Failed in building the chain: " << error);
+    return false;
   }
+  return chain.setInputJointsName(m_chain.getActiveJointsName()) == 1;
+}
 
-  ros::Rate rt(hz);
-  while(!stop_update_transformations_)
+template<class H,class T,int N>
+inline void JointController<H,T,N>::publishJointState()
+{
+  m_joint_snapshot.write([this](StateSample& sample)
   {
-    rstate.copy(m_rstate, m_rstate.ONLY_JOINT);
-    rstate.updateTransformations(m_chain, ffwd_kin_type);
-    m_rstate.copy(rstate, m_rstate.ONLY_CART);
+    sample.state.copy(m_rstate, m_rstate.ONLY_JOINT);
+    sample.stamp = this->cycleContext().time;
+  });
+}
 
-    if(!this->update_transformations_runnig_)
+template<class H,class T,int N>
+inline void JointController<H,T,N>::getStateSnapshot(rosdyn::ChainState& rstate, ros::Time* stamp) const
+{
+  m_joint_snapshot.read([&](const StateSample& sample)
+  {
+    rstate.copy(sample.state, rstate.ONLY_JOINT);
+    if(stamp)
     {
-      CNR_INFO(this->logger(), "First state update ;)");
-      this->update_transformations_runnig_ = true;
+      *stamp = sample.stamp;
     }
-    rt.sleep();
-  }
-  CNR_RETURN_OK(this->m_logger, void());
+  });
+}
+
+template<class H,class T,int N>
+inline void JointController<H,T,N>::publishKinematics(const rosdyn::ChainState& rstate, const ros::Time& stamp)
+{
+  StateSample& sample = m_kin_buffer.writeBuffer();
+  sample.state.copy(rstate, rstate.ONLY_CART);
+  sample.stamp = stamp;
+  m_kin_buffer.publish();
+}
+
+template<class H,class T,int N>
+inline ros::Duration JointController<H,T,N>::getKinematicsAge( ) const
+{
+  return m_kin_stamp.isZero() ? ros::Duration(-1.0) : this->cycleContext().time - m_kin_stamp;
+}
+
+template<class H,class T,int N>
+inline void JointController<H,T,N>::getKinematicsSnapshot(Eigen::Affine3d* pose, Eigen::Vector6d* twist,
+    Eigen::Vector6d* twistd, rosdyn::Matrix6Xd* jacobian, ros::Time* stamp) const
+{
+  if(m_fkin_update_period<=0)
+    throw std::runtime_error("The 'kin_update_period' has not been set, and therefore the fkin is not computed!");
+  m_cart_snapshot.read([&](const CartesianSample& cart)
+  {
+    if(pose)     *pose     = cart.pose;
+    if(twist)    *twist    = cart.twist;
+    if(twistd)   *twistd   = cart.twistd;
+    if(jacobian) *jacobian = cart.jacobian;
+    if(stamp)    *stamp    = cart.stamp;
+  });
+}
+
+template<class H,class T,int N>
+inline Eigen::Affine3d JointController<H,T,N>::getToolPoseSnapshot( ) const
+{
+  Eigen::Affine3d ret;
+  getKinematicsSnapshot(&ret);
+  return ret;
+}
+
+template<class H,class T,int N>
+inline Eigen::Vector6d JointController<H,T,N>::getTwistSnapshot( ) const
+{
+  Eigen::Vector6d ret;
+  getKinematicsSnapshot(nullptr, &ret);
+  return ret;
+}
+
+template<class H,class T,int N>
+inline Eigen::Vector6d JointController<H,T,N>::getTwistdSnapshot( ) const
+{
+  Eigen::Vector6d ret;
+  getKinematicsSnapshot(nullptr, nullptr, &ret);
+  return ret;
+}
+
+template<class H,class T,int N>
+inline rosdyn::Matrix6Xd JointController<H,T,N>::getJacobianSnapshot( ) const
+{
+  rosdyn::Matrix6Xd ret;
+  getKinematicsSnapshot(nullptr, nullptr, nullptr, &ret);
+  return ret;
 }
 
-template<class H,class T>
-inline const rosdyn::Chain& JointController<H,T>::chain() const
+template<class H,class T,int N>
+inline const rosdyn::Chain& JointController<H,T,N>::chain() const
 {
   return m_chain;
 }
 
-template<class H,class T>
-inline rosdyn::Chain& JointController<H,T>::chainNonConst()
+template<class H,class T,int N>
+inline rosdyn::Chain& JointController<H,T,N>::chainNonConst()
 {
   return m_chain;
 }
 
-template<class H,class T>
-inline const rosdyn::ChainState& JointController<H,T>::chainState() const
+template<class H,class T,int N>
+inline const rosdyn::ChainState& JointController<H,T,N>::chainState() const
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate;
 }
 
-template<class H,class T>
-inline rosdyn::ChainState& JointController<H,T>::chainState()
+template<class H,class T,int N>
+inline rosdyn::ChainState& JointController<H,T,N>::chainState()
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate;
 }
 
-template<class H,class T>
-inline const rosdyn::VectorXd& JointController<H,T>::getPosition( ) const
+template<class H,class T,int N>
+inline const rosdyn::VectorXd& JointController<H,T,N>::getPosition( ) const
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.q();
 }
 
-template<class H,class T>
-inline const rosdyn::VectorXd& JointController<H,T>::getVelocity( ) const
+template<class H,class T,int N>
+inline const rosdyn::VectorXd& JointController<H,T,N>::getVelocity( ) const
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.qd();
 }
 
-template<class H,class T>
-inline const rosdyn::VectorXd& JointController<H,T>::getAcceleration( ) const
+template<class H,class T,int N>
+inline const rosdyn::VectorXd& JointController<H,T,N>::getAcceleration( ) const
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.qdd();
 }
 
-template<class H,class T>
-inline const rosdyn::VectorXd& JointController<H,T>::getEffort( ) const
+template<class H,class T,int N>
+inline const rosdyn::VectorXd& JointController<H,T,N>::getEffort( ) const
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.effort();
 }
 
-template<class H,class T>
-inline double JointController<H,T>::getPosition(int idx) const
+template<class H,class T,int N>
+inline double JointController<H,T,N>::getPosition(int idx) const
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.q(idx);
 }
 
-template<class H,class T>
-inline double JointController<H,T>::getVelocity(int idx) const
+template<class H,class T,int N>
+inline double JointController<H,T,N>::getVelocity(int idx) const
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.qd(idx);
 }
 
-template<class H,class T>
-inline double JointController<H,T>::getAcceleration(int idx) const
+template<class H,class T,int N>
+inline double JointController<H,T,N>::getAcceleration(int idx) const
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.qdd(idx);
 }
 
-template<class H,class T>
-inline double JointController<H,T>::getEffort(int idx) const
+template<class H,class T,int N>
+inline double JointController<H,T,N>::getEffort(int idx) const
 {
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.effort(idx);
 }
 
-template<class H,class T>
-inline const Eigen::Affine3d& JointController<H,T>::getToolPose( ) const
+template<class H,class T,int N>
+inline const Eigen::Affine3d& JointController<H,T,N>::getToolPose( ) const
 {
   if(m_fkin_update_period<=0)
     throw std::runtime_error("The 'kin_update_period' has not been set, and therefore the fkin is not computed!");
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.toolPose();
 }
 
-template<class H,class T>
-inline const Eigen::Vector6d& JointController<H,T>::getTwist( ) const
+template<class H,class T,int N>
+inline const Eigen::Vector6d& JointController<H,T,N>::getTwist( ) const
 {
   if(m_fkin_update_period<=0)
     throw std::runtime_error("The 'kin_update_period' has not been set, and therefore the fkin is not computed!");
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.toolTwist();
 }
 
-template<class H,class T>
-inline const Eigen::Vector6d& JointController<H,T>::getTwistd( ) const
+template<class H,class T,int N>
+inline const Eigen::Vector6d& JointController<H,T,N>::getTwistd( ) const
 {
   if(m_fkin_update_period<=0)
     throw std::runtime_error("The 'kin_update_period' has not been set, and therefore the fkin is not computed!");
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.toolTwistd();
 }
 
-template<class H,class T>
-inline const rosdyn::Matrix6Xd& JointController<H,T>::getJacobian( ) const
+template<class H,class T,int N>
+inline const rosdyn::Matrix6Xd& JointController<H,T,N>::getJacobian( ) const
 {
   if(m_fkin_update_period<=0)
     throw std::runtime_error("The 'kin_update_period' has not been set, and therefore the fkin is not computed!");
-  std::lock_guard<std::mutex> lock(this->mtx_);
   return m_rstate.toolJacobian();
 }
 
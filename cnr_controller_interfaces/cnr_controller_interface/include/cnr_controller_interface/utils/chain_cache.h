@@ -0,0 +1,111 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE__UTILS__CHAIN_CACHE__H
+#define CNR_CONTROLLER_INTERFACE__UTILS__CHAIN_CACHE__H
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+
+#include <urdf_model/model.h>
+#include <rosdyn_core/primitives.h>
+
+namespace cnr
+{
+namespace control
+{
+
+/**
+ * @brief URDF parsed from the robot description, and the chain to build on it
+ *
+ * It is immutable once in the cache. The rosdyn Joints of a tree cache their transformations, hence the
+ * tree is never shared: each user builds its own tree and chain with build().
+ */
+struct ChainTemplate
+{
+  urdf::ModelInterfaceSharedPtr model;
+  std::string                   base_link;
+  std::string                   tool_link;
+  std::string                   limits_param;
+  int                           limits_result = 1;  //!< value returned by enforceLimitsFromRobotDescriptionParam
+  std::string                   limits_warning;     //!< message of the enforcement, if limits_result is 0
+
+  /** @brief Non-RT. It builds a private Link/Joint tree from 'model', and the chain on it with the limits enforced
+   * @return false if the chain cannot be built or the limits cannot be enforced
+   */
+  bool build(rosdyn::LinkPtr& root_link, rosdyn::Chain& chain, std::string& error) const;
+};
+typedef std::shared_ptr<const ChainTemplate> ChainTemplateConstPtr;
+
+/**
+ * @brief Process-wide cache of the chains used by the controllers
+ *
+ * The URDF is parsed, and the chain is validated, once per (robot description, base link, tool link, limits
+ * param): the robot description and the limits are identified by the hash of their content as well, so that
+ * a new description or new limits uploaded on the same params are parsed again. The entries are held by the
+ * controllers, and they are released with the last one.
+ */
+class ChainCache
+{
+public:
+  static ChainCache& instance();
+
+  ChainCache(const ChainCache&) = delete;
+  ChainCache& operator=(const ChainCache&) = delete;
+
+  /** @brief It returns the template of the chain, nullptr if the URDF or the chain are not valid
+   * @param[in] robot_description_param param with the URDF
+   * @param[in] limits_param param with the 'joint_limits' enforced on the chain
+   */
+  ChainTemplateConstPtr get(const std::string& robot_description_param,
+                            const std::string& base_link,
+                            const std::string& tool_link,
+                            const std::string& limits_param,
+                            std::string& error);
+
+  size_t size() const;
+
+private:
+  ChainCache() = default;
+
+  mutable std::mutex                                  m_mtx;
+  std::map<std::string, std::weak_ptr<ChainTemplate>> m_templates;
+};
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE__UTILS__CHAIN_CACHE__H
@@ -0,0 +1,133 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE__UTILS__KINEMATICS_SERVICE__H
+#define CNR_CONTROLLER_INTERFACE__UTILS__KINEMATICS_SERVICE__H
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <ros/time.h>
+#include <rosdyn_core/primitives.h>
+#include <rosdyn_chain_state/chain_state.h>
+#include <cnr_controller_interface_params/periodic_worker_pool.h>
+
+namespace cnr
+{
+namespace control
+{
+
+/**
+ * @brief Process-wide service that computes the kinematics of the controllers on a fixed pool of workers
+ *
+ * The controllers subscribe a job (in place of a thread per controller). The jobs with the same key (i.e.,
+ * the same chain fed by the same joint state) and the same kinematics type are grouped, and each group is
+ * computed once, from the joint state of its first subscriber, at the fastest rate requested by its
+ * subscribers; the result is written to all of them. The CPU time scales with the number of distinct chains.
+ *
+ * A group computes on its own chain and tree, run by one job at a time, hence with no lock on the kinematics:
+ * the subscribers only exchange the joint state (Reader) and the result (Writer) with it.
+ *
+ * The pool is configured at the first use from '/kinematics_service/workers' (default 1) and
+ * '/kinematics_service/cpu_affinity' (default: no constraint), so that the workers can be kept off the RT cores.
+ */
+class KinematicsService
+{
+public:
+  //! It fills the joint part of 'rstate', and the time of that joint state
+  typedef std::function<void(rosdyn::ChainState& rstate, ros::Time& stamp)> Reader;
+  //! It receives the state with the Cartesian part computed
+  typedef std::function<void(const rosdyn::ChainState& rstate, const ros::Time& stamp)> Writer;
+  //! It builds a chain of the subscriber on a new Link/Joint tree
+  typedef std::function<bool(rosdyn::LinkPtr& root_link, rosdyn::Chain& chain)> Builder;
+
+  static KinematicsService& instance();
+
+  KinematicsService(const KinematicsService&) = delete;
+  KinematicsService& operator=(const KinematicsService&) = delete;
+
+  /** @brief It returns the id of the subscription, 0 if the period is not positive or the chain cannot be built
+   * The group computes on its own chain, made by 'builder' of the subscriber that creates it: the Joints of a
+   * tree cache their transformations, so the tree of a chain is used by one thread only
+   */
+  size_t subscribe(const std::string& key, const Builder& builder, const int& ffwd_kin_type,
+                   const double& period, const Reader& reader, const Writer& writer);
+
+  //! It blocks while the group is computed, the writer is never called after the return
+  void unsubscribe(const size_t& id);
+
+  size_t groups() const;
+  size_t subscriptions() const;
+
+private:
+  KinematicsService();
+
+  struct Member
+  {
+    size_t         id;
+    double         period;
+    Reader         reader;
+    Writer         writer;
+  };
+
+  struct Group
+  {
+    std::mutex          mtx;
+    std::vector<Member> members;
+    rosdyn::LinkPtr     root_link;
+    rosdyn::Chain       chain;
+    rosdyn::ChainState  state;
+    int                 ffwd_kin_type = 0;
+    double              period = 0;
+    size_t              job = 0;
+  };
+
+  static void run(Group& group);
+  static double period(const Group& group);
+
+  mutable std::mutex                            m_mtx;
+  std::map<std::string, std::shared_ptr<Group>> m_groups;
+  std::map<size_t, std::string>                 m_subscriptions;  //!< id -> key of the group
+  size_t                                        m_next_id = 1;
+  PeriodicWorkerPool                            m_pool;
+};
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE__UTILS__KINEMATICS_SERVICE__H
@@ -0,0 +1,89 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE__UTILS__TRACKER_HANDLE__H
+#define CNR_CONTROLLER_INTERFACE__UTILS__TRACKER_HANDLE__H
+
+#include <realtime_utilities/time_span_tracker.h>
+
+//! Lean build profile: the time trackers are neither registered nor ticked (CMake option LEAN_INSTRUMENTATION)
+#include <cnr_controller_interface/utils/lean_instrumentation.h>
+
+namespace cnr
+{
+namespace control
+{
+
+/**
+ * @brief Handle of a time tracker, resolved once when the tracker is registered
+ *
+ * tick() and tock() go straight to the tracker, without the lookup by name of timeSpanStrakcer().
+ * A default-constructed handle does nothing, and in the lean build profile all the handles are empty.
+ */
+class TrackerHandle
+{
+public:
+  TrackerHandle() = default;
+  explicit TrackerHandle(const realtime_utilities::TimeSpanTrackerPtr& tracker) : m_tracker(tracker) {}
+
+  void tick() const
+  {
+#if !CNR_LEAN_INSTRUMENTATION
+    if (m_tracker)
+    {
+      m_tracker->tick();
+    }
+#endif
+  }
+
+  void tock() const
+  {
+#if !CNR_LEAN_INSTRUMENTATION
+    if (m_tracker)
+    {
+      m_tracker->tock();
+    }
+#endif
+  }
+
+  explicit operator bool() const { return m_tracker != nullptr; }
+
+private:
+  realtime_utilities::TimeSpanTrackerPtr m_tracker;
+};
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE__UTILS__TRACKER_HANDLE__H
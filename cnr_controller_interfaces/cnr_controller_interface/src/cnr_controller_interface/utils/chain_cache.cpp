@@ -0,0 +1,157 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <iterator>
+#include <functional>
+#include <ros/param.h>
+#include <urdf_parser/urdf_parser.h>
+#include <cnr_controller_interface/utils/chain_cache.h>
+
+namespace cnr
+{
+namespace control
+{
+
+namespace
+{
+bool build_chain(const ChainTemplate& tmpl, rosdyn::LinkPtr& root_link, rosdyn::Chain& chain,
+                 int& limits_result, std::string& limits_warning, std::string& error)
+{
+  NEW_HEAP(root_link, rosdyn::Link());
+  root_link->fromUrdf(GET(tmpl.model->root_link_));
+  if (!chain.init(error, root_link, tmpl.base_link, tmpl.tool_link))
+  {
+    error = "Failing in creating the Chain from the URDF model:\n\t" + error;
+    return false;
+  }
+
+  limits_result = chain.enforceLimitsFromRobotDescriptionParam(tmpl.limits_param, limits_warning);
+  if (limits_result == -1)
+  {
+    error = "Failing in setting the kin limits. Error: '" + limits_warning + "'";
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+ChainCache& ChainCache::instance()
+{
+  static ChainCache cache;
+  return cache;
+}
+
+ChainTemplateConstPtr ChainCache::get(const std::string& robot_description_param,
+                                      const std::string& base_link,
+                                      const std::string& tool_link,
+                                      const std::string& limits_param,
+                                      std::string& error)
+{
+  std::string urdf_string;
+  if (!ros::param::get(robot_description_param, urdf_string))
+  {
+    error = "The parameter '" + robot_description_param + "' is not in rosparam server";
+    return nullptr;
+  }
+
+  // the limits are identified by their content as well, so that new limits on the same param are enforced again
+  std::string limits_string;
+  XmlRpc::XmlRpcValue limits;
+  if (ros::param::get(limits_param, limits))
+  {
+    limits_string = limits.toXml();
+  }
+
+  const std::string key = std::to_string(std::hash<std::string>()(urdf_string)) + "/"
+                        + std::to_string(urdf_string.size()) + "|" + base_link + "|" + tool_link + "|" + limits_param
+                        + "|" + std::to_string(std::hash<std::string>()(limits_string)) + "/"
+                        + std::to_string(limits_string.size());
+
+  std::lock_guard<std::mutex> lock(m_mtx);
+  std::shared_ptr<ChainTemplate> ret = m_templates[key].lock();
+  if (ret)
+  {
+    return ret;
+  }
+
+  ret.reset(new ChainTemplate());
+  ret->model = urdf::parseURDF(urdf_string);
+  if (!ret->model)
+  {
+    error = "Failing in parsing the URDF model from parameter '" + robot_description_param + "'";
+    m_templates.erase(key);
+    return nullptr;
+  }
+  ret->base_link    = base_link;
+  ret->tool_link    = tool_link;
+  ret->limits_param = limits_param;
+
+  // the chain is built once to validate the template, and to record the result of the enforcement of the limits
+  rosdyn::LinkPtr root_link;
+  rosdyn::Chain chain;
+  if (!build_chain(*ret, root_link, chain, ret->limits_result, ret->limits_warning, error))
+  {
+    m_templates.erase(key);
+    return nullptr;
+  }
+
+  // drop the entries released by all the controllers
+  for (auto it = m_templates.begin(); it != m_templates.end();)
+  {
+    it = (it->first != key && it->second.expired()) ? m_templates.erase(it) : std::next(it);
+  }
+  m_templates[key] = ret;
+  return ret;
+}
+
+bool ChainTemplate::build(rosdyn::LinkPtr& root_link, rosdyn::Chain& chain, std::string& error) const
+{
+  int limits_result = 1;
+  std::string limits_warning;
+  return build_chain(*this, root_link, chain, limits_result, limits_warning, error);
+}
+
+size_t ChainCache::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  size_t ret = 0;
+  for (const auto& it : m_templates)
+  {
+    ret += it.second.expired() ? 0 : 1;
+  }
+  return ret;
+}
+
+}  // namespace control
+}  // namespace cnr
@@ -0,0 +1,188 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <limits>
+#include <algorithm>
+#include <ros/param.h>
+#include <cnr_controller_interface/utils/kinematics_service.h>
+
+namespace cnr
+{
+namespace control
+{
+
+KinematicsService& KinematicsService::instance()
+{
+  static KinematicsService service;
+  return service;
+}
+
+KinematicsService::KinematicsService()
+{
+  int workers = 1;
+  std::vector<int> cpus;
+  ros::param::get("/kinematics_service/workers", workers);
+  ros::param::get("/kinematics_service/cpu_affinity", cpus);
+  std::string error;
+  if (!m_pool.configure(workers > 0 ? static_cast<size_t>(workers) : 1, cpus, error))
+  {
+    m_pool.configure(1, cpus, error);
+  }
+}
+
+double KinematicsService::period(const Group& group)
+{
+  double ret = std::numeric_limits<double>::max();
+  for (const Member& member : group.members)
+  {
+    ret = std::min(ret, member.period);
+  }
+  return ret;
+}
+
+void KinematicsService::run(Group& group)
+{
+  std::lock_guard<std::mutex> lock(group.mtx);
+  if (group.members.empty())
+  {
+    return;
+  }
+  ros::Time stamp;
+  group.members.front().reader(group.state, stamp);
+  group.state.updateTransformations(group.chain, group.ffwd_kin_type);
+  for (Member& member : group.members)
+  {
+    member.writer(group.state, stamp);
+  }
+}
+
+size_t KinematicsService::subscribe(const std::string& key, const Builder& builder, const int& ffwd_kin_type,
+                                    const double& period, const Reader& reader, const Writer& writer)
+{
+  if (period <= 0)
+  {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(m_mtx);
+  const std::string group_key = key + "#" + std::to_string(ffwd_kin_type);
+  std::shared_ptr<Group>& group = m_groups[group_key];
+  const bool created = !group;
+  if (created)
+  {
+    group.reset(new Group());
+    group->ffwd_kin_type = ffwd_kin_type;
+    if (!builder(group->root_link, group->chain))
+    {
+      m_groups.erase(group_key);
+      return 0;
+    }
+    group->state.init(group->chain);
+  }
+
+  const size_t id = m_next_id++;
+  {
+    std::lock_guard<std::mutex> group_lock(group->mtx);
+    group->members.push_back(Member{id, period, reader, writer});
+    group->period = KinematicsService::period(*group);
+  }
+  m_subscriptions[id] = group_key;
+
+  if (created)
+  {
+    std::shared_ptr<Group> g = group;
+    group->job = m_pool.add([g]() { KinematicsService::run(*g); }, group->period);
+  }
+  else
+  {
+    m_pool.setPeriod(group->job, group->period);
+  }
+  return id;
+}
+
+void KinematicsService::unsubscribe(const size_t& id)
+{
+  std::shared_ptr<Group> group;
+  bool empty = false;
+  double period = 0;
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    auto it = m_subscriptions.find(id);
+    if (it == m_subscriptions.end())
+    {
+      return;
+    }
+    group = m_groups.at(it->second);
+    {
+      std::lock_guard<std::mutex> group_lock(group->mtx);
+      group->members.erase(std::remove_if(group->members.begin(), group->members.end(),
+                                          [&id](const Member& m) { return m.id == id; }), group->members.end());
+      empty = group->members.empty();
+      if (!empty)
+      {
+        group->period = KinematicsService::period(*group);
+        period = group->period;
+      }
+    }
+    if (empty)
+    {
+      m_groups.erase(it->second);
+    }
+    m_subscriptions.erase(it);
+  }
+
+  // outside the lock: remove() waits for the running job, that takes only the lock of the group
+  if (empty)
+  {
+    m_pool.remove(group->job);
+  }
+  else
+  {
+    m_pool.setPeriod(group->job, period);
+  }
+}
+
+size_t KinematicsService::groups() const
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_groups.size();
+}
+
+size_t KinematicsService::subscriptions() const
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_subscriptions.size();
+}
+
+}  // namespace control
+}  // namespace cnr
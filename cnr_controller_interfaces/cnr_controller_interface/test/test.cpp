@@ -33,6 +33,7 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <thread>
 #include <iostream>
 #include <ros/ros.h>
 #include <cnr_logger/cnr_logger.h>
@@ -42,6 +43,7 @@
 #include <cnr_controller_interface/cnr_controller_interface.h>
 #include <cnr_controller_interface/cnr_joint_controller_interface.h>
 #include <cnr_controller_interface/cnr_joint_command_controller_interface.h>
+#include <cnr_controller_interface/utils/chain_cache.h>
 
 std::shared_ptr<ros::NodeHandle> root_nh;
 std::shared_ptr<ros::NodeHandle> robot_nh;
@@ -52,11 +54,21 @@ std::shared_ptr<cnr::control::Controller<hardware_interface::JointStateInterface
 
 using JointController = cnr::control::JointController<hardware_interface::JointStateHandle,hardware_interface::JointStateInterface>;
 using JointCommandController = cnr::control::JointCommandController<hardware_interface::PosVelEffJointHandle,hardware_interface::PosVelEffJointInterface>;
+using JointController6 = cnr::control::JointController<hardware_interface::JointStateHandle,hardware_interface::JointStateInterface, 6>;
+using JointCommandController6 = cnr::control::JointCommandController<hardware_interface::PosVelEffJointHandle,hardware_interface::PosVelEffJointInterface, 6>;
 
-std::shared_ptr<JointController >        jc_ctrl_x;
-std::shared_ptr<JointController >        jc_ctrl_6;
-std::shared_ptr<JointCommandController > jc_ctrl_cmd_x;
-std::shared_ptr<JointCommandController > jc_ctrl_cmd_6;
+//! it exposes the command setters/getters, that are protected
+class CommandControllerTester : public JointCommandController
+{
+public:
+  using JointCommandController::setCommandEffort;
+  using JointCommandController::getCommandEffort;
+};
+
+std::shared_ptr<JointController >         jc_ctrl_x;
+std::shared_ptr<JointController6 >        jc_ctrl_6;
+std::shared_ptr<JointCommandController >  jc_ctrl_cmd_x;
+std::shared_ptr<JointCommandController6 > jc_ctrl_cmd_6;
 
 std::string to_string(const std::vector<std::string>& vv)
 {
@@ -83,6 +95,90 @@ TEST(TestSuite, Handles)
   std::cout << "!VelEffJointInterface    :" << to_string(robot_hw->get<hardware_interface::VelEffJointInterface    >()->getNames()) << std::endl;
 }
 
+//! the same URDF is parsed once, and it is released with the last user; each chain is built on its own tree
+TEST(TestSuite, ChainCache)
+{
+  std::string error;
+  cnr::control::ChainTemplateConstPtr a = cnr::control::ChainCache::instance().get(
+        "/robot_description", "base_link", "tool0", "/robot_description_planning", error);
+  ASSERT_TRUE(a != nullptr) << error;
+  cnr::control::ChainTemplateConstPtr b = cnr::control::ChainCache::instance().get(
+        "/robot_description", "base_link", "tool0", "/robot_description_planning", error);
+  EXPECT_EQ(a.get(), b.get());
+  EXPECT_EQ(cnr::control::ChainCache::instance().size(), 1u);
+  EXPECT_TRUE(cnr::control::ChainCache::instance().get(
+        "/robot_description", "base_link", "not_a_link", "/robot_description_planning", error) == nullptr);
+
+  rosdyn::LinkPtr root_a, root_b;
+  rosdyn::Chain chain_a, chain_b;
+  ASSERT_TRUE(a->build(root_a, chain_a, error)) << error;
+  ASSERT_TRUE(b->build(root_b, chain_b, error)) << error;
+  EXPECT_NE(root_a.get(), root_b.get());
+  EXPECT_EQ(chain_a.getActiveJointsName(), chain_b.getActiveJointsName());
+
+  // new content on the same limits param builds a new chain
+  ros::param::set("/robot_description_planning/chain_cache_test", 1.0);
+  cnr::control::ChainTemplateConstPtr c = cnr::control::ChainCache::instance().get(
+        "/robot_description", "base_link", "tool0", "/robot_description_planning", error);
+  ros::param::del("/robot_description_planning/chain_cache_test");
+  ASSERT_TRUE(c != nullptr) << error;
+  EXPECT_NE(a.get(), c.get());
+  EXPECT_EQ(cnr::control::ChainCache::instance().size(), 2u);
+
+  a.reset();
+  b.reset();
+  c.reset();
+  EXPECT_EQ(cnr::control::ChainCache::instance().size(), 0u);
+}
+
+//! the handles (a map ordered by name) are gathered/scattered on the order of the chain
+TEST(TestSuite, HandlerOrder)
+{
+  std::string error;
+  cnr::control::ChainTemplateConstPtr tmpl = cnr::control::ChainCache::instance().get(
+        "/robot_description", "base_link", "tool0", "/robot_description_planning", error);
+  ASSERT_TRUE(tmpl != nullptr) << error;
+  rosdyn::LinkPtr root_link;
+  rosdyn::Chain chain;
+  ASSERT_TRUE(tmpl->build(root_link, chain, error)) << error;
+  const size_t n = chain.getActiveJointsNumber();
+  ASSERT_EQ(n, 6u);
+
+  std::vector<double> pos(n), vel(n), eff(n), cmd(n, 0.0);
+  cnr::control::Handler<hardware_interface::JointHandle, hardware_interface::PositionJointInterface> handler;
+  for(size_t iAx=0; iAx<n; iAx++)
+  {
+    // the value encodes the chain index of the joint
+    pos.at(iAx) = 1.0 + iAx;
+    vel.at(iAx) = 10.0 + iAx;
+    eff.at(iAx) = 100.0 + iAx;
+    hardware_interface::JointStateHandle state(chain.getActiveJointName(iAx), &pos.at(iAx), &vel.at(iAx), &eff.at(iAx));
+    handler.handles_[chain.getActiveJointName(iAx)] = hardware_interface::JointHandle(state, &cmd.at(iAx));
+  }
+  ASSERT_NE(handler.handles_.begin()->first, chain.getActiveJointName(0));  // the orders differ
+  handler.init(chain);
+
+  rosdyn::ChainState ks;
+  ks.init(chain);
+  handler.flush(ks, chain);
+  for(size_t iAx=0; iAx<n; iAx++)
+  {
+    EXPECT_EQ(ks.q()(iAx), 1.0 + iAx);
+    EXPECT_EQ(ks.qd()(iAx), 10.0 + iAx);
+    EXPECT_EQ(ks.effort()(iAx), 100.0 + iAx);
+  }
+
+  for(size_t iAx=0; iAx<n; iAx++)
+  {
+    ks.q()(iAx) = -1.0 - iAx;
+  }
+  handler.update(ks, chain);
+  for(size_t iAx=0; iAx<n; iAx++)
+  {
+    EXPECT_EQ(cmd.at(iAx), -1.0 - iAx) << chain.getActiveJointName(iAx);
+  }
+}
+
 // Declare a test
 TEST(TestSuite, GenericControllerConstructor)
 {
@@ -100,9 +196,9 @@ TEST(TestSuite, JointControllerXConstructor)
 
 TEST(TestSuite, JointController6Constructor)
 {
-  EXPECT_NO_FATAL_FAILURE(jc_ctrl_x.reset(new JointController()));
-  //EXPECT_FALSE(jc_ctrl_x->init(robot_hw->get<hardware_interface::JointStateInterface>(), *root_nh, *robot_nh));
-  EXPECT_TRUE(jc_ctrl_x->init(robot_hw->get<hardware_interface::JointStateInterface>(), *robot_nh, *ctrl_nh));
+  EXPECT_NO_FATAL_FAILURE(jc_ctrl_6.reset(new JointController6()));
+  //EXPECT_FALSE(jc_ctrl_6->init(robot_hw->get<hardware_interface::JointStateInterface>(), *root_nh, *robot_nh));
+  EXPECT_TRUE(jc_ctrl_6->init(robot_hw->get<hardware_interface::JointStateInterface>(), *robot_nh, *ctrl_nh));
 }
 
 TEST(TestSuite, JointCommandControllerXConstructor)
@@ -114,11 +210,58 @@ TEST(TestSuite, JointCommandControllerXConstructor)
 
 TEST(TestSuite, JointCommandControllerC6Constructor)
 {
-  EXPECT_NO_FATAL_FAILURE(jc_ctrl_cmd_6.reset(new JointCommandController()));
+  EXPECT_NO_FATAL_FAILURE(jc_ctrl_cmd_6.reset(new JointCommandController6()));
   //EXPECT_FALSE(jc_ctrl_6->init(robot_hw->get<hardware_interface::PosVelEffJointInterface>(), *root_nh, *robot_nh));
   EXPECT_TRUE(jc_ctrl_cmd_6->init(robot_hw->get<hardware_interface::PosVelEffJointInterface>(), *robot_nh, *ctrl_nh));
 }
 
+//! the setters called from a non-update thread are merged at the next update, once and in generation order
+TEST(TestSuite, CommandMerge)
+{
+  // driven as the controller manager does, so that the controller is RUNNING and its update merges the commands
+  std::shared_ptr<CommandControllerTester> tester(new CommandControllerTester());
+  controller_interface::ControllerBase* base = tester.get();
+  controller_interface::ControllerBase::ClaimedResources claimed_resources;
+  ASSERT_TRUE(base->initRequest(robot_hw.get(), *robot_nh, *ctrl_nh, claimed_resources));
+  const ros::Duration period(0.001);
+  ASSERT_TRUE(base->startRequest(ros::Time::now()));  // this thread is the update thread from now on
+  ASSERT_TRUE(base->isRunning());
+
+  std::thread producer([&tester]
+  {
+    tester->setCommandEffort(1.0, 0);
+    tester->setCommandEffort(2.0, 1);
+  });
+  producer.join();
+  EXPECT_EQ(tester->getCommandEffort()(0), 0.0);  // not merged yet
+  base->updateRequest(ros::Time::now(), period);
+  EXPECT_EQ(tester->getCommandEffort()(0), 1.0);
+  EXPECT_EQ(tester->getCommandEffort()(1), 2.0);
+
+  // set by the update thread: the block of the producer, already merged, must not override it
+  tester->setCommandEffort(5.0, 0);
+  base->updateRequest(ros::Time::now(), period);
+  EXPECT_EQ(tester->getCommandEffort()(0), 5.0);
+
+  // a newer generation only for the joint 1: the old value of the joint 0 in the block is not applied again
+  producer = std::thread([&tester] { tester->setCommandEffort(3.0, 1); });
+  producer.join();
+  base->updateRequest(ros::Time::now(), period);
+  EXPECT_EQ(tester->getCommandEffort()(0), 5.0);
+  EXPECT_EQ(tester->getCommandEffort()(1), 3.0);
+
+  // the other threads read the snapshot published at the end of the cycle, by value
+  rosdyn::VectorXd effort;
+  std::thread reader([&tester, &effort] { effort = tester->getCommandEffort(); });
+  reader.join();
+  ASSERT_EQ(effort.size(), 6);
+  EXPECT_EQ(effort(0), 5.0);
+  EXPECT_EQ(effort(1), 3.0);
+
+  EXPECT_TRUE(base->isRunning());  // no update failed
+  EXPECT_TRUE(base->stopRequest(ros::Time::now()));
+}
+
 TEST(TestSuite, Desctructor)
 {
   EXPECT_NO_FATAL_FAILURE(ctrl.reset());
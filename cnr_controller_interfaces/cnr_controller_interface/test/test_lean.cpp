@@ -0,0 +1,61 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <memory>
+#include <gtest/gtest.h>
+#include <hardware_interface/joint_state_interface.h>
+#include <cnr_controller_interface/cnr_controller_interface.h>
+
+static_assert(CNR_LEAN_INSTRUMENTATION == 1, "the lean test must see the lean profile");
+
+//! in the lean profile the time trackers are not registered, and the handles are empty
+TEST(TestSuite, LeanTrackerHandle)
+{
+  std::shared_ptr<cnr::control::Controller<hardware_interface::JointStateInterface> > ctrl;
+  EXPECT_NO_FATAL_FAILURE(ctrl.reset(new cnr::control::Controller<hardware_interface::JointStateInterface>()));
+
+  cnr::control::TrackerHandle handle = ctrl->addTimeTrackerHandle("lean", 0.001);
+  EXPECT_FALSE(handle);
+  EXPECT_NO_FATAL_FAILURE(handle.tick());
+  EXPECT_NO_FATAL_FAILURE(handle.tock());
+
+  EXPECT_NO_FATAL_FAILURE(ctrl.reset());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
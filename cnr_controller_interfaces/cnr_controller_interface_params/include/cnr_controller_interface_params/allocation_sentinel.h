@@ -0,0 +1,143 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__ALLOCATION_SENTINEL__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__ALLOCATION_SENTINEL__H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace cnr
+{
+namespace control
+{
+
+//! Snapshot of an AllocationCounter
+struct AllocationCount
+{
+  uint64_t allocations = 0;
+  uint64_t frees       = 0;
+  uint64_t bytes       = 0;
+};
+
+/**
+ * @brief Counter of the heap allocations (operator new) and frees (operator delete) done inside an AllocationScope
+ *
+ * The counters are relaxed atomics: they are written by the thread that opened the scope (the RT loop)
+ * and read by the diagnostics thread.
+ */
+struct AllocationCounter
+{
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> frees{0};
+  std::atomic<uint64_t> bytes{0};
+
+  AllocationCount get() const
+  {
+    AllocationCount ret;
+    ret.allocations = allocations.load(std::memory_order_relaxed);
+    ret.frees       = frees.load(std::memory_order_relaxed);
+    ret.bytes       = bytes.load(std::memory_order_relaxed);
+    return ret;
+  }
+
+  void reset()
+  {
+    allocations.store(0, std::memory_order_relaxed);
+    frees.store(0, std::memory_order_relaxed);
+    bytes.store(0, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief RAII: the allocations done by this thread while the scope is alive are added to 'counter'
+ *
+ * The scopes nest (up to MAX_DEPTH): an allocation in the update of a controller is counted both in the
+ * counter of the controller and in the one of the 'update' phase of the driver loop.
+ * If the sentinel is not enabled, the scope does nothing.
+ */
+class AllocationScope
+{
+public:
+  static constexpr int MAX_DEPTH = 8;
+
+  explicit AllocationScope(AllocationCounter* counter);
+  ~AllocationScope();
+  AllocationScope(const AllocationScope&) = delete;
+  AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+  bool m_pushed;
+};
+
+/**
+ * @brief Opt-in debug tool to check that the RT loop does not allocate
+ *
+ * The hooks in the global operator new/delete are compiled only if the package is built with
+ * -DALLOCATION_SENTINEL=ON. Otherwise, the API is available, but the counters stay at zero
+ * (and compiled() returns false).
+ * Raw malloc/free calls (e.g., from C libraries) are not tracked.
+ */
+namespace allocation_sentinel
+{
+
+//! True if the operator new/delete hooks are compiled in the library
+bool compiled();
+
+//! Enable/disable the counting (process-wide, reference counted: one enable() per driver)
+void enable();
+void disable();
+bool enabled();
+
+//! Non-RT: make a counter visible to the diagnostics (e.g., 'hw_name/ctrl_name')
+void registerCounter(const std::string& name, AllocationCounter* counter);
+void unregisterCounter(const std::string& name, AllocationCounter* counter);
+
+//! Non-RT: the registered counters whose name starts with 'prefix'
+std::vector<std::pair<std::string, AllocationCount>> registered(const std::string& prefix);
+
+//! Called by the hooks. Exposed for the RobotHW that use their own allocators
+void onAllocation(size_t bytes);
+void onFree();
+
+}  // namespace allocation_sentinel
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__ALLOCATION_SENTINEL__H
@@ -0,0 +1,174 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__CONTROLLER_COST__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__CONTROLLER_COST__H
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <ctime>
+#include <cstdint>
+
+namespace cnr
+{
+namespace control
+{
+
+//! Snapshot of a ControllerCost. The times are in ns
+struct ControllerCostSummary
+{
+  std::string name;
+  uint64_t    cycles          = 0;  //!< cycles of the loop seen by the controller (updated or skipped)
+  uint64_t    updates         = 0;
+  uint64_t    total           = 0;
+  double      mean            = 0.0;
+  int64_t     p50             = 0;
+  int64_t     p99             = 0;
+  int64_t     max             = 0;
+  uint64_t    deadline_misses = 0;  //!< cycles in which the update crossed the deadline of the loop
+  int64_t     budget          = 0;  //!< sampling period of the loop
+
+  //! Average fraction of the update budget of a cycle used by the controller
+  double share() const
+  {
+    return (cycles > 0 && budget > 0) ? static_cast<double>(total) / (static_cast<double>(cycles) * budget) : 0.0;
+  }
+};
+
+/**
+ * @brief Execution time of the updates of a controller, with a fixed-memory log-linear histogram
+ *
+ * Single writer at a time (the thread that runs the update: the loop, or a parallel worker, whose writes are
+ * ordered by the join of the cycle): tick() and record() are wait-free and they do not allocate.
+ * summary() can be called by any thread.
+ * The buckets are exact up to 16ns, then each power of two is split in 16 (relative error below ~6%, up to ~4s).
+ */
+class ControllerCost
+{
+public:
+  static constexpr unsigned SUB_BITS    = 4;
+  static constexpr unsigned MAX_BITS    = 32;
+  static constexpr size_t   SUB_BUCKETS = size_t(1) << SUB_BITS;
+  static constexpr size_t   BUCKETS     = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+  explicit ControllerCost(const int64_t& budget_ns = 0) { reset(budget_ns); }
+  ControllerCost(const ControllerCost&) = delete;
+  ControllerCost& operator=(const ControllerCost&) = delete;
+
+  //! Non-RT
+  void reset(const int64_t& budget_ns);
+
+  //! A cycle of the loop in which the controller is not updated (decimation, degraded loop)
+  void tick()
+  {
+    increment(m_cycles);
+  }
+
+  //! A cycle in which the controller is updated
+  void record(int64_t cost_ns, const bool& deadline_miss)
+  {
+    cost_ns = cost_ns < 0 ? 0 : cost_ns;
+    increment(m_cycles);
+    increment(m_updates);
+    increment(m_counts[index(static_cast<uint64_t>(cost_ns))]);
+    m_total.store(m_total.load(std::memory_order_relaxed) + static_cast<uint64_t>(cost_ns), std::memory_order_relaxed);
+    if (cost_ns > m_max.load(std::memory_order_relaxed))
+    {
+      m_max.store(cost_ns, std::memory_order_relaxed);
+    }
+    if (deadline_miss)
+    {
+      increment(m_deadline_misses);
+    }
+  }
+
+  ControllerCostSummary summary() const;
+
+  //! CLOCK_MONOTONIC [ns], the time base of CycleContext::stamp and CycleContext::deadline
+  static int64_t now()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+  }
+
+  static size_t index(const uint64_t& value)
+  {
+    if (value < SUB_BUCKETS)
+    {
+      return static_cast<size_t>(value);
+    }
+    const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(value));
+    if (msb >= MAX_BITS)
+    {
+      return BUCKETS - 1;
+    }
+    const unsigned shift = msb - SUB_BITS;
+    return static_cast<size_t>(shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+  }
+
+  //! The value reported for the percentiles falling into the bucket (upper bound) [ns]
+  static int64_t bucketUpperBound(const size_t& idx);
+
+private:
+  static void increment(std::atomic<uint64_t>& v)
+  {
+    v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  int64_t                                    m_budget = 0;
+  std::array<std::atomic<uint64_t>, BUCKETS> m_counts;
+  std::atomic<uint64_t>                      m_cycles{0};
+  std::atomic<uint64_t>                      m_updates{0};
+  std::atomic<uint64_t>                      m_total{0};
+  std::atomic<int64_t>                       m_max{0};
+  std::atomic<uint64_t>                      m_deadline_misses{0};
+};
+
+/**
+ * @brief Non-RT: make the cost of 'ctrl_name' visible to the diagnostics of the controller manager of 'hw_name'
+ * (same format of the hw name stored in the controllers)
+ */
+void register_controller_cost(const std::string& hw_name, const std::string& ctrl_name, ControllerCost* cost);
+void unregister_controller_cost(const std::string& hw_name, const std::string& ctrl_name, ControllerCost* cost);
+
+//! Non-RT: the costs of the controllers of 'hw_name', the most expensive first (total time)
+std::vector<ControllerCostSummary> controller_costs(const std::string& hw_name);
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__CONTROLLER_COST__H
@@ -0,0 +1,99 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__CYCLE_CONTEXT__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__CYCLE_CONTEXT__H
+
+#include <cstdint>
+#include <ros/time.h>
+#include <ros/duration.h>
+
+namespace cnr
+{
+namespace control
+{
+
+/**
+ * @brief Timing of a cycle of the RT loop, captured once by the driver when the cycle clock wakes up
+ *
+ * 'time' and 'period' are the arguments passed to read(), update() and write() of the cycle: the ROS time is
+ * taken once per cycle, and 'period' is the measured interval from the previous wake-up (not the nominal
+ * sampling period), so that the controllers can integrate on the actual dt.
+ * In the lockstep mode (see SimulatedHw), 'time' is the simulated clock and 'period' the nominal one.
+ */
+struct CycleContext
+{
+  uint64_t      cycle    = 0;  //!< index of the cycle since the start of the loop
+  int64_t       stamp    = 0;  //!< CLOCK_MONOTONIC at the wake-up [ns]
+  int64_t       deadline = 0;  //!< CLOCK_MONOTONIC deadline of the cycle [ns]
+  int64_t       dt       = 0;  //!< stamp minus the stamp of the previous cycle [ns], the nominal period at the first one
+  uint64_t      overruns = 0;  //!< cycles that overran the period since the start of the loop
+  uint64_t      missed   = 0;  //!< periods missed by the cycle clock before this cycle
+  ros::Time     time;          //!< ROS time of the cycle
+  ros::Duration period;        //!< 'dt' as a ros::Duration
+  bool          simulated = false;  //!< 'time' and 'period' come from the lockstep clock, 'stamp' is still wall-clock
+};
+
+/**
+ * @brief Opt-in interface of the RobotHW that wants the CycleContext in read() and write()
+ *
+ * If the RobotHW implements it, the driver calls readCycle()/writeCycle() in place of
+ * read(ctx.time, ctx.period)/write(ctx.time, ctx.period); the implementation is expected to forward to them.
+ * In the pipelined mode, they run in the I/O thread with the context of the cycle that triggered the I/O.
+ */
+class CycleAwareHw
+{
+public:
+  virtual ~CycleAwareHw() = default;
+
+  virtual void readCycle(const CycleContext& ctx) = 0;
+  virtual void writeCycle(const CycleContext& ctx) = 0;
+};
+
+/**
+ * @brief Opt-in interface of the RobotHW with no physical I/O (e.g., the FakeRobotHW)
+ *
+ * Only these RobotHWs can be run by the driver in the lockstep mode: the loop does not sleep, and it advances a
+ * simulated clock of one nominal period per cycle, as fast as the CPU allows.
+ */
+class SimulatedHw
+{
+public:
+  virtual ~SimulatedHw() = default;
+};
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__CYCLE_CONTEXT__H
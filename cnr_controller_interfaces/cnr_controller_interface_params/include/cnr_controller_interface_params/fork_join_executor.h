@@ -0,0 +1,175 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__FORK_JOIN_EXECUTOR__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__FORK_JOIN_EXECUTOR__H
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <semaphore.h>
+
+#include <cnr_controller_interface_params/realtime_buffers.h>
+
+namespace cnr
+{
+namespace control
+{
+
+/**
+ * @brief Pool of pre-spawned workers that run the updates of the controllers in parallel within a cycle
+ *
+ * The loop thread forks the tasks on the lanes, and it joins them before write(). The tasks of the same lane
+ * run serially on the same worker, in the order they are forked (the lane of a task is taken modulo the number
+ * of workers). A task can have a 'joined' callback, that join() calls on the loop thread once all the tasks are
+ * done (e.g., to act on a failure of the task). fork() and join() are RT-safe: they do not lock and do not
+ * allocate.
+ */
+class ForkJoinExecutor
+{
+public:
+  typedef void (*Task)(void* arg);
+  static constexpr size_t QUEUE_CAPACITY = 64;  //!< tasks per worker and per cycle
+
+  ForkJoinExecutor();
+  ~ForkJoinExecutor();
+  ForkJoinExecutor(const ForkJoinExecutor&) = delete;
+  ForkJoinExecutor& operator=(const ForkJoinExecutor&) = delete;
+
+  /** @brief Non-RT. Spawn the workers
+   * @param[in] thread_init called by each worker (with its index) before serving the tasks, e.g., to set the
+   * scheduling and the CPU affinity
+   */
+  bool start(const size_t& workers, const std::function<void(const size_t&)>& thread_init, std::string& error);
+  //! Non-RT. Join the workers; the forked tasks not yet executed are dropped
+  void stop();
+
+  size_t workers() const { return m_workers.size(); }
+
+  /** @brief RT. Queue the task on the lane. Single producer: to be called by the loop thread only
+   * @param[in] joined if not null, called with 'arg' by the next join(), on the loop thread
+   * @return false if the executor is not started or the queue of the lane is full (the caller runs the task)
+   */
+  bool fork(const size_t& lane, Task task, void* arg, Task joined = nullptr);
+
+  //! RT. Block until all the forked tasks are done, then call their 'joined' callbacks in the order of fork()
+  void join();
+
+private:
+  struct Job
+  {
+    Task  task = nullptr;
+    void* arg  = nullptr;
+  };
+  struct Worker
+  {
+    SpscQueue<Job, QUEUE_CAPACITY> queue;
+    sem_t                          wake;
+    std::thread                    thread;
+  };
+
+  void workerLoop(Worker* worker, const size_t& index, std::function<void(const size_t&)> thread_init);
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::vector<Job>                     m_joined;  //!< the 'joined' callbacks of the cycle (loop thread only)
+  std::atomic<int64_t>                 m_outstanding;
+  std::atomic<bool>                    m_stop;
+  sem_t                                m_done;
+};
+
+/**
+ * @brief The groups of the controllers of a hw, in use by its loop
+ *
+ * register_claims() and unregister_claims() only publish the new groups: the loop swaps them in with swap() at
+ * the start of a cycle, when no update is forked, so that the controllers forked in the same cycle always see
+ * a consistent mapping.
+ */
+class ClaimGroups
+{
+public:
+  /** @brief RT. Apply the groups published since the last call. To be called by the loop thread between cycles
+   *
+   * It does not block: if a registration is in progress, the groups are swapped in at one of the next cycles.
+   */
+  void swap();
+
+private:
+  ClaimGroups() = default;
+  friend ClaimGroups* claim_groups(const std::string& hw_name);
+  friend const std::atomic<int>* register_claims(const std::string&, const std::string&,
+                                                 const std::set<std::string>&);
+  friend void unregister_claims(const std::string&, const std::string&);
+
+  struct Entry;
+  void publish();
+
+  std::mutex                                           m_mtx;
+  std::map<std::string, std::unique_ptr<Entry>>        m_entries;
+  std::atomic<uint64_t>                                m_published{0};
+  uint64_t                                             m_applied = 0;  // loop thread only
+};
+
+/**
+ * @brief Non-RT. The groups of the hw 'hw_name' (same format of the hw name stored in the controllers)
+ *
+ * The object is created at the first call, and it lives until the end of the process, so that the pointer can
+ * be cached.
+ */
+ClaimGroups* claim_groups(const std::string& hw_name);
+
+/**
+ * @brief Non-RT. Register the resources claimed by the controller 'ctrl_name' of the hw 'hw_name'
+ *
+ * The controllers of the same hw whose claims overlap (also transitively) are in the same group, so that they
+ * are executed serially on the same lane. The groups are recomputed at each registration, and the returned
+ * slot (valid until unregister_claims()) holds the group of the controller swapped in by the loop
+ * (see ClaimGroups::swap()), or -1 until the first swap: the controller is then updated on the loop thread.
+ */
+const std::atomic<int>* register_claims(const std::string& hw_name,
+                                        const std::string& ctrl_name,
+                                        const std::set<std::string>& claims);
+
+//! Non-RT
+void unregister_claims(const std::string& hw_name, const std::string& ctrl_name);
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__FORK_JOIN_EXECUTOR__H
@@ -0,0 +1,113 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__LOOP_STATUS__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__LOOP_STATUS__H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <cnr_controller_interface_params/cycle_context.h>
+
+namespace cnr
+{
+namespace control
+{
+
+class ForkJoinExecutor;
+
+/**
+ * @brief Condition of the RT loop of a RobotHW, written by the driver and read by its controllers
+ *
+ * When the loop is 'degraded' (overrun policy 'degrade'), the controllers that are not critical
+ * skip their update, so that the loop can recover. The context of the running cycle is published as well.
+ */
+struct HwLoopStatus
+{
+  std::atomic<bool>     degraded{false};
+  std::atomic<uint32_t> overrun_streak{0};  //!< consecutive cycles longer than the sampling period
+
+  //! Written by the driver at the wake-up of each cycle. Not synchronized: read it from the loop thread only
+  //! (i.e., from update()), and check that 'context.time' is the time of the call
+  CycleContext          context;
+
+  //! Set by the driver while the loop runs with parallel workers: the controllers fork their update on it,
+  //! and the driver joins them before write()
+  std::atomic<ForkJoinExecutor*> executor{nullptr};
+
+  //! Requests of serial updates, see request_serial_update()
+  std::atomic<uint32_t> serial_requests{0};
+  //! Set by the driver at the wake-up of each cycle, if there are requests: no update is forked in the cycle
+  std::atomic<bool>     serial{false};
+  //! Cycles started with 'serial' set
+  std::atomic<uint64_t> serial_cycles{0};
+};
+
+/**
+ * @brief The status of the loop of 'hw_name' (same format of the hw name stored in the controllers)
+ *
+ * Non-RT: the status is created at the first call, and it lives until the end of the process,
+ * so that the pointer can be cached.
+ */
+HwLoopStatus* hw_loop_status(const std::string& hw_name);
+
+/**
+ * @brief Choose the phase of a controller updated every 'decimation' cycles of the loop of 'hw_name'
+ *
+ * The controller runs at the cycles where 'cycle % decimation == phase'. The phase that coincides with the
+ * fewest of the phases already acquired on the same hw is chosen, so that the slow controllers do not land
+ * on the same cycle. Non-RT.
+ */
+unsigned int acquire_update_phase(const std::string& hw_name, const unsigned int& decimation);
+
+/**
+ * @brief Non-RT. Make the loop of 'status' update all its controllers on the loop thread, until the release
+ *
+ * The controller manager starts and stops the controllers in its update(), right after their updates: a switch
+ * must not overlap with the forked updates. The call returns once a cycle has started without forks (all the
+ * forks of the previous cycles are joined), or after 'timeout' seconds (false) if the loop does not cycle.
+ * It returns at once if the loop has no executor.
+ */
+bool request_serial_update(HwLoopStatus* status, const double& timeout);
+
+//! Non-RT. Release a request of request_serial_update(), whatever its result
+void release_serial_update(HwLoopStatus* status);
+
+//! Non-RT. Release a phase given by acquire_update_phase()
+void release_update_phase(const std::string& hw_name, const unsigned int& decimation, const unsigned int& phase);
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__LOOP_STATUS__H
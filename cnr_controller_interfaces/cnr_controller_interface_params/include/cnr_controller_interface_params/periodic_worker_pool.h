@@ -0,0 +1,120 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__PERIODIC_WORKER_POOL__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__PERIODIC_WORKER_POOL__H
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace cnr
+{
+namespace control
+{
+
+/**
+ * @brief Fixed pool of non-RT workers that run periodic jobs (e.g., the kinematics of the controllers)
+ *
+ * The workers are started at the first add(), optionally pinned on a set of CPUs (e.g., the non-RT cores),
+ * and each of them runs the job with the earliest deadline. A job never runs on two workers at the same time;
+ * a job that overruns its period is postponed, it does not pile up.
+ * The methods are thread-safe, and none of them is meant to be called by the RT loop.
+ */
+class PeriodicWorkerPool
+{
+public:
+  typedef std::function<void()> Job;
+
+  PeriodicWorkerPool() = default;
+  ~PeriodicWorkerPool();
+  PeriodicWorkerPool(const PeriodicWorkerPool&) = delete;
+  PeriodicWorkerPool& operator=(const PeriodicWorkerPool&) = delete;
+
+  /** @brief Number of workers and their CPU affinity (empty: no constraint)
+   * It fails if the workers are already running
+   */
+  bool configure(const size_t& workers, const std::vector<int>& cpus, std::string& error);
+
+  //! It returns the id of the job, the first run is immediate. 'period' [s] must be positive
+  size_t add(const Job& job, const double& period);
+
+  //! false if the job does not exist
+  bool setPeriod(const size_t& id, const double& period);
+
+  //! It blocks while the job is running (do not call it from the job), the job is never called after the return
+  void remove(const size_t& id);
+
+  //! It stops and joins the workers, the jobs are discarded
+  void shutdown();
+
+  size_t workers() const;
+  size_t jobs() const;
+  uint64_t runs(const size_t& id) const;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Entry
+  {
+    Job               job;
+    Clock::duration   period;
+    Clock::time_point due;
+    bool              running = false;
+    bool              removed = false;
+    uint64_t          runs    = 0;
+  };
+
+  void workerThread();
+
+  mutable std::mutex       m_mtx;
+  std::condition_variable  m_cv;       //!< the workers wait for a due job
+  std::condition_variable  m_done_cv;  //!< remove() waits for the end of the running job
+  std::map<size_t, Entry>  m_jobs;
+  size_t                   m_next_id = 1;
+  size_t                   m_workers = 1;
+  std::vector<int>         m_cpus;
+  std::vector<std::thread> m_threads;
+  bool                     m_stop = false;
+};
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__PERIODIC_WORKER_POOL__H
@@ -0,0 +1,75 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__PIPELINED_HW__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__PIPELINED_HW__H
+
+namespace cnr
+{
+namespace control
+{
+
+/**
+ * @brief Opt-in interface of the RobotHW that can run read()/write() concurrently with the update of the controllers
+ *
+ * In the pipelined mode, the driver runs write(N) and read(N+1) in an I/O thread, while the update(N+1) of the
+ * controllers runs in the RT thread on the state read at the previous cycle.
+ * To support it, the RobotHW keeps two copies of its handle memory: the one pointed by the handles (used by the
+ * controllers) and the one used by doRead()/doWrite(). exchangeBuffers() is called by the driver at the boundary
+ * of the cycles, when neither the I/O nor the update run: it copies the last state read into the handles, and the
+ * commands of the handles into the I/O memory.
+ *
+ * The doSwitch() of the RobotHW is called by the controller manager in the RT thread, hence concurrently with
+ * read() and write(): what it changes must be consumed by the I/O in exchangeBuffers().
+ */
+class PipelinedHw
+{
+public:
+  virtual ~PipelinedHw() = default;
+
+  /** @brief Called by the driver before the loop starts (non-RT)
+   *
+   * If disabled, doRead() and doWrite() must work on the handle memory as usual.
+   * @return false if the RobotHW cannot run pipelined (the driver then runs sequentially)
+   */
+  virtual bool enablePipeline(const bool& enable) = 0;
+
+  //! RT-safe, called between the cycles
+  virtual void exchangeBuffers() = 0;
+};
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__PIPELINED_HW__H
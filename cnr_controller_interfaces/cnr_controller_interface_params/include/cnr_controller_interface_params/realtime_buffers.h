@@ -0,0 +1,279 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__REALTIME_BUFFERS__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__REALTIME_BUFFERS__H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace cnr
+{
+namespace control
+{
+
+/**
+ * @brief Lock-free handoff of the latest value from one writer thread to one reader thread
+ *
+ * The three slots are allocated once: the writer fills writeBuffer() and calls publish(),
+ * the reader calls update() and then uses readBuffer(). No one waits, and the older samples
+ * are overwritten (the reader always gets the latest published one).
+ * It is meant for the data produced by the ROS callbacks (non-RT spinner) and consumed by the RT loop.
+ * If T owns heap memory (std::vector, Eigen::VectorXd), size it through reset() before the first use, so that
+ * the copies in the callbacks do not reallocate.
+ */
+template<class T>
+class TripleBuffer
+{
+public:
+  TripleBuffer() : m_state(1), m_write(0), m_read(2) {}
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  //! Not thread-safe: call it before the writer and the reader start
+  void reset(const T& value)
+  {
+    m_slots[0] = m_slots[1] = m_slots[2] = value;
+    m_state.store(1, std::memory_order_relaxed);
+    m_write = 0;
+    m_read = 2;
+  }
+
+  //! writer side
+  T& writeBuffer() { return m_slots[m_write]; }
+
+  //! writer side: the content of writeBuffer() becomes the latest value
+  void publish()
+  {
+    m_write = m_state.exchange(m_write | DIRTY, std::memory_order_acq_rel) & INDEX;
+  }
+
+  //! reader side: it returns true if a new value has been published since the last call
+  bool update()
+  {
+    if (!(m_state.load(std::memory_order_relaxed) & DIRTY))
+    {
+      return false;
+    }
+    m_read = m_state.exchange(m_read, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  //! reader side
+  const T& readBuffer() const { return m_slots[m_read]; }
+  T& readBuffer() { return m_slots[m_read]; }
+
+private:
+  static constexpr uint8_t INDEX = 0x3;
+  static constexpr uint8_t DIRTY = 0x4;
+
+  std::array<T, 3>     m_slots;
+  std::atomic<uint8_t> m_state;  //!< index of the back slot, and the DIRTY flag
+  uint8_t              m_write;
+  uint8_t              m_read;
+};
+
+/**
+ * @brief Type-erased side of a Mailbox, to store the mailboxes of different types in the same container
+ */
+class MailboxBase
+{
+public:
+  virtual ~MailboxBase() = default;
+};
+
+/**
+ * @brief Latest-value mailbox of a subscribed topic: the callback (non-RT spinner) writes, the RT loop reads
+ */
+template<class M>
+class Mailbox : public MailboxBase
+{
+public:
+  Mailbox() : m_valid(false) {}
+
+  //! writer side: copy the message and publish it
+  void write(const M& message)
+  {
+    m_buffer.writeBuffer() = message;
+    m_buffer.publish();
+  }
+
+  /** @brief reader side, O(1): the latest message, nullptr if nothing has been received yet
+   * @param[out] fresh true if the message arrived after the previous call
+   */
+  const M* read(bool* fresh = nullptr)
+  {
+    const bool updated = m_buffer.update();
+    m_valid = m_valid || updated;
+    if (fresh)
+    {
+      *fresh = updated;
+    }
+    return m_valid ? &m_buffer.readBuffer() : nullptr;
+  }
+
+private:
+  TripleBuffer<M> m_buffer;
+  bool            m_valid;  //!< reader side
+};
+
+/**
+ * @brief Sequence lock around a value written by one thread and read by many
+ *
+ * The writer never waits: it makes the sequence odd, modifies the value in place and makes it even again.
+ * The readers copy what they need and retry if the sequence changed meanwhile, so that they always get
+ * a consistent (torn-free) copy without ever blocking the writer.
+ * Use it when the writer is the RT loop and the readers are not. If T owns heap memory, size it through
+ * reset() before the first use, so that the writer does not reallocate.
+ */
+template<class T>
+class SeqLock
+{
+public:
+  SeqLock() : m_seq(0) {}
+  SeqLock(const SeqLock&) = delete;
+  SeqLock& operator=(const SeqLock&) = delete;
+
+  //! Not thread-safe: call it before the writer and the readers start
+  void reset(const T& value)
+  {
+    m_value = value;
+    m_seq.store(0, std::memory_order_relaxed);
+  }
+
+  //! writer side: 'f(T&)' modifies the value in place
+  template<class F>
+  void write(F&& f)
+  {
+    const uint64_t seq = m_seq.load(std::memory_order_relaxed);
+    m_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    f(m_value);
+    m_seq.store(seq + 2, std::memory_order_release);
+  }
+
+  //! reader side, it retries until 'f(const T&)' has seen a consistent value. Keep 'f' short (just copies)
+  template<class F>
+  void read(F&& f) const
+  {
+    while (!tryRead(f))
+    {
+    }
+  }
+
+  //! reader side, one attempt: false if the writer was modifying the value (discard what 'f' copied)
+  template<class F>
+  bool tryRead(F&& f) const
+  {
+    const uint64_t seq = m_seq.load(std::memory_order_acquire);
+    if (seq & 1)
+    {
+      return false;
+    }
+    f(static_cast<const T&>(m_value));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return m_seq.load(std::memory_order_relaxed) == seq;
+  }
+
+  //! number of completed writes
+  uint64_t writes() const { return m_seq.load(std::memory_order_acquire) / 2; }
+
+private:
+  T                     m_value;
+  std::atomic<uint64_t> m_seq;
+};
+
+/**
+ * @brief Bounded wait-free queue, single producer and single consumer
+ *
+ * Unlike the TripleBuffer, the elements are not overwritten: push() fails when the queue is full.
+ * Use it for events that must not be lost (e.g., commands or requests towards the RT loop).
+ * @tparam N capacity, power of two
+ */
+template<class T, size_t N>
+class SpscQueue
+{
+  static_assert(N > 0 && (N & (N - 1)) == 0, "The capacity of the SpscQueue must be a power of two");
+
+public:
+  SpscQueue() : m_head(0), m_tail(0) {}
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  //! producer side
+  bool push(const T& value)
+  {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= N)
+    {
+      return false;
+    }
+    m_ring[head & (N - 1)] = value;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  //! consumer side
+  bool pop(T& value)
+  {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+    value = m_ring[tail & (N - 1)];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const
+  {
+    return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  std::array<T, N>    m_ring;
+  alignas(64) std::atomic<size_t> m_head;
+  alignas(64) std::atomic<size_t> m_tail;
+};
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__REALTIME_BUFFERS__H
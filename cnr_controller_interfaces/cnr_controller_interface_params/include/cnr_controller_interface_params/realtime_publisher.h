@@ -0,0 +1,230 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__REALTIME_PUBLISHER__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__REALTIME_PUBLISHER__H
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <semaphore.h>
+
+#include <ros/ros.h>
+#include <cnr_controller_interface_params/realtime_buffers.h>
+
+namespace cnr
+{
+namespace control
+{
+
+/**
+ * @brief The type-erased side of a RealtimePublisher, used by the RealtimePublishingThread
+ */
+class RealtimePublisherBase
+{
+public:
+  virtual ~RealtimePublisherBase() = default;
+
+  //! Non-RT. Publish the committed messages, and give their slots back to the RT side
+  virtual size_t drain() = 0;
+  virtual std::string getTopic() const = 0;
+
+  uint64_t published() const { return m_published.load(std::memory_order_relaxed); }
+  //! Messages lost because all the slots of the pool were waiting for the publishing thread
+  uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+protected:
+  std::atomic<uint64_t> m_published{0};
+  std::atomic<uint64_t> m_dropped{0};
+};
+
+/**
+ * @brief Non-RT thread that publishes the messages committed by the RealtimePublishers
+ *
+ * notify() is RT-safe (sem_post). The thread is spawned when the first publisher is added, it drains the
+ * publishers at each notification (or every 100ms), and it publishes what is left before stopping.
+ */
+class RealtimePublishingThread
+{
+public:
+  RealtimePublishingThread();
+  ~RealtimePublishingThread();
+  RealtimePublishingThread(const RealtimePublishingThread&) = delete;
+  RealtimePublishingThread& operator=(const RealtimePublishingThread&) = delete;
+
+  //! Non-RT
+  void add(const std::shared_ptr<RealtimePublisherBase>& publisher);
+  //! Non-RT. Publish the pending messages, join the thread and release the publishers
+  void stop();
+  //! RT-safe
+  void notify() { sem_post(&m_sem); }
+
+private:
+  void run();
+
+  std::mutex                                          m_mtx;
+  std::vector<std::shared_ptr<RealtimePublisherBase>> m_publishers;
+  sem_t                                               m_sem;
+  std::atomic<bool>                                   m_stop;
+  std::thread                                         m_thread;
+};
+
+/**
+ * @brief Publisher for the RT loop, with a pool of preallocated messages
+ *
+ * The RT side fills a slot of the pool and commits it; a RealtimePublishingThread serializes and publishes it,
+ * and then gives the slot back. The slots travel in two SpscQueues, so neither side locks, and the RT side
+ * does not allocate as long as the copy of M does not (size the dynamic fields through reset()).
+ * With a decimation N, only one call out of N is published.
+ *
+ * Single producer: the RT side must be used by one thread at a time (the update of the owning controller).
+ */
+template<class M, size_t POOL = 8>
+class RealtimePublisher : public RealtimePublisherBase
+{
+  static_assert(POOL > 0 && POOL <= 128 && (POOL & (POOL - 1)) == 0, "The pool must be a power of two <= 128");
+
+public:
+  RealtimePublisher(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, bool latch,
+                    unsigned int decimation, RealtimePublishingThread* thread)
+    : m_pub(nh.advertise<M>(topic, queue_size, latch)), m_thread(thread),
+      m_decimation(decimation > 0 ? decimation : 1), m_calls(0), m_acquired(-1)
+  {
+    for (size_t i = 0; i < POOL; i++)
+    {
+      m_free.push(static_cast<uint8_t>(i));
+    }
+  }
+
+  //! Non-RT. Copy the prototype in all the slots (e.g., to preallocate the arrays of the message)
+  void reset(const M& prototype)
+  {
+    for (auto& m : m_pool)
+    {
+      m = prototype;
+    }
+  }
+
+  /** @brief RT. The slot to be filled, nullptr if this call is skipped by the decimation or the pool is empty
+   *
+   * The slot keeps the content it had when it was last published.
+   */
+  M* acquire()
+  {
+    if (m_acquired >= 0)
+    {
+      return &m_pool[m_acquired];
+    }
+    if ((m_calls++ % m_decimation) != 0)
+    {
+      return nullptr;
+    }
+    uint8_t idx;
+    if (!m_free.pop(idx))
+    {
+      m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    m_acquired = idx;
+    return &m_pool[idx];
+  }
+
+  //! RT. Hand the acquired slot to the publishing thread
+  void commit()
+  {
+    if (m_acquired < 0)
+    {
+      return;
+    }
+    m_ready.push(static_cast<uint8_t>(m_acquired));
+    m_acquired = -1;
+    if (m_thread)
+    {
+      m_thread->notify();
+    }
+  }
+
+  //! RT. acquire(), copy and commit(). It returns false only if the message is dropped
+  bool publish(const M& message)
+  {
+    const bool skip = (m_acquired < 0) && ((m_calls % m_decimation) != 0);
+    M* slot = acquire();
+    if (!slot)
+    {
+      return skip;
+    }
+    *slot = message;
+    commit();
+    return true;
+  }
+
+  //! Non-RT
+  size_t drain() override
+  {
+    size_t n = 0;
+    uint8_t idx;
+    while (m_ready.pop(idx))
+    {
+      m_pub.publish(m_pool[idx]);
+      m_free.push(idx);
+      n++;
+    }
+    m_published.fetch_add(n, std::memory_order_relaxed);
+    return n;
+  }
+
+  std::string getTopic() const override { return m_pub.getTopic(); }
+  unsigned int decimation() const { return m_decimation; }
+  ros::Publisher& getPublisher() { return m_pub; }
+
+private:
+  ros::Publisher            m_pub;
+  RealtimePublishingThread* m_thread;
+  unsigned int              m_decimation;
+  uint64_t                  m_calls;
+  int                       m_acquired;
+  std::array<M, POOL>       m_pool;
+  SpscQueue<uint8_t, POOL>  m_free;   //!< publishing thread -> RT
+  SpscQueue<uint8_t, POOL>  m_ready;  //!< RT -> publishing thread
+};
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__REALTIME_PUBLISHER__H
@@ -0,0 +1,171 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_CONTROLLER_INTERFACE_PARAMS__TOPIC_WATCHDOG__H
+#define CNR_CONTROLLER_INTERFACE_PARAMS__TOPIC_WATCHDOG__H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace cnr
+{
+namespace control
+{
+
+//! Snapshot of a TopicArrival. The times are in seconds
+struct TopicArrivalSummary
+{
+  std::string controller;
+  std::string topic;
+  bool        tracked  = false;  //!< the watchdog is enabled on the topic
+  uint64_t    messages = 0;
+  double      mean     = 0.0;    //!< inter-arrival time (moving average)
+  double      jitter   = 0.0;    //!< mean absolute deviation of the inter-arrival time (moving average)
+  double      silence  = 0.0;    //!< time since the last message, at the last check of the controller
+  bool        timeout  = false;  //!< the silence was longer than the watchdog at the last check
+  uint64_t    misses   = 0;      //!< times the topic went silent for longer than the watchdog
+  double      watchdog = 0.0;
+};
+
+/**
+ * @brief Arrival times of the messages of a subscribed topic
+ *
+ * received() is called by the thread that runs the callback of the topic (single writer), check() by the RT
+ * loop, and summary() by any thread. They are wait-free and they do not allocate.
+ */
+class TopicArrival
+{
+public:
+  static constexpr double EWMA_GAIN = 1.0 / 16.0;
+
+  TopicArrival(const std::string& topic, const bool& tracked) : m_topic(topic), m_tracked(tracked) {}
+  TopicArrival(const TopicArrival&) = delete;
+  TopicArrival& operator=(const TopicArrival&) = delete;
+
+  //! The callback thread, at each message [ns]. The stamps are on the time base of check() (e.g., the time of
+  //! the last cycle of the loop); the messages stamped 0 (the loop has not cycled yet) are not counted
+  void received(const int64_t& stamp_ns);
+
+  //! RT. It returns true if the topic is tracked and silent for longer than 'timeout_ns' at 'now_ns'
+  //! (time of the cycle)
+  bool check(const int64_t& now_ns, const int64_t& timeout_ns)
+  {
+    m_now.store(now_ns, std::memory_order_relaxed);
+    const int64_t last = m_last.load(std::memory_order_acquire);
+    const bool timeout = m_tracked && (last > 0) && (now_ns - last > timeout_ns);
+    if (timeout && !m_timeout.load(std::memory_order_relaxed))
+    {
+      m_misses.store(m_misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    m_timeout.store(timeout, std::memory_order_relaxed);
+    return timeout;
+  }
+
+  TopicArrivalSummary summary() const;
+  const std::string& topic() const { return m_topic; }
+
+private:
+  const std::string     m_topic;
+  const bool            m_tracked;
+  std::atomic<int64_t>  m_last{0};
+  std::atomic<uint64_t> m_messages{0};
+  std::atomic<double>   m_mean{0.0};
+  std::atomic<double>   m_jitter{0.0};
+  std::atomic<int64_t>  m_now{0};
+  std::atomic<bool>     m_timeout{false};
+  std::atomic<uint64_t> m_misses{0};
+};
+
+/**
+ * @brief The watchdog on the topics subscribed by a controller
+ *
+ * The topics are added before the controller runs (non-RT); the loop checks them all at each update against
+ * the time of the cycle, without locking and without building messages. The reports are formatted by the
+ * diagnostics of the ControllerManagerInterface, through topic_watchdogs().
+ */
+class TopicWatchdog
+{
+public:
+  TopicWatchdog() : m_timeout(0) {}
+  TopicWatchdog(const TopicWatchdog&) = delete;
+  TopicWatchdog& operator=(const TopicWatchdog&) = delete;
+
+  //! Non-RT. The returned object is shared with the callback of the topic
+  std::shared_ptr<TopicArrival> add(const std::string& topic, const bool& tracked);
+  //! Non-RT
+  void clear();
+  //! Non-RT [s]
+  void setTimeout(const double& timeout);
+
+  //! RT. It returns the number of topics in timeout
+  size_t check(const int64_t& now_ns)
+  {
+    size_t ret = 0;
+    for (const auto& t : m_topics)
+    {
+      ret += t->check(now_ns, m_timeout) ? 1 : 0;
+    }
+    return ret;
+  }
+
+  //! Non-RT
+  std::vector<TopicArrivalSummary> summary() const;
+
+private:
+  mutable std::mutex                         m_mtx;  //!< add() and clear() vs summary(); check() does not lock
+  std::vector<std::shared_ptr<TopicArrival>> m_topics;
+  int64_t                                    m_timeout;
+};
+
+/**
+ * @brief Non-RT. Register the watchdog of the controller 'ctrl_name' of the hw 'hw_name'
+ *
+ * The watchdog must outlive the registration, see unregister_topic_watchdog()
+ */
+void register_topic_watchdog(const std::string& hw_name, const std::string& ctrl_name, TopicWatchdog* watchdog);
+
+//! Non-RT. It does nothing if 'watchdog' is not the one registered as 'ctrl_name'
+void unregister_topic_watchdog(const std::string& hw_name, const std::string& ctrl_name, TopicWatchdog* watchdog);
+
+//! Non-RT. The topics of all the controllers of the hw
+std::vector<TopicArrivalSummary> topic_watchdogs(const std::string& hw_name);
+
+}  // namespace control
+}  // namespace cnr
+
+#endif  // CNR_CONTROLLER_INTERFACE_PARAMS__TOPIC_WATCHDOG__H
@@ -0,0 +1,166 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <map>
+#include <mutex>
+
+#include <cnr_controller_interface_params/allocation_sentinel.h>
+
+#ifndef ALLOCATION_SENTINEL
+#define ALLOCATION_SENTINEL 0
+#endif
+
+namespace cnr
+{
+namespace control
+{
+
+namespace
+{
+// trivially constructible thread_local: no dynamic TLS initialization, so they are safe inside operator new
+thread_local AllocationCounter* t_chain[AllocationScope::MAX_DEPTH];
+thread_local int                t_depth = 0;
+
+std::atomic<int> g_enabled{0};
+
+std::mutex& registry_mtx()
+{
+  static std::mutex mtx;
+  return mtx;
+}
+
+std::map<std::string, AllocationCounter*>& registry()
+{
+  static std::map<std::string, AllocationCounter*> reg;
+  return reg;
+}
+}  // namespace
+
+AllocationScope::AllocationScope(AllocationCounter* counter)
+  : m_pushed(false)
+{
+  if (counter && t_depth < MAX_DEPTH && g_enabled.load(std::memory_order_relaxed) > 0)
+  {
+    t_chain[t_depth++] = counter;
+    m_pushed = true;
+  }
+}
+
+AllocationScope::~AllocationScope()
+{
+  if (m_pushed)
+  {
+    t_depth--;
+  }
+}
+
+namespace allocation_sentinel
+{
+
+bool compiled()
+{
+  return ALLOCATION_SENTINEL;
+}
+
+void enable()
+{
+  g_enabled.fetch_add(1, std::memory_order_relaxed);
+}
+
+void disable()
+{
+  int prev = g_enabled.load(std::memory_order_relaxed);
+  while (prev > 0 && !g_enabled.compare_exchange_weak(prev, prev - 1, std::memory_order_relaxed))
+  {
+  }
+}
+
+bool enabled()
+{
+  return g_enabled.load(std::memory_order_relaxed) > 0;
+}
+
+void registerCounter(const std::string& name, AllocationCounter* counter)
+{
+  std::lock_guard<std::mutex> lock(registry_mtx());
+  registry()[name] = counter;
+}
+
+void unregisterCounter(const std::string& name, AllocationCounter* counter)
+{
+  std::lock_guard<std::mutex> lock(registry_mtx());
+  auto it = registry().find(name);
+  if (it != registry().end() && it->second == counter)
+  {
+    registry().erase(it);
+  }
+}
+
+std::vector<std::pair<std::string, AllocationCount>> registered(const std::string& prefix)
+{
+  std::vector<std::pair<std::string, AllocationCount>> ret;
+  std::lock_guard<std::mutex> lock(registry_mtx());
+  for (auto it = registry().lower_bound(prefix); it != registry().end(); ++it)
+  {
+    if (it->first.compare(0, prefix.size(), prefix) != 0)
+    {
+      break;
+    }
+    ret.emplace_back(it->first, it->second->get());
+  }
+  return ret;
+}
+
+void onAllocation(size_t bytes)
+{
+  for (int i = 0; i < t_depth; i++)
+  {
+    t_chain[i]->allocations.fetch_add(1, std::memory_order_relaxed);
+    t_chain[i]->bytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+}
+
+void onFree()
+{
+  for (int i = 0; i < t_depth; i++)
+  {
+    t_chain[i]->frees.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace allocation_sentinel
+
+}  // namespace control
+}  // namespace cnr
+
@@ -0,0 +1,195 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+// Kept apart from allocation_sentinel.cpp, so that the containers of the registry are not inlined in the hooks
+#include <new>
+#include <cstdlib>
+#include <stdlib.h>
+
+#include <cnr_controller_interface_params/allocation_sentinel.h>
+
+#ifndef ALLOCATION_SENTINEL
+#define ALLOCATION_SENTINEL 0
+#endif
+
+#if ALLOCATION_SENTINEL
+namespace
+{
+void* sentinel_alloc(std::size_t size)
+{
+  void* p = std::malloc(size ? size : 1);
+  if (p)
+  {
+    cnr::control::allocation_sentinel::onAllocation(size);
+  }
+  return p;
+}
+
+#if defined(__cpp_aligned_new)
+void* sentinel_aligned_alloc(std::size_t size, std::align_val_t alignment)
+{
+  std::size_t align = static_cast<std::size_t>(alignment);
+  void* p = nullptr;
+  if (posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, size ? size : 1) != 0)
+  {
+    return nullptr;
+  }
+  cnr::control::allocation_sentinel::onAllocation(size);
+  return p;
+}
+#endif
+
+void sentinel_free(void* p)
+{
+  if (p)
+  {
+    cnr::control::allocation_sentinel::onFree();
+    std::free(p);
+  }
+}
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+  void* p = sentinel_alloc(size);
+  if (!p)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](std::size_t size)
+{
+  return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  return sentinel_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  return sentinel_alloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+  sentinel_free(p);
+}
+
+// over-aligned types (e.g., the alignas(64) queues of the loop); posix_memalign memory is released by free()
+#if defined(__cpp_aligned_new)
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+  void* p = sentinel_aligned_alloc(size, alignment);
+  if (!p)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return ::operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+  return sentinel_aligned_alloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+  return sentinel_aligned_alloc(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+  sentinel_free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+  sentinel_free(p);
+}
+#endif
+#endif
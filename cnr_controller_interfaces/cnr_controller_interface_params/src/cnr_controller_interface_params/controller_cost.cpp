@@ -0,0 +1,165 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <map>
+#include <mutex>
+#include <algorithm>
+
+#include <cnr_controller_interface_params/controller_cost.h>
+
+namespace cnr
+{
+namespace control
+{
+
+void ControllerCost::reset(const int64_t& budget_ns)
+{
+  m_budget = budget_ns;
+  for (auto& c : m_counts)
+  {
+    c.store(0, std::memory_order_relaxed);
+  }
+  m_cycles.store(0, std::memory_order_relaxed);
+  m_updates.store(0, std::memory_order_relaxed);
+  m_total.store(0, std::memory_order_relaxed);
+  m_max.store(0, std::memory_order_relaxed);
+  m_deadline_misses.store(0, std::memory_order_relaxed);
+}
+
+int64_t ControllerCost::bucketUpperBound(const size_t& idx)
+{
+  if (idx < SUB_BUCKETS)
+  {
+    return static_cast<int64_t>(idx);
+  }
+  const size_t   group = idx / SUB_BUCKETS;
+  const uint64_t sub   = idx % SUB_BUCKETS;
+  const uint64_t lower = (SUB_BUCKETS + sub) << (group - 1);
+  return static_cast<int64_t>(lower + (uint64_t(1) << (group - 1)) - 1);
+}
+
+ControllerCostSummary ControllerCost::summary() const
+{
+  ControllerCostSummary ret;
+  std::array<uint64_t, BUCKETS> counts;
+  uint64_t count = 0;
+  for (size_t i = 0; i < BUCKETS; i++)
+  {
+    counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    count += counts[i];
+  }
+  ret.cycles          = m_cycles.load(std::memory_order_relaxed);
+  ret.updates         = count;
+  ret.total           = m_total.load(std::memory_order_relaxed);
+  ret.max             = m_max.load(std::memory_order_relaxed);
+  ret.deadline_misses = m_deadline_misses.load(std::memory_order_relaxed);
+  ret.budget          = m_budget;
+  if (count == 0)
+  {
+    return ret;
+  }
+  ret.mean = static_cast<double>(ret.total) / static_cast<double>(count);
+
+  const uint64_t r50 = (count * 50 + 99) / 100;
+  const uint64_t r99 = (count * 99 + 99) / 100;
+  uint64_t cumulated = 0;
+  for (size_t i = 0; i < BUCKETS; i++)
+  {
+    cumulated += counts[i];
+    if (ret.p50 == 0 && cumulated >= r50)
+    {
+      ret.p50 = std::min(bucketUpperBound(i), ret.max);
+    }
+    if (cumulated >= r99)
+    {
+      ret.p99 = std::min(bucketUpperBound(i), ret.max);
+      break;
+    }
+  }
+  return ret;
+}
+
+namespace
+{
+std::mutex                                                       g_costs_mtx;
+std::map<std::string, std::map<std::string, ControllerCost*>>    g_costs;
+}  // namespace
+
+void register_controller_cost(const std::string& hw_name, const std::string& ctrl_name, ControllerCost* cost)
+{
+  std::lock_guard<std::mutex> lock(g_costs_mtx);
+  g_costs[hw_name][ctrl_name] = cost;
+}
+
+void unregister_controller_cost(const std::string& hw_name, const std::string& ctrl_name, ControllerCost* cost)
+{
+  std::lock_guard<std::mutex> lock(g_costs_mtx);
+  auto hw = g_costs.find(hw_name);
+  if (hw == g_costs.end())
+  {
+    return;
+  }
+  auto it = hw->second.find(ctrl_name);
+  if (it != hw->second.end() && it->second == cost)
+  {
+    hw->second.erase(it);
+  }
+}
+
+std::vector<ControllerCostSummary> controller_costs(const std::string& hw_name)
+{
+  std::vector<ControllerCostSummary> ret;
+  {
+    std::lock_guard<std::mutex> lock(g_costs_mtx);
+    auto hw = g_costs.find(hw_name);
+    if (hw == g_costs.end())
+    {
+      return ret;
+    }
+    ret.reserve(hw->second.size());
+    for (const auto& c : hw->second)
+    {
+      ret.push_back(c.second->summary());
+      ret.back().name = c.first;
+    }
+  }
+  std::stable_sort(ret.begin(), ret.end(), [](const ControllerCostSummary& a, const ControllerCostSummary& b)
+  {
+    return a.total > b.total;
+  });
+  return ret;
+}
+
+}  // namespace control
+}  // namespace cnr
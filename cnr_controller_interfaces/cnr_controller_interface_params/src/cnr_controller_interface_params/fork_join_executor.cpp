@@ -0,0 +1,288 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <map>
+#include <mutex>
+#include <cerrno>
+#include <numeric>
+#include <system_error>
+
+#include <cnr_controller_interface_params/fork_join_executor.h>
+
+namespace cnr
+{
+namespace control
+{
+
+ForkJoinExecutor::ForkJoinExecutor()
+  : m_outstanding(0), m_stop(true)
+{
+  sem_init(&m_done, 0, 0);
+}
+
+ForkJoinExecutor::~ForkJoinExecutor()
+{
+  stop();
+  sem_destroy(&m_done);
+}
+
+bool ForkJoinExecutor::start(const size_t& workers,
+                             const std::function<void(const size_t&)>& thread_init,
+                             std::string& error)
+{
+  if (!m_workers.empty())
+  {
+    error = "The executor is already started";
+    return false;
+  }
+  m_stop = false;
+  m_outstanding = 0;
+  for (size_t i = 0; i < workers; i++)
+  {
+    std::unique_ptr<Worker> worker(new Worker());
+    sem_init(&worker->wake, 0, 0);
+    try
+    {
+      worker->thread = std::thread(&ForkJoinExecutor::workerLoop, this, worker.get(), i, thread_init);
+    }
+    catch (std::system_error& e)
+    {
+      sem_destroy(&worker->wake);
+      stop();
+      error = "Failed in spawning the worker " + std::to_string(i) + ": " + e.what();
+      return false;
+    }
+    m_workers.push_back(std::move(worker));
+  }
+  m_joined.clear();
+  m_joined.reserve(workers * QUEUE_CAPACITY);
+  return true;
+}
+
+void ForkJoinExecutor::stop()
+{
+  m_stop = true;
+  for (auto& worker : m_workers)
+  {
+    sem_post(&worker->wake);
+  }
+  for (auto& worker : m_workers)
+  {
+    if (worker->thread.joinable())
+    {
+      worker->thread.join();
+    }
+    sem_destroy(&worker->wake);
+  }
+  m_workers.clear();
+  m_joined.clear();
+  m_outstanding = 0;
+}
+
+bool ForkJoinExecutor::fork(const size_t& lane, Task task, void* arg, Task joined)
+{
+  // the callbacks are stored in the capacity reserved by start(), hence without allocation
+  if (m_workers.empty() || (joined && m_joined.size() == m_joined.capacity()))
+  {
+    return false;
+  }
+  Worker* worker = m_workers[lane % m_workers.size()].get();
+  m_outstanding.fetch_add(1, std::memory_order_acq_rel);
+  if (!worker->queue.push({task, arg}))
+  {
+    m_outstanding.fetch_sub(1, std::memory_order_acq_rel);
+    return false;
+  }
+  if (joined)
+  {
+    m_joined.push_back({joined, arg});
+  }
+  sem_post(&worker->wake);
+  return true;
+}
+
+void ForkJoinExecutor::join()
+{
+  while (m_outstanding.load(std::memory_order_acquire) != 0)
+  {
+    while (sem_wait(&m_done) != 0 && errno == EINTR)
+    {
+    }
+  }
+  // the posts of the tasks that completed before the join
+  while (sem_trywait(&m_done) == 0)
+  {
+  }
+  for (const Job& job : m_joined)
+  {
+    job.task(job.arg);
+  }
+  m_joined.clear();
+}
+
+void ForkJoinExecutor::workerLoop(Worker* worker, const size_t& index, std::function<void(const size_t&)> thread_init)
+{
+  if (thread_init)
+  {
+    thread_init(index);
+  }
+  while (true)
+  {
+    while (sem_wait(&worker->wake) != 0 && errno == EINTR)
+    {
+    }
+    if (m_stop)
+    {
+      break;
+    }
+    Job job;
+    while (worker->queue.pop(job))
+    {
+      job.task(job.arg);
+      if (m_outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        sem_post(&m_done);
+      }
+    }
+  }
+}
+
+struct ClaimGroups::Entry
+{
+  std::set<std::string> claims;
+  int                   pending = -1;   //!< computed by the last registration
+  std::atomic<int>      group{-1};      //!< in use by the loop
+};
+
+void ClaimGroups::swap()
+{
+  const uint64_t published = m_published.load(std::memory_order_acquire);
+  if (published == m_applied)
+  {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(m_mtx, std::try_to_lock);
+  if (!lock.owns_lock())
+  {
+    return;
+  }
+  for (auto& entry : m_entries)
+  {
+    entry.second->group.store(entry.second->pending, std::memory_order_relaxed);
+  }
+  m_applied = published;
+}
+
+//! Union-find over the controllers of the hw: the controllers sharing a resource are in the same group.
+//! To be called with m_mtx locked
+void ClaimGroups::publish()
+{
+  std::vector<Entry*> ctrls;
+  for (auto& entry : m_entries)
+  {
+    ctrls.push_back(entry.second.get());
+  }
+  std::vector<size_t> parent(ctrls.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  std::function<size_t(size_t)> root = [&](size_t i)
+  {
+    return parent[i] == i ? i : (parent[i] = root(parent[i]));
+  };
+
+  std::map<std::string, size_t> owner;
+  for (size_t i = 0; i < ctrls.size(); i++)
+  {
+    for (const std::string& resource : ctrls[i]->claims)
+    {
+      auto it = owner.find(resource);
+      if (it == owner.end())
+      {
+        owner[resource] = i;
+      }
+      else
+      {
+        parent[root(i)] = root(it->second);
+      }
+    }
+  }
+
+  // dense group indexes, so that the groups are spread evenly on the lanes
+  std::map<size_t, int> index;
+  for (size_t i = 0; i < ctrls.size(); i++)
+  {
+    auto it = index.emplace(root(i), static_cast<int>(index.size())).first;
+    ctrls[i]->pending = it->second;
+  }
+  m_published.fetch_add(1, std::memory_order_release);
+}
+
+ClaimGroups* claim_groups(const std::string& hw_name)
+{
+  static std::mutex mtx;
+  static std::map<std::string, std::unique_ptr<ClaimGroups>> registry;
+  std::lock_guard<std::mutex> lock(mtx);
+  std::unique_ptr<ClaimGroups>& ret = registry[hw_name];
+  if (!ret)
+  {
+    ret.reset(new ClaimGroups());
+  }
+  return ret.get();
+}
+
+const std::atomic<int>* register_claims(const std::string& hw_name,
+                                        const std::string& ctrl_name,
+                                        const std::set<std::string>& claims)
+{
+  ClaimGroups* groups = claim_groups(hw_name);
+  std::lock_guard<std::mutex> lock(groups->m_mtx);
+  std::unique_ptr<ClaimGroups::Entry>& entry = groups->m_entries[ctrl_name];
+  if (!entry)
+  {
+    entry.reset(new ClaimGroups::Entry());
+  }
+  entry->claims = claims;
+  groups->publish();
+  return &entry->group;
+}
+
+void unregister_claims(const std::string& hw_name, const std::string& ctrl_name)
+{
+  ClaimGroups* groups = claim_groups(hw_name);
+  std::lock_guard<std::mutex> lock(groups->m_mtx);
+  groups->m_entries.erase(ctrl_name);
+  groups->publish();
+}
+
+}  // namespace control
+}  // namespace cnr
@@ -0,0 +1,165 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <limits>
+#include <algorithm>
+
+#include <cnr_controller_interface_params/loop_status.h>
+
+namespace cnr
+{
+namespace control
+{
+
+HwLoopStatus* hw_loop_status(const std::string& hw_name)
+{
+  static std::mutex mtx;
+  static std::map<std::string, std::unique_ptr<HwLoopStatus>> registry;
+
+  std::lock_guard<std::mutex> lock(mtx);
+  std::unique_ptr<HwLoopStatus>& status = registry[hw_name];
+  if (!status)
+  {
+    status.reset(new HwLoopStatus());
+  }
+  return status.get();
+}
+
+bool request_serial_update(HwLoopStatus* status, const double& timeout)
+{
+  const uint64_t cycles = status->serial_cycles.load(std::memory_order_acquire);
+  status->serial_requests.fetch_add(1, std::memory_order_acq_rel);
+  if (!status->executor.load(std::memory_order_acquire))
+  {
+    return true;
+  }
+  // a cycle that has seen the request, rather than 'serial' that may have been set by another request
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+  while (status->serial_cycles.load(std::memory_order_acquire) == cycles)
+  {
+    if (std::chrono::steady_clock::now() > deadline)
+    {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+void release_serial_update(HwLoopStatus* status)
+{
+  status->serial_requests.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+namespace
+{
+struct UpdatePhase
+{
+  unsigned int decimation;
+  unsigned int phase;
+};
+std::mutex                                      g_phases_mtx;
+std::map<std::string, std::vector<UpdatePhase>> g_phases;
+
+// std::gcd is C++17, the package is built with the default standard of the toolchain
+unsigned int gcd(unsigned int a, unsigned int b)
+{
+  while (b != 0)
+  {
+    const unsigned int r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+}  // namespace
+
+unsigned int acquire_update_phase(const std::string& hw_name, const unsigned int& decimation)
+{
+  if (decimation <= 1)
+  {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(g_phases_mtx);
+  std::vector<UpdatePhase>& acquired = g_phases[hw_name];
+
+  // two phases coincide on some cycle iff they are congruent modulo the gcd of the decimations
+  unsigned int best = 0;
+  size_t best_cost = std::numeric_limits<size_t>::max();
+  for (unsigned int phase = 0; phase < decimation; phase++)
+  {
+    size_t cost = 0;
+    for (const UpdatePhase& p : acquired)
+    {
+      const unsigned int g = gcd(decimation, p.decimation);
+      cost += ((phase % g) == (p.phase % g)) ? 1 : 0;
+    }
+    if (cost < best_cost)
+    {
+      best = phase;
+      best_cost = cost;
+    }
+  }
+  acquired.push_back({decimation, best});
+  return best;
+}
+
+void release_update_phase(const std::string& hw_name, const unsigned int& decimation, const unsigned int& phase)
+{
+  if (decimation <= 1)
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(g_phases_mtx);
+  std::vector<UpdatePhase>& acquired = g_phases[hw_name];
+  auto it = std::find_if(acquired.begin(), acquired.end(), [&](const UpdatePhase& p)
+  {
+    return p.decimation == decimation && p.phase == phase;
+  });
+  if (it != acquired.end())
+  {
+    acquired.erase(it);
+  }
+}
+
+}  // namespace control
+}  // namespace cnr
@@ -0,0 +1,228 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+#include <cnr_controller_interface_params/periodic_worker_pool.h>
+
+namespace cnr
+{
+namespace control
+{
+
+namespace
+{
+std::chrono::steady_clock::duration to_duration(const double& period)
+{
+  return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+           std::chrono::duration<double>(period > 0 ? period : 1e-3));
+}
+}  // namespace
+
+PeriodicWorkerPool::~PeriodicWorkerPool()
+{
+  shutdown();
+}
+
+bool PeriodicWorkerPool::configure(const size_t& workers, const std::vector<int>& cpus, std::string& error)
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  if (!m_threads.empty())
+  {
+    error = "The workers of the pool are already running";
+    return false;
+  }
+  if (workers == 0)
+  {
+    error = "The pool needs at least one worker";
+    return false;
+  }
+  m_workers = workers;
+  m_cpus    = cpus;
+  return true;
+}
+
+size_t PeriodicWorkerPool::add(const Job& job, const double& period)
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  if (m_threads.empty())
+  {
+    m_stop = false;
+    for (size_t i = 0; i < m_workers; i++)
+    {
+      m_threads.emplace_back(&PeriodicWorkerPool::workerThread, this);
+    }
+  }
+  const size_t id = m_next_id++;
+  Entry& entry = m_jobs[id];
+  entry.job    = job;
+  entry.period = to_duration(period);
+  entry.due    = Clock::now();
+  m_cv.notify_one();
+  return id;
+}
+
+bool PeriodicWorkerPool::setPeriod(const size_t& id, const double& period)
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  auto it = m_jobs.find(id);
+  if (it == m_jobs.end() || it->second.removed)
+  {
+    return false;
+  }
+  it->second.period = to_duration(period);
+  it->second.due    = std::min(it->second.due, Clock::now() + it->second.period);
+  m_cv.notify_all();
+  return true;
+}
+
+void PeriodicWorkerPool::remove(const size_t& id)
+{
+  std::unique_lock<std::mutex> lock(m_mtx);
+  auto it = m_jobs.find(id);
+  if (it == m_jobs.end())
+  {
+    return;
+  }
+  if (it->second.running)
+  {
+    it->second.removed = true;
+    m_done_cv.wait(lock, [&]() { return m_jobs.find(id) == m_jobs.end(); });
+    return;
+  }
+  m_jobs.erase(it);
+}
+
+void PeriodicWorkerPool::shutdown()
+{
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_stop = true;
+    threads.swap(m_threads);
+  }
+  m_cv.notify_all();
+  for (std::thread& t : threads)
+  {
+    if (t.joinable())
+    {
+      t.join();
+    }
+  }
+  std::lock_guard<std::mutex> lock(m_mtx);
+  m_jobs.clear();
+  m_done_cv.notify_all();
+}
+
+size_t PeriodicWorkerPool::workers() const
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_threads.size();
+}
+
+size_t PeriodicWorkerPool::jobs() const
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_jobs.size();
+}
+
+uint64_t PeriodicWorkerPool::runs(const size_t& id) const
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  auto it = m_jobs.find(id);
+  return it != m_jobs.end() ? it->second.runs : 0;
+}
+
+void PeriodicWorkerPool::workerThread()
+{
+  std::unique_lock<std::mutex> lock(m_mtx);
+  if (!m_cpus.empty())
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int& cpu : m_cpus)
+    {
+      CPU_SET(cpu, &set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  while (!m_stop)
+  {
+    auto next = m_jobs.end();
+    for (auto it = m_jobs.begin(); it != m_jobs.end(); ++it)
+    {
+      if (!it->second.running && !it->second.removed && (next == m_jobs.end() || it->second.due < next->second.due))
+      {
+        next = it;
+      }
+    }
+    if (next == m_jobs.end())
+    {
+      m_cv.wait(lock);
+      continue;
+    }
+    if (next->second.due > Clock::now())
+    {
+      m_cv.wait_until(lock, next->second.due);
+      continue;
+    }
+
+    // the entries of the map are stable, and the running entry is not erased by the others
+    Entry& entry = next->second;
+    entry.running = true;
+    lock.unlock();
+    entry.job();
+    lock.lock();
+    entry.running = false;
+    entry.runs++;
+    const Clock::time_point now = Clock::now();
+    entry.due += entry.period;
+    if (entry.due < now)
+    {
+      entry.due = now + entry.period;
+    }
+    if (entry.removed)
+    {
+      m_jobs.erase(next);
+      m_done_cv.notify_all();
+    }
+    m_cv.notify_one();
+  }
+}
+
+}  // namespace control
+}  // namespace cnr
@@ -0,0 +1,111 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ctime>
+#include <system_error>
+
+#include <cnr_controller_interface_params/realtime_publisher.h>
+
+namespace cnr
+{
+namespace control
+{
+
+RealtimePublishingThread::RealtimePublishingThread()
+  : m_stop(true)
+{
+  sem_init(&m_sem, 0, 0);
+}
+
+RealtimePublishingThread::~RealtimePublishingThread()
+{
+  stop();
+  sem_destroy(&m_sem);
+}
+
+void RealtimePublishingThread::add(const std::shared_ptr<RealtimePublisherBase>& publisher)
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  m_publishers.push_back(publisher);
+  if (!m_thread.joinable())
+  {
+    m_stop = false;
+    m_thread = std::thread(&RealtimePublishingThread::run, this);
+  }
+}
+
+void RealtimePublishingThread::stop()
+{
+  m_stop = true;
+  sem_post(&m_sem);
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+  std::lock_guard<std::mutex> lock(m_mtx);
+  for (auto& p : m_publishers)
+  {
+    p->drain();
+  }
+  m_publishers.clear();
+}
+
+void RealtimePublishingThread::run()
+{
+  while (!m_stop)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += 100000000L;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+      ts.tv_sec  += 1;
+      ts.tv_nsec -= 1000000000L;
+    }
+    int ret = sem_timedwait(&m_sem, &ts);
+    while (ret == 0 && sem_trywait(&m_sem) == 0)
+    {
+      // coalesce the pending posts
+    }
+
+    std::lock_guard<std::mutex> lock(m_mtx);
+    for (auto& p : m_publishers)
+    {
+      p->drain();
+    }
+  }
+}
+
+}  // namespace control
+}  // namespace cnr
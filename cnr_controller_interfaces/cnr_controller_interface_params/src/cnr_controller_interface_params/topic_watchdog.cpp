@@ -0,0 +1,163 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <map>
+#include <cmath>
+
+#include <cnr_controller_interface_params/topic_watchdog.h>
+
+namespace cnr
+{
+namespace control
+{
+
+void TopicArrival::received(const int64_t& stamp_ns)
+{
+  if (stamp_ns <= 0)
+  {
+    return;
+  }
+  const int64_t  last     = m_last.load(std::memory_order_relaxed);
+  const uint64_t messages = m_messages.load(std::memory_order_relaxed);
+  if (last > 0)
+  {
+    const double dt   = 1e-9 * static_cast<double>(stamp_ns - last);
+    double       mean = m_mean.load(std::memory_order_relaxed);
+    mean = messages == 1 ? dt : mean + EWMA_GAIN * (dt - mean);
+    const double jitter = m_jitter.load(std::memory_order_relaxed);
+    m_mean.store(mean, std::memory_order_relaxed);
+    m_jitter.store(messages == 1 ? 0.0 : jitter + EWMA_GAIN * (std::fabs(dt - mean) - jitter),
+                   std::memory_order_relaxed);
+  }
+  m_messages.store(messages + 1, std::memory_order_relaxed);
+  m_last.store(stamp_ns, std::memory_order_release);
+}
+
+TopicArrivalSummary TopicArrival::summary() const
+{
+  TopicArrivalSummary ret;
+  ret.topic    = m_topic;
+  ret.tracked  = m_tracked;
+  ret.messages = m_messages.load(std::memory_order_relaxed);
+  ret.mean     = m_mean.load(std::memory_order_relaxed);
+  ret.jitter   = m_jitter.load(std::memory_order_relaxed);
+  ret.timeout  = m_timeout.load(std::memory_order_relaxed);
+  ret.misses   = m_misses.load(std::memory_order_relaxed);
+  const int64_t last = m_last.load(std::memory_order_acquire);
+  const int64_t now  = m_now.load(std::memory_order_relaxed);
+  ret.silence  = (last > 0 && now > last) ? 1e-9 * static_cast<double>(now - last) : 0.0;
+  return ret;
+}
+
+std::shared_ptr<TopicArrival> TopicWatchdog::add(const std::string& topic, const bool& tracked)
+{
+  std::shared_ptr<TopicArrival> ret(new TopicArrival(topic, tracked));
+  std::lock_guard<std::mutex> lock(m_mtx);
+  m_topics.push_back(ret);
+  return ret;
+}
+
+void TopicWatchdog::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  m_topics.clear();
+}
+
+void TopicWatchdog::setTimeout(const double& timeout)
+{
+  m_timeout = static_cast<int64_t>(timeout * 1e9);
+}
+
+std::vector<TopicArrivalSummary> TopicWatchdog::summary() const
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  std::vector<TopicArrivalSummary> ret;
+  ret.reserve(m_topics.size());
+  for (const auto& t : m_topics)
+  {
+    ret.push_back(t->summary());
+    ret.back().watchdog = 1e-9 * static_cast<double>(m_timeout);
+  }
+  return ret;
+}
+
+namespace
+{
+std::mutex                                                    g_watchdogs_mtx;
+std::map<std::string, std::map<std::string, TopicWatchdog*>>  g_watchdogs;
+}  // namespace
+
+void register_topic_watchdog(const std::string& hw_name, const std::string& ctrl_name, TopicWatchdog* watchdog)
+{
+  std::lock_guard<std::mutex> lock(g_watchdogs_mtx);
+  g_watchdogs[hw_name][ctrl_name] = watchdog;
+}
+
+void unregister_topic_watchdog(const std::string& hw_name, const std::string& ctrl_name, TopicWatchdog* watchdog)
+{
+  std::lock_guard<std::mutex> lock(g_watchdogs_mtx);
+  auto hw = g_watchdogs.find(hw_name);
+  if (hw == g_watchdogs.end())
+  {
+    return;
+  }
+  auto it = hw->second.find(ctrl_name);
+  if (it != hw->second.end() && it->second == watchdog)
+  {
+    hw->second.erase(it);
+  }
+}
+
+std::vector<TopicArrivalSummary> topic_watchdogs(const std::string& hw_name)
+{
+  std::vector<TopicArrivalSummary> ret;
+  std::lock_guard<std::mutex> lock(g_watchdogs_mtx);
+  auto hw = g_watchdogs.find(hw_name);
+  if (hw == g_watchdogs.end())
+  {
+    return ret;
+  }
+  for (const auto& w : hw->second)
+  {
+    for (auto& s : w.second->summary())
+    {
+      s.controller = w.first;
+      ret.push_back(s);
+    }
+  }
+  return ret;
+}
+
+}  // namespace control
+}  // namespace cnr
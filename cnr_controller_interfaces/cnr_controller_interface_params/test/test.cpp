@@ -33,15 +33,502 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <mutex>
+#include <chrono>
+#include <thread>
 #include <iostream>
 #include <ros/ros.h>
 #include <gtest/gtest.h>
+#include <cnr_controller_interface_params/realtime_buffers.h>
+#include <cnr_controller_interface_params/allocation_sentinel.h>
+#include <cnr_controller_interface_params/loop_status.h>
+#include <cnr_controller_interface_params/fork_join_executor.h>
+#include <cnr_controller_interface_params/controller_cost.h>
+#include <cnr_controller_interface_params/realtime_publisher.h>
+#include <cnr_controller_interface_params/topic_watchdog.h>
+#include <cnr_controller_interface_params/periodic_worker_pool.h>
+#include <controller_manager_msgs/ControllerState.h>
 
 // Declare a test
 TEST(TestSuite, fullConstructor)
 {
 }
 
+TEST(TestSuite, tripleBuffer)
+{
+  cnr::control::TripleBuffer<std::vector<double>> buffer;
+  buffer.reset(std::vector<double>(3, 0.0));
+  EXPECT_FALSE(buffer.update());
+
+  buffer.writeBuffer().at(0) = 1.0;
+  buffer.publish();
+  buffer.writeBuffer().at(0) = 2.0;
+  buffer.publish();
+  EXPECT_TRUE(buffer.update());
+  EXPECT_EQ(buffer.readBuffer().at(0), 2.0);  // only the latest value is delivered
+  EXPECT_FALSE(buffer.update());
+  EXPECT_EQ(buffer.readBuffer().size(), 3u);
+}
+
+TEST(TestSuite, mailbox)
+{
+  cnr::control::Mailbox<std::vector<double>> mailbox;
+  bool fresh = true;
+  EXPECT_EQ(mailbox.read(&fresh), nullptr);
+  EXPECT_FALSE(fresh);
+
+  mailbox.write({1.0, 2.0});
+  mailbox.write({3.0, 4.0});
+  const std::vector<double>* v = mailbox.read(&fresh);
+  ASSERT_NE(v, nullptr);
+  EXPECT_TRUE(fresh);
+  EXPECT_EQ(v->at(0), 3.0);
+
+  v = mailbox.read(&fresh);  // still the latest value, not fresh
+  ASSERT_NE(v, nullptr);
+  EXPECT_FALSE(fresh);
+  EXPECT_EQ(v->at(1), 4.0);
+}
+
+TEST(TestSuite, spscQueue)
+{
+  cnr::control::SpscQueue<int, 4> queue;
+  int value;
+  EXPECT_FALSE(queue.pop(value));
+  for (int i = 0; i < 4; i++)
+  {
+    EXPECT_TRUE(queue.push(i));
+  }
+  EXPECT_FALSE(queue.push(4));
+  for (int i = 0; i < 4; i++)
+  {
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(TestSuite, seqLock)
+{
+  cnr::control::SeqLock<std::array<int, 4>> lock;
+  lock.reset({0, 0, 0, 0});
+  std::atomic<bool> stop(false);
+  std::thread writer([&]()
+  {
+    for (int k = 1; !stop; k++)
+    {
+      lock.write([k](std::array<int, 4>& v) { v.fill(k); });
+    }
+  });
+  while (lock.writes() < 10000)
+  {
+    std::array<int, 4> copy;
+    lock.read([&copy](const std::array<int, 4>& v) { copy = v; });
+    EXPECT_EQ(copy[0], copy[3]);
+  }
+  stop = true;
+  writer.join();
+}
+
+//! the exchange of the JointController with the kinematics thread: joint state out through the SeqLock,
+//! results back through the TripleBuffer, each result consistent with the joint state it comes from
+TEST(TestSuite, kinematicsHandOff)
+{
+  struct Sample
+  {
+    std::vector<double> values;
+    uint64_t            stamp = 0;
+  };
+  Sample zero;
+  zero.values.assign(6, 0.0);
+  cnr::control::SeqLock<Sample>      joints;
+  cnr::control::TripleBuffer<Sample> results;
+  joints.reset(zero);
+  results.reset(zero);
+
+  std::atomic<bool> stop(false);
+  std::thread kinematics([&]()
+  {
+    Sample in = zero;
+    while (!stop)
+    {
+      joints.read([&in](const Sample& s) { in.values = s.values; in.stamp = s.stamp; });
+      Sample& out = results.writeBuffer();
+      out.stamp = in.stamp;
+      for (size_t i = 0; i < in.values.size(); i++)
+      {
+        out.values[i] = 2.0 * in.values[i];
+      }
+      results.publish();
+    }
+  });
+
+  uint64_t merged = 0;
+  uint64_t last_stamp = 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  for (uint64_t cycle = 1; merged < 1000 && std::chrono::steady_clock::now() < deadline; cycle++)
+  {
+    joints.write([cycle](Sample& s)
+    {
+      std::fill(s.values.begin(), s.values.end(), static_cast<double>(cycle));
+      s.stamp = cycle;
+    });
+    if (results.update())
+    {
+      const Sample& r = results.readBuffer();
+      for (const double& v : r.values)
+      {
+        ASSERT_EQ(v, 2.0 * r.stamp);  // not torn, and computed from the joint state of 'stamp'
+      }
+      ASSERT_GE(r.stamp, last_stamp);
+      ASSERT_LE(r.stamp, cycle);
+      last_stamp = r.stamp;
+      merged++;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(20));  // the period of the loop
+  }
+  stop = true;
+  kinematics.join();
+  EXPECT_EQ(merged, 1000u);
+}
+
+// volatile, so that the compiler does not elide the new/delete pairs of the test
+std::vector<double>* volatile g_vector_sink;
+double* volatile g_double_sink;
+struct alignas(64) AlignedSample
+{
+  double value[8];
+};
+AlignedSample* volatile g_aligned_sink;
+
+TEST(TestSuite, allocationSentinel)
+{
+  cnr::control::AllocationCounter phase, ctrl;
+  cnr::control::allocation_sentinel::registerCounter("hw/ctrl", &ctrl);
+  cnr::control::allocation_sentinel::enable();
+  {
+    cnr::control::AllocationScope phase_scope(&phase);
+    {
+      cnr::control::AllocationScope ctrl_scope(&ctrl);
+      g_vector_sink = new std::vector<double>(10, 0.0);
+      delete g_vector_sink;
+    }
+    g_double_sink = new double(1.0);
+    delete g_double_sink;
+    g_aligned_sink = new AlignedSample();
+    delete g_aligned_sink;
+  }
+  cnr::control::allocation_sentinel::disable();
+  EXPECT_FALSE(cnr::control::allocation_sentinel::enabled());
+
+  const uint64_t expected = cnr::control::allocation_sentinel::compiled() ? 1 : 0;
+  EXPECT_EQ(ctrl.get().allocations, 2 * expected);
+  EXPECT_EQ(ctrl.get().frees, 2 * expected);
+  EXPECT_EQ(phase.get().allocations, 4 * expected);
+  EXPECT_EQ(phase.get().frees, 4 * expected);
+
+  auto counters = cnr::control::allocation_sentinel::registered("hw/");
+  ASSERT_EQ(counters.size(), 1u);
+  EXPECT_EQ(counters.front().first, "hw/ctrl");
+  cnr::control::allocation_sentinel::unregisterCounter("hw/ctrl", &ctrl);
+  EXPECT_TRUE(cnr::control::allocation_sentinel::registered("hw/").empty());
+}
+
+TEST(TestSuite, updatePhases)
+{
+  EXPECT_EQ(cnr::control::acquire_update_phase("hw_phases", 1), 0u);
+  EXPECT_EQ(cnr::control::acquire_update_phase("hw_phases", 10), 0u);
+  EXPECT_EQ(cnr::control::acquire_update_phase("hw_phases", 10), 1u);
+  EXPECT_EQ(cnr::control::acquire_update_phase("hw_phases", 2), 0u);   // both phases meet one of the two
+  EXPECT_EQ(cnr::control::acquire_update_phase("hw_phases", 10), 3u);  // the first phase met by none
+  EXPECT_EQ(cnr::control::acquire_update_phase("other_hw", 10), 0u);
+
+  cnr::control::release_update_phase("hw_phases", 10, 1);
+  EXPECT_EQ(cnr::control::acquire_update_phase("hw_phases", 10), 1u);
+}
+
+//! polls 'pred' until it holds or the deadline expires, so that a loaded machine does not break the test
+template<class Predicate>
+bool wait_until(Predicate pred, const double& timeout)
+{
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+  while (!pred() && std::chrono::steady_clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return pred();
+}
+
+TEST(TestSuite, serialUpdate)
+{
+  cnr::control::HwLoopStatus* status = cnr::control::hw_loop_status("hw_serial");
+  EXPECT_TRUE(cnr::control::request_serial_update(status, 0.01));  // no executor, no fork
+  cnr::control::release_serial_update(status);
+
+  cnr::control::ForkJoinExecutor executor;
+  status->executor.store(&executor);
+  EXPECT_FALSE(cnr::control::request_serial_update(status, 0.01));  // the loop does not cycle
+  cnr::control::release_serial_update(status);
+  EXPECT_EQ(status->serial_requests.load(), 0u);
+
+  // the wake-up of the cycles of the driver
+  std::atomic<bool> stop(false);
+  std::thread loop([&]()
+  {
+    while (!stop)
+    {
+      const bool serial = status->serial_requests.load() != 0;
+      status->serial.store(serial);
+      if (serial)
+      {
+        status->serial_cycles++;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  EXPECT_TRUE(cnr::control::request_serial_update(status, 5.0));
+  EXPECT_TRUE(status->serial.load());
+  cnr::control::release_serial_update(status);
+  EXPECT_TRUE(wait_until([&]() { return !status->serial.load(); }, 5.0));
+  stop = true;
+  loop.join();
+  status->executor.store(nullptr);
+}
+
+struct ForkedTask
+{
+  std::vector<int>* trace;
+  int value;
+  static void run(void* arg)
+  {
+    ForkedTask* t = static_cast<ForkedTask*>(arg);
+    t->trace->push_back(t->value);
+  }
+  std::thread::id joined_by;
+  size_t          joined_after = 0;  //!< size of the trace when the 'joined' callback runs
+  static void joined(void* arg)
+  {
+    ForkedTask* t = static_cast<ForkedTask*>(arg);
+    t->joined_by = std::this_thread::get_id();
+    t->joined_after = t->trace->size();
+  }
+};
+
+TEST(TestSuite, forkJoinExecutor)
+{
+  cnr::control::ForkJoinExecutor executor;
+  std::string error;
+  std::vector<size_t> initialized;
+  std::mutex mtx;
+  ASSERT_TRUE(executor.start(2, [&](const size_t& i) { std::lock_guard<std::mutex> lock(mtx); initialized.push_back(i); },
+                             error)) << error;
+  EXPECT_EQ(executor.workers(), 2u);
+
+  std::vector<int> lane0, lane1;
+  lane0.reserve(100);
+  lane1.reserve(100);
+  std::vector<ForkedTask> tasks;
+  for (int i = 0; i < 20; i++)
+  {
+    tasks.push_back({(i % 2) ? &lane1 : &lane0, i});
+  }
+  for (int cycle = 0; cycle < 5; cycle++)
+  {
+    lane0.clear();
+    lane1.clear();
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+      ASSERT_TRUE(executor.fork(i % 2, &ForkedTask::run, &tasks[i]));
+    }
+    executor.join();
+    ASSERT_EQ(lane0.size(), 10u);
+    ASSERT_EQ(lane1.size(), 10u);
+    for (size_t i = 0; i < 10; i++)
+    {
+      EXPECT_EQ(lane0[i], static_cast<int>(2 * i));      // the tasks of a lane run in order
+      EXPECT_EQ(lane1[i], static_cast<int>(2 * i + 1));
+    }
+  }
+
+  // the 'joined' callbacks run on the thread of join(), after all the tasks
+  lane0.clear();
+  lane1.clear();
+  for (size_t i = 0; i < tasks.size(); i++)
+  {
+    ASSERT_TRUE(executor.fork(i % 2, &ForkedTask::run, &tasks[i], (i == 0) ? &ForkedTask::joined : nullptr));
+  }
+  executor.join();
+  EXPECT_EQ(tasks[0].joined_by, std::this_thread::get_id());
+  EXPECT_EQ(tasks[0].joined_after, 10u);
+  EXPECT_EQ(tasks[1].joined_by, std::thread::id());
+
+  executor.stop();
+  EXPECT_EQ(initialized.size(), 2u);
+  EXPECT_FALSE(executor.fork(0, &ForkedTask::run, &tasks[0]));
+}
+
+TEST(TestSuite, claimsGroups)
+{
+  cnr::control::ClaimGroups* groups = cnr::control::claim_groups("hw_claims");
+  const std::atomic<int>* a = cnr::control::register_claims("hw_claims", "a", {"j1"});
+  const std::atomic<int>* b = cnr::control::register_claims("hw_claims", "b", {"j2"});
+  const std::atomic<int>* c = cnr::control::register_claims("hw_claims", "c", {"j2", "j3"});
+  EXPECT_EQ(a->load(), -1);  // not yet swapped in by the loop
+  groups->swap();
+  EXPECT_NE(a->load(), b->load());
+  EXPECT_EQ(b->load(), c->load());
+
+  // the new mapping is published, but the groups in use change only at the swap
+  const int a0 = a->load();
+  const int b0 = b->load();
+  cnr::control::register_claims("hw_claims", "d", {"j1", "j3"});  // it joins all the groups
+  EXPECT_EQ(a->load(), a0);
+  EXPECT_EQ(b->load(), b0);
+  groups->swap();
+  EXPECT_EQ(a->load(), b->load());
+
+  cnr::control::unregister_claims("hw_claims", "d");
+  groups->swap();
+  EXPECT_NE(a->load(), b->load());
+  EXPECT_EQ(b->load(), c->load());
+}
+
+TEST(TestSuite, controllerCost)
+{
+  cnr::control::ControllerCost cheap(1000000);
+  cnr::control::ControllerCost expensive(1000000);
+  for (int i = 0; i < 100; i++)
+  {
+    cheap.record(10000, false);
+    expensive.record(i < 99 ? 200000 : 900000, i == 99);
+    expensive.tick();  // decimation 2
+  }
+  cnr::control::register_controller_cost("hw_cost", "cheap", &cheap);
+  cnr::control::register_controller_cost("hw_cost", "expensive", &expensive);
+
+  std::vector<cnr::control::ControllerCostSummary> costs = cnr::control::controller_costs("hw_cost");
+  ASSERT_EQ(costs.size(), 2u);
+  EXPECT_EQ(costs[0].name, "expensive");
+  EXPECT_EQ(costs[0].updates, 100u);
+  EXPECT_EQ(costs[0].cycles, 200u);
+  EXPECT_EQ(costs[0].deadline_misses, 1u);
+  EXPECT_EQ(costs[0].max, 900000);
+  EXPECT_NEAR(costs[0].p50, 200000, 200000 / 16);
+  EXPECT_NEAR(costs[0].share(), 0.1035, 1e-6);
+  EXPECT_NEAR(costs[1].share(), 0.01, 1e-6);
+
+  cnr::control::unregister_controller_cost("hw_cost", "cheap", &expensive);  // not the registered one
+  EXPECT_EQ(cnr::control::controller_costs("hw_cost").size(), 2u);
+  cnr::control::unregister_controller_cost("hw_cost", "cheap", &cheap);
+  EXPECT_EQ(cnr::control::controller_costs("hw_cost").size(), 1u);
+}
+
+TEST(TestSuite, realtimePublisher)
+{
+  ros::NodeHandle nh("~");
+  cnr::control::RealtimePublisher<controller_manager_msgs::ControllerState, 4> pub(nh, "rt_pub", 10, false, 2, nullptr);
+  controller_manager_msgs::ControllerState msg;
+  msg.name = "ctrl";
+  pub.reset(msg);
+  for (int i = 0; i < 8; i++)
+  {
+    EXPECT_TRUE(pub.publish(msg));  // 4 out of 8 fill the pool
+  }
+  EXPECT_FALSE(pub.publish(msg));   // the pool is full
+  EXPECT_TRUE(pub.publish(msg));    // decimated
+  EXPECT_EQ(pub.dropped(), 1u);
+  EXPECT_EQ(pub.drain(), 4u);
+  EXPECT_EQ(pub.published(), 4u);
+
+  controller_manager_msgs::ControllerState* slot = pub.acquire();
+  ASSERT_NE(slot, nullptr);
+  EXPECT_EQ(slot->name, "ctrl");
+  pub.commit();
+  EXPECT_EQ(pub.acquire(), nullptr);  // decimated
+  EXPECT_EQ(pub.drain(), 1u);
+
+  cnr::control::RealtimePublishingThread thread;
+  std::shared_ptr<cnr::control::RealtimePublisher<controller_manager_msgs::ControllerState>> rt_pub(
+    new cnr::control::RealtimePublisher<controller_manager_msgs::ControllerState>(nh, "rt_pub_thread", 10, false, 1,
+                                                                                  &thread));
+  thread.add(rt_pub);
+  EXPECT_TRUE(rt_pub->publish(msg));
+  for (int i = 0; i < 100 && rt_pub->published() == 0; i++)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(rt_pub->published(), 1u);
+  EXPECT_TRUE(rt_pub->publish(msg));
+  thread.stop();  // the pending message is published before stopping
+  EXPECT_EQ(rt_pub->published(), 2u);
+}
+
+TEST(TestSuite, topicWatchdog)
+{
+  cnr::control::TopicWatchdog watchdog;
+  watchdog.setTimeout(0.1);
+  std::shared_ptr<cnr::control::TopicArrival> tracked = watchdog.add("/tracked", true);
+  std::shared_ptr<cnr::control::TopicArrival> untracked = watchdog.add("/untracked", false);
+  cnr::control::register_topic_watchdog("hw_watchdog", "ctrl", &watchdog);
+
+  const int64_t ms = 1000000;
+  tracked->received(0);                       // before the first cycle of the loop: not counted
+  EXPECT_EQ(watchdog.check(1000 * ms), 0u);  // nothing received yet
+  for (int i = 0; i < 10; i++)
+  {
+    tracked->received((1000 + 10 * i) * ms);
+    untracked->received((1000 + 10 * i) * ms);
+  }
+  EXPECT_EQ(watchdog.check(1100 * ms), 0u);
+  EXPECT_EQ(watchdog.check(1200 * ms), 1u);  // 110ms of silence
+  EXPECT_EQ(watchdog.check(1201 * ms), 1u);  // the same timeout
+  tracked->received(1202 * ms);
+  EXPECT_EQ(watchdog.check(1203 * ms), 0u);
+
+  std::vector<cnr::control::TopicArrivalSummary> topics = cnr::control::topic_watchdogs("hw_watchdog");
+  ASSERT_EQ(topics.size(), 2u);
+  EXPECT_EQ(topics[0].controller, "ctrl");
+  EXPECT_EQ(topics[0].topic, "/tracked");
+  EXPECT_EQ(topics[0].messages, 11u);
+  EXPECT_EQ(topics[0].misses, 1u);
+  EXPECT_FALSE(topics[0].timeout);
+  EXPECT_NEAR(topics[1].mean, 0.01, 1e-9);
+  EXPECT_NEAR(topics[1].jitter, 0.0, 1e-9);
+  EXPECT_EQ(topics[1].misses, 0u);
+
+  cnr::control::unregister_topic_watchdog("hw_watchdog", "ctrl", &watchdog);
+  EXPECT_TRUE(cnr::control::topic_watchdogs("hw_watchdog").empty());
+}
+
+
+TEST(TestSuite, periodicWorkerPool)
+{
+  cnr::control::PeriodicWorkerPool pool;
+  std::string error;
+  EXPECT_FALSE(pool.configure(0, {}, error));
+  EXPECT_TRUE(pool.configure(2, {}, error));
+
+  std::atomic<int> fast(0);
+  std::atomic<int> slow(0);
+  size_t id_fast = pool.add([&]() { fast++; }, 0.001);
+  size_t id_slow = pool.add([&]() { slow++; }, 3600.0);
+  EXPECT_FALSE(pool.configure(1, {}, error));
+  EXPECT_EQ(pool.workers(), 2u);
+  EXPECT_EQ(pool.jobs(), 2u);
+
+  EXPECT_TRUE(wait_until([&]() { return fast > 5 && slow == 1; }, 5.0));
+  pool.remove(id_fast);
+  EXPECT_EQ(slow, 1);  // the first run is immediate, the second is after the period
+  EXPECT_EQ(pool.jobs(), 1u);
+  const int runs = fast;  // remove() waits for a run in progress
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(fast, runs);
+
+  EXPECT_TRUE(pool.setPeriod(id_slow, 0.001));
+  EXPECT_TRUE(wait_until([&]() { return pool.runs(id_slow) > 1u; }, 5.0));
+  pool.shutdown();
+  EXPECT_EQ(pool.jobs(), 0u);
+}
 
 // Run all the tests that were declared with TEST()
 int main(int argc, char **argv)
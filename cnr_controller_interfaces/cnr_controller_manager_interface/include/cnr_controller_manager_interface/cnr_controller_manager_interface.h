@@ -48,7 +48,9 @@
 #include <controller_manager/controller_manager.h>
 #include <cnr_controller_manager_interface/internal/utils.h>
 #include <diagnostic_updater/DiagnosticStatusWrapper.h>
+#include <realtime_utilities/diagnostics_interface.h>
 
+#include <cnr_controller_interface_params/loop_status.h>
 #include <cnr_controller_manager_interface/internal/cnr_controller_manager_interface_base.h>
 
 namespace cnr_controller_manager_interface
@@ -72,6 +74,15 @@ protected:
   controller_manager::ControllerManager* cm_;
   std::map<std::string, controller_interface::ControllerBase* > controllers_;
 
+  //! The controllers that provide diagnostics, cast once when they are loaded (guarded by mtx_)
+  std::map<std::string, realtime_utilities::DiagnosticsInterface* > diagnostics_;
+
+  //! Number of controllers listed in diagnosticsCost() (param '/<hw_name>/cost_report/top_n', default 5)
+  size_t cost_report_top_n_;
+
+  //! The loop of the hw: the switches of the controllers are made with no forked update (see switchController)
+  cnr::control::HwLoopStatus* loop_status_;
+
 public:
   typedef std::shared_ptr<ControllerManagerInterface> Ptr;
   typedef std::shared_ptr<ControllerManagerInterface const> ConstPtr;
@@ -136,6 +147,9 @@ public:
    * are ready, will wait for all resources to be ready otherwise.
    * \param timeout The timeout in seconds before aborting pending
    * controllers. Zero for infinite.
+   *
+   * The loop of the hw updates all the controllers on its thread (no fork) from a cycle before the switch
+   * until the switch is done.
    */
   bool switchController(const std::vector<std::string>&  to_start_names,
                         const std::vector<std::string>&  to_stop_unload_names, 
@@ -191,6 +205,10 @@ public:
    * When controllers are started or stopped (or switched), those calls are
    * made in this function.
    *
+   * The controllers derived from cnr::control::Controller<T> with the param 'decimation' (or 'rate')
+   * are updated once every 'decimation' calls, with staggered phases, and they get the time elapsed
+   * since their previous update as period.
+   *
    * \param time The current time
    * \param period The change in time since the last call to \ref update
    * \param reset_controllers If \c true, stop and start all running
@@ -217,6 +235,14 @@ public:
   void diagnosticsWarn(diagnostic_updater::DiagnosticStatusWrapper &stat);
   void diagnosticsError(diagnostic_updater::DiagnosticStatusWrapper &stat);
   void diagnosticsPerformance(diagnostic_updater::DiagnosticStatusWrapper &stat);
+
+  /** \brief Aggregated cost of the controllers derived from cnr::control::Controller<T> on this hw
+   *
+   * For the most expensive controllers (ranked by total update time): the share of the update budget
+   * (sampling period) used on average per cycle, the percentiles of the update time, and the cycles in
+   * which the controller was running when the deadline of the loop expired.
+   */
+  void diagnosticsCost(diagnostic_updater::DiagnosticStatusWrapper &stat);
   /*\}*/
 
 };
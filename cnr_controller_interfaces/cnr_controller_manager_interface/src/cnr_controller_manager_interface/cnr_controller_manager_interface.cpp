@@ -40,8 +40,12 @@
 #include <atomic>
 #include <string>
 #include <thread>
+#include <sstream>
+#include <iomanip>
 #include <realtime_utilities/diagnostics_interface.h>
 #include <cnr_controller_interface_params/cnr_controller_interface_params.h>
+#include <cnr_controller_interface_params/controller_cost.h>
+#include <cnr_controller_interface_params/topic_watchdog.h>
 #include <cnr_controller_manager_interface/cnr_controller_manager_interface.h>
 
 namespace cnr_controller_manager_interface
@@ -55,9 +59,14 @@ namespace cnr_controller_manager_interface
 ControllerManagerInterface::ControllerManagerInterface(const cnr_logger::TraceLoggerPtr& log,
                                      const std::string& hw_name,
                                      controller_manager::ControllerManager* cm)
-: ControllerManagerInterfaceBase( log, hw_name ), cm_(cm)
+: ControllerManagerInterfaceBase( log, hw_name ), cm_(cm), cost_report_top_n_(5)
+, loop_status_(cnr::control::hw_loop_status(hw_name))
 {
-  
+  int top_n = 5;
+  if (ros::param::get("/" + hw_name + "/cost_report/top_n", top_n) && (top_n > 0))
+  {
+    cost_report_top_n_ = static_cast<size_t>(top_n);
+  }
 }
 
 ControllerManagerInterface::~ControllerManagerInterface()
@@ -73,6 +82,10 @@ ControllerManagerInterface::~ControllerManagerInterface()
       ctrl.second = nullptr;
     }
     controllers_.clear();
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      diagnostics_.clear();
+    }
     cm_ = nullptr;
   }
   catch(const std::exception& e)
@@ -119,7 +132,14 @@ bool ControllerManagerInterface::loadController(const std::string& ctrl_to_load_
     ros::param::set(n, l);
   }
 
-  controllers_.emplace( ctrl_to_load_name, cm_->getControllerByName(ctrl_to_load_name) );
+  controller_interface::ControllerBase* ctrl = cm_->getControllerByName(ctrl_to_load_name);
+  controllers_.emplace( ctrl_to_load_name, ctrl );
+  realtime_utilities::DiagnosticsInterface* diagnostics = dynamic_cast<realtime_utilities::DiagnosticsInterface*>(ctrl);
+  if(diagnostics)
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    diagnostics_[ctrl_to_load_name] = diagnostics;
+  }
   
   CNR_RETURN_TRUE(logger_, "HW: " + getHwName() + ", CTRL: " + ctrl_to_load_name);
 }
@@ -180,8 +200,16 @@ bool ControllerManagerInterface::switchController(const std::vector<std::string>
     CNR_RETURN_TRUE(logger_, "HW: " + getHwName());
   }
 
+  // the controller manager starts and stops the controllers in its update(), right after the updates of the
+  // controllers, and before the driver joins the forked ones: the loop stops forking until the switch is done
+  if (!cnr::control::request_serial_update(loop_status_, std::max(watchdog.toSec(), 1.0)))
+  {
+    CNR_WARN(logger_, "HW: " + getHwName() + " The loop does not cycle, switch with no wait for it");
+  }
   CNR_DEBUG(logger_, "HW: " + getHwName() + " Call the switchController of the ControllerManager");
-  if (!cm_->switchController(start_controllers, stop_controllers, strictness) )
+  const bool switched = cm_->switchController(start_controllers, stop_controllers, strictness);
+  cnr::control::release_serial_update(loop_status_);
+  if (!switched)
   {
     error_ = "The ControllerManagerInterface failed in switchin the controller. Abort.";
     CNR_RETURN_FALSE(logger_, "HW: " + getHwName());
@@ -296,6 +324,8 @@ bool ControllerManagerInterface::unloadController(const std::string& ctrl_to_unl
     {
       controllers_.erase( controllers_.find(ctrl_to_unload_name) );
     }
+    std::lock_guard<std::mutex> lock(mtx_);
+    diagnostics_.erase(ctrl_to_unload_name);
   }
 
   CNR_RETURN_BOOL(logger_, ret, "HW: "+ getHwName()+", CTRL: " + ctrl_to_unload_name);
@@ -309,14 +339,9 @@ bool ControllerManagerInterface::unloadController(const std::string& ctrl_to_unl
 void ControllerManagerInterface::diagnosticsInfo(diagnostic_updater::DiagnosticStatusWrapper &stat)
 {
   std::lock_guard<std::mutex> lock(mtx_);
-  for ( const auto & ctrl : controllers_)
+  for ( const auto & ctrl : diagnostics_)
   {
-    realtime_utilities::DiagnosticsInterface* cnr_ctrl =
-                                    dynamic_cast<realtime_utilities::DiagnosticsInterface*>(ctrl.second);
-    if(cnr_ctrl)
-    {
-      cnr_ctrl->diagnosticsInfo(stat);
-    }
+    ctrl.second->diagnosticsInfo(stat);
   }
 }
 
@@ -328,13 +353,28 @@ void ControllerManagerInterface::diagnosticsInfo(diagnostic_updater::DiagnosticS
 void ControllerManagerInterface::diagnosticsWarn(diagnostic_updater::DiagnosticStatusWrapper &stat)
 {
   std::lock_guard<std::mutex> lock(mtx_);
-  for ( const auto & ctrl : controllers_)
+  for ( const auto & ctrl : diagnostics_)
   {
-    realtime_utilities::DiagnosticsInterface* cnr_ctrl =
-                                    dynamic_cast<realtime_utilities::DiagnosticsInterface*>(ctrl.second);
-    if( cnr_ctrl )
+    ctrl.second->diagnosticsWarn(stat);
+  }
+
+  // the watchdog of the subscribed topics: checked by the RT loop, formatted here
+  for ( const auto & t : cnr::control::topic_watchdogs(getHwName()))
+  {
+    if (!t.tracked)
     {
-      cnr_ctrl->diagnosticsWarn(stat);
+      continue;
+    }
+    if (t.messages == 0)
+    {
+      stat.add(t.controller + " | " + t.topic, "not yet published");
+      stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Topics not yet published");
+    }
+    else if (t.timeout)
+    {
+      stat.add(t.controller + " | " + t.topic, "no message since " + std::to_string(t.silence) + "s (watchdog: "
+               + std::to_string(t.watchdog) + "s), timeouts: " + std::to_string(t.misses));
+      stat.mergeSummary(diagnostic_msgs::DiagnosticStatus::WARN, "Watchdog on the subscribed topics");
     }
   }
 }
@@ -347,31 +387,90 @@ void ControllerManagerInterface::diagnosticsWarn(diagnostic_updater::DiagnosticS
 void ControllerManagerInterface::diagnosticsError(diagnostic_updater::DiagnosticStatusWrapper &stat)
 {
   std::lock_guard<std::mutex> lock(mtx_);
-  for ( const auto & ctrl : controllers_)
+  for ( const auto & ctrl : diagnostics_)
   {
-    realtime_utilities::DiagnosticsInterface* cnr_ctrl =
-                                    dynamic_cast<realtime_utilities::DiagnosticsInterface*>(ctrl.second);
-    if( cnr_ctrl )
-    {
-      cnr_ctrl->diagnosticsError(stat);
-    }
+    ctrl.second->diagnosticsError(stat);
   }
 }
 
 void ControllerManagerInterface::diagnosticsPerformance(diagnostic_updater::DiagnosticStatusWrapper &stat)
 {
   std::lock_guard<std::mutex> lock(mtx_);
-  for ( const auto & ctrl : controllers_)
+  for ( const auto & ctrl : diagnostics_)
+  {
+    ctrl.second->diagnosticsPerformance(stat);
+  }
+
+  for ( const auto & t : cnr::control::topic_watchdogs(getHwName()))
+  {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2) << "period mean/jitter [ms] " << 1e3 * t.mean << " / " << 1e3 * t.jitter
+       << ", messages " << t.messages << ", timeouts " << t.misses;
+    stat.add(t.controller + " | " + t.topic, ss.str());
+  }
+}
+
+
+void ControllerManagerInterface::diagnosticsCost(diagnostic_updater::DiagnosticStatusWrapper &stat)
+{
+  const std::vector<cnr::control::ControllerCostSummary> costs = cnr::control::controller_costs(getHwName());
+  if (costs.empty())
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "No controller derived from cnr::control::Controller<T>");
+    return;
+  }
+
+  auto us = [](const double& ns)
+  {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << 1e-3 * ns;
+    return ss.str();
+  };
+  auto pct = [](const double& share)
   {
-    realtime_utilities::DiagnosticsInterface* cnr_ctrl =
-                                    dynamic_cast<realtime_utilities::DiagnosticsInterface*>(ctrl.second);
-    if( cnr_ctrl )
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << 1e2 * share;
+    return ss.str();
+  };
+  double   total_share = 0.0;
+  uint64_t misses      = 0;
+  const cnr::control::ControllerCostSummary* blamed = nullptr;
+  for (const auto& c : costs)
+  {
+    total_share += c.share();
+    misses      += c.deadline_misses;
+    if (c.deadline_misses > 0 && (!blamed || c.deadline_misses > blamed->deadline_misses))
     {
-      cnr_ctrl->diagnosticsPerformance(stat);
+      blamed = &c;
     }
   }
-}
 
+  stat.add("Update Budget [us]", us(costs.front().budget));
+  stat.add("Controllers", costs.size());
+  stat.add("Budget Used [%]", pct(total_share));
+  stat.add("Deadline Misses", misses);
+  for (size_t i = 0; i < std::min(cost_report_top_n_, costs.size()); i++)
+  {
+    const cnr::control::ControllerCostSummary& c = costs.at(i);
+    stat.add("#" + std::to_string(i + 1) + " " + c.name,
+             pct(c.share()) + "% of the budget, mean/p50/p99/max [us] " + us(c.mean) + " / " + us(c.p50)
+             + " / " + us(c.p99) + " / " + us(c.max) + ", deadline misses " + std::to_string(c.deadline_misses));
+  }
 
+  if (blamed)
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::WARN, std::to_string(misses) + " deadlines missed during the "
+                 "update of the controllers (most: '" + blamed->name + "', " + std::to_string(blamed->deadline_misses) + ")");
+  }
+  else if (total_share > 1.0)
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::WARN, "The controllers use more than the update budget");
+  }
+  else
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Most expensive: '" + costs.front().name + "' ("
+                 + pct(costs.front().share()) + "% of the budget)");
+  }
+}
 
 }  // namespace cnr_controller_manager_interface
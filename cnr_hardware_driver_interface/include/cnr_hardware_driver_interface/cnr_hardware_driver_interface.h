@@ -35,11 +35,14 @@
 #ifndef CNR_HARDWARE_NODELET_INTERFACE_CNR_ROBOT_HW_NODELET_H
 #define CNR_HARDWARE_NODELET_INTERFACE_CNR_ROBOT_HW_NODELET_H
 
+#include <array>
+#include <atomic>
 #include <thread>
 #include <memory>
 #include <map>
 #include <string>
 #include <mutex>
+#include <semaphore.h>
 
 
 #include <ros/ros.h>
@@ -52,6 +55,19 @@
 #include <cnr_controller_manager_interface/cnr_controller_manager_proxy.h>
 #include <cnr_hardware_interface/cnr_robot_hw_status.h>
 #include <cnr_hardware_interface/cnr_robot_hw.h>
+#include <cnr_hardware_driver_interface/cycle_clock.h>
+#include <cnr_hardware_driver_interface/latency_histogram.h>
+#include <cnr_hardware_driver_interface/state_channel.h>
+#include <cnr_hardware_driver_interface/flight_recorder.h>
+#include <cnr_hardware_driver_interface/rt_config.h>
+#include <cnr_hardware_driver_interface/overrun_policy.h>
+#include <cnr_hardware_driver_interface/loop_watchdog.h>
+#include <cnr_hardware_driver_interface/lockstep_clock.h>
+#include <cnr_controller_interface_params/allocation_sentinel.h>
+#include <cnr_controller_interface_params/pipelined_hw.h>
+#include <cnr_controller_interface_params/cycle_context.h>
+#include <cnr_controller_interface_params/loop_status.h>
+#include <cnr_controller_interface_params/fork_join_executor.h>
 
 namespace cnr_hardware_driver_interface
 {
@@ -106,20 +122,29 @@ public:
    * The state of the driver is the same state of the RobotHW if the 
    * loaded class is inherited from cnr_hardware_interface::RobotHW
    */
-  const cnr_hardware_interface::StatusHw& getState() const
+  cnr_hardware_interface::StatusHw getState() const
   {
-    return m_state;
+    return m_state_channel ? m_state_channel->get() : cnr_hardware_interface::UNLOADED;
   }
 
+  /** @brief Block until the state of the Driver is one of the 'targets'
+   *
+   * The call waits on the in-process state channel, it does not poll the param server.
+   * @param[in] watchdog non-positive means no timeout
+   * @param[out] reached the state that unblocked the call
+   */
+  bool waitForState(const std::vector<cnr_hardware_interface::StatusHw>& targets,
+                    const ros::Duration& watchdog,
+                    cnr_hardware_interface::StatusHw* reached = nullptr) const;
+
   /** @brief get the state of the the RobotHW
    * 
    * The state of the RobotHW is the state of the driver if the 
    * loaded class is inherited from cnr_hardware_interface::RobotHW
    */
-  const cnr_hardware_interface::StatusHw& retriveState()
+  cnr_hardware_interface::StatusHw retriveState() const
   {
-    m_state = m_cnr_hw ? m_cnr_hw->getState() : m_state; 
-    return m_state;
+    return m_cnr_hw ? m_cnr_hw->getState() : getState();
   }
   
   RobotHWConstPtr getRobotHw() const { return m_hw; }
@@ -134,6 +159,26 @@ public:
     return m_cmi;
   }
 
+  //! Consecutive cycles that overran the sampling period
+  uint32_t overrunStreak() const { return m_overrun.streak(); }
+  //! True if the loop is degraded (only the critical controllers are updated)
+  bool isDegraded() const { return m_overrun.degraded(); }
+  //! Latched when the overrun streak reaches '/<hw_name>/overrun/streak_limit', cleared by start()
+  bool overrunAlarm() const { return m_overrun.alarm(); }
+  void clearOverrunAlarm() { m_overrun.clearAlarm(); }
+  const OverrunPolicy& overrunPolicy() const { return m_overrun.policy(); }
+
+  //! True if the watchdog detected that the loop did not complete a cycle for '/<hw_name>/watchdog/missed_periods'
+  //! periods. The state of the driver is forced to ERROR, and the loop exits if it resumes
+  bool isStalled() const { return m_watchdog.stalled(); }
+
+  //! True if the loop is running with read()/write() overlapped to the update (param '/<hw_name>/pipeline')
+  bool isPipelined() const { return m_pipelined; }
+
+  //! True if the loop advances a simulated clock instead of waiting for the cycle clock
+  //! (param '/<hw_name>/lockstep/enabled', only for the RobotHWs implementing cnr::control::SimulatedHw)
+  bool isLockstep() const { return m_lockstep_config.enabled; }
+
   static std::string hw_last_status_param_name(const std::string& hw_name)
   {
     return "/" + hw_name + "/status/last_status";
@@ -149,8 +194,12 @@ public:
                                 const size_t& strictness, const ros::Duration& watchdog);
 protected:
 
+  //! RT-safe: the state is stored in the channel, the param server is updated by the channel thread
   bool dumpState(const cnr_hardware_interface::StatusHw& status);
-  bool fetchState(std::string& error);
+
+  //! RT-safe: store the cycle in the flight recorder (if enabled)
+  void recordCycle(CycleRecord& rec, const uint32_t& flags, const cnr_hardware_interface::StatusHw& state);
+  bool initFlightRecorder(std::string& error);
 
   cnr_logger::TraceLoggerPtr  m_logger;
   ros::CallbackQueue          m_callback_queue;
@@ -166,31 +215,111 @@ protected:
   cnr_controller_manager_interface::ControllerManagerInterfacePtr m_cmi;
   
   mutable std::mutex                m_mtx;
-  cnr_hardware_interface::StatusHw  m_state;
-  std::vector<std::string>          m_state_history;
+  HwStateChannelPtr                 m_state_channel;
+  FlightRecorderPtr                 m_flight_recorder;
+  uint32_t                          m_flight_recorder_dump_on = 0;  //!< bit mask of the states that trigger a dump
   bool                              m_stop_run;
   ros::Duration                     m_period;
   std::thread                       m_thread_run;
+  CycleClock::Ptr                   m_cycle_clock;
+  RtConfig                          m_rt_config;
+  OverrunMonitor                    m_overrun;
+
+  //! The context of the running cycle is stored in the loop status, where the controllers find it
+  cnr::control::HwLoopStatus*       m_loop_status = nullptr;
+  cnr::control::ClaimGroups*        m_claim_groups = nullptr;
+  cnr::control::CycleAwareHw*       m_cycle_hw = nullptr;
+  void hwRead(const cnr::control::CycleContext& ctx);
+  void hwWrite(const cnr::control::CycleContext& ctx);
+
+  //! Execution time of the phases of the loop. PHASE_CYCLE is from the start of read() to the end of write()
+  //! (pipelined: from the start of the I/O or of the update, whichever comes first, to the end of both)
+  enum LoopPhase { PHASE_READ = 0, PHASE_UPDATE, PHASE_WRITE, PHASE_CYCLE, N_PHASES };
+  std::array<LatencyHistogram, N_PHASES> m_histograms;
+
+  //! Heap allocations of the phases of the loop, counted only if the param 'allocation_sentinel' is true
+  bool                                                  m_alloc_sentinel = false;
+  std::array<cnr::control::AllocationCounter, N_PHASES> m_allocations;
+  std::array<uint64_t, N_PHASES>                        m_allocations_reported{};
 
   bool m_diagnostics_thread_running;
   bool m_stop_diagnostic_thread;
   std::thread m_diagnostics_thread;
   void diagnosticsThread();
+  void diagnosticsCycleClock(diagnostic_updater::DiagnosticStatusWrapper& stat);
+  void diagnosticsLoop(diagnostic_updater::DiagnosticStatusWrapper& stat);
+  void diagnosticsAllocations(diagnostic_updater::DiagnosticStatusWrapper& stat);
+
+  //! Pipelined mode: the I/O thread runs write(N) and read(N+1) while run() updates the controllers.
+  //! m_io_go and m_io_done hand the cycle over between the two threads, and order the accesses to m_io_cycle
+  struct IoCycle
+  {
+    int64_t  t_write = 0;
+    int64_t  t_read  = 0;
+    int64_t  t_end   = 0;
+    uint32_t error   = 0;   //!< CycleRecord::READ_ERROR or CycleRecord::WRITE_ERROR
+  };
+  cnr::control::PipelinedHw* m_pipelined_hw = nullptr;
+  std::atomic<bool> m_pipelined{false};
+  std::atomic<bool> m_stop_io_thread{false};
+  bool              m_io_skip_write = true;
+  IoCycle           m_io_cycle;
+  cnr::control::CycleContext m_io_context;  //!< the context of the cycle that triggered the I/O
+  sem_t             m_io_go;
+  sem_t             m_io_done;
+  std::thread       m_io_thread;
+  bool startIoThread(std::string& error);
+  void stopIoThread();
+  void ioThread();
+
+  //! Lockstep mode: no wait, one nominal period of simulated time per cycle
+  LockstepConfig m_lockstep_config;
+  LockstepClock  m_lockstep_clock;
+
+  //! Heartbeat supervisor of the loop (param '/<hw_name>/watchdog/missed_periods', 0 disables it)
+  LoopWatchdogConfig m_watchdog_config;
+  LoopWatchdog       m_watchdog;
+  void onLoopStall(const int64_t& silence);
+  void onLoopResume(const int64_t& silence);
+
+  //! Parallel update of the controllers with disjoint claimed resources (param '/<hw_name>/parallel_workers').
+  //! The controllers fork their update on m_executor, and the loop joins them before write()
+  int                            m_parallel_workers = 0;
+  cnr::control::ForkJoinExecutor m_executor;
+  bool startExecutor(std::string& error);
+  void stopExecutor();
+
+  //! The callbacks of m_hw_nh (services and subscribers of the RobotHW and of the ControllerManager)
+  //! are executed by this non-RT thread, and never by the run() loop
+  std::atomic<bool> m_stop_callback_thread{false};
+  std::thread       m_callback_thread;
+  void callbackThread();
 };
 
 typedef RobotHwDriverInterface::Ptr RobotHwDriverInterfacePtr;
 typedef RobotHwDriverInterface::ConstPtr RobotHwDriverInterfaceConstPtr;
 
+/** @brief Get the state of the RobotHW 'hw_name'
+ *
+ * If the driver lives in this process, the state is read from its state channel. Otherwise, the call waits
+ * for the channel to be registered, and it falls back on the param 'last_status' (checked every 10ms)
+ */
 inline
-bool hw_get_state(const std::string& hw_name, cnr_hardware_interface::StatusHw& status, 
+bool hw_get_state(const std::string& hw_name, cnr_hardware_interface::StatusHw& status,
                     const ros::Duration& watchdog, std::string& error)
 {
   std::string state;
   ros::Time st = ros::Time::now();
   error += " GET_STATE: param: " + RobotHwDriverInterface::hw_last_status_param_name(hw_name);
-  bool ok = false;
   do
   {
+    HwStateChannelPtr channel = HwStateChannel::waitChannel(hw_name, ros::WallDuration(0.01));
+    if (channel)
+    {
+      status = channel->get();
+      return true;
+    }
+
     if (ros::param::get(RobotHwDriverInterface::hw_last_status_param_name(hw_name), state))
     {
       for (const cnr_hardware_interface::StatusHw& it : cnr_hardware_interface::StatusHwIterator())
@@ -198,8 +327,7 @@ bool hw_get_state(const std::string& hw_name, cnr_hardware_interface::StatusHw&
         if (state == to_string(it))
         {
           status = it;
-          ok = true;
-          break;
+          return true;
         }
       }
     }
@@ -210,9 +338,9 @@ bool hw_get_state(const std::string& hw_name, cnr_hardware_interface::StatusHw&
       break;
     }
   }
-  while (ros::ok() && !ok);
+  while (ros::ok());
 
-  return ok;
+  return false;
 }
 
 inline
@@ -0,0 +1,198 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_HARDWARE_DRIVER_INTERFACE__CYCLE_CLOCK_H
+#define CNR_HARDWARE_DRIVER_INTERFACE__CYCLE_CLOCK_H
+
+#include <ctime>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+namespace cnr_hardware_driver_interface
+{
+
+/** @brief Statistics about the wake-ups of a CycleClock
+ *
+ * All the times are in nanoseconds. The latency is the delay between the
+ * nominal deadline and the instant the clock returned control to the loop;
+ * the drift is the distance between the last wake-up and 't0 + n * period',
+ * n being the number of executed cycles (it grows when cycles are lost).
+ */
+struct CycleClockStats
+{
+  uint64_t cycles         = 0;
+  uint64_t missed_wakeups = 0;
+  int64_t  last_latency   = 0;
+  int64_t  max_latency    = 0;
+  double   mean_latency   = 0.0;
+  double   stddev_latency = 0.0;
+  int64_t  drift          = 0;
+};
+
+/** @brief Source of the periodic wake-up of the RobotHwDriverInterface::run() loop
+ *
+ * The derived classes implement only the blocking wait; the base class keeps the
+ * absolute deadline on CLOCK_MONOTONIC and measures the jitter.
+ * The stats are written by the RT thread only, and read by the diagnostics thread
+ * through relaxed atomics (no locks in the loop).
+ */
+class CycleClock
+{
+public:
+  typedef std::unique_ptr<CycleClock> Ptr;
+
+  enum Type { CLOCK_NANOSLEEP, TIMERFD, HYBRID, WALLRATE };
+
+  explicit CycleClock(const int64_t& period_ns);
+  virtual ~CycleClock() = default;
+
+  /** @brief Arm the clock. The first deadline is one period after the call */
+  virtual bool start(std::string& error);
+
+  /** @brief Block until the next deadline and update the stats
+   * @return the deadlines missed since the previous wake-up (0 if the cycle is on time)
+   */
+  uint64_t wait();
+
+  /** @brief Late cycles executed back-to-back before skipping the older missed deadlines
+   *
+   * Negative (default): all the missed deadlines are executed (catch up); 0: they are all skipped,
+   * and the loop restarts at the next point of the grid. The sources that re-align the grid (WallRate)
+   * ignore it.
+   */
+  void setMaxBurst(const int64_t& max_burst) { m_max_burst = max_burst; }
+  const int64_t& maxBurst() const { return m_max_burst; }
+
+  virtual Type type() const = 0;
+  const int64_t& period() const { return m_period_ns; }
+
+  /** @brief Nominal deadline of the cycle that has just started */
+  const struct timespec& deadline() const { return m_deadline; }
+
+  CycleClockStats stats() const;
+  void resetStats();
+
+  static std::string to_string(const Type& type);
+  static bool from_string(const std::string& str, Type& type);
+
+  /** @brief Factory
+   * @param[in] spin_threshold_ns used only by the HYBRID clock
+   */
+  static Ptr create(const Type& type, const int64_t& period_ns, const int64_t& spin_threshold_ns = 0);
+
+protected:
+  /** @brief Block until the absolute deadline (CLOCK_MONOTONIC).
+   * @return the number of periods elapsed since the previous wake-up, as seen by
+   * the underlying source (1 if nothing has been lost, 0 if unknown)
+   */
+  virtual uint64_t doWait(const struct timespec& deadline) = 0;
+
+  /** @brief Some sources (WallRate) re-align the deadline on late cycles */
+  virtual bool realign() const { return false; }
+
+  /** @brief CLOCK_MONOTONIC [ns], the time base of the deadlines and of the stats (overridden by the tests) */
+  virtual int64_t now() const;
+
+  int64_t          m_period_ns;
+  int64_t          m_max_burst = -1;
+  struct timespec  m_t0;
+  struct timespec  m_deadline;
+
+private:
+  int64_t  m_accounted;
+  uint64_t m_cycles;
+  double   m_mean;
+  double   m_m2;
+
+  std::atomic<uint64_t> m_stat_cycles;
+  std::atomic<uint64_t> m_stat_missed;
+  std::atomic<int64_t>  m_stat_last;
+  std::atomic<int64_t>  m_stat_max;
+  std::atomic<double>   m_stat_mean;
+  std::atomic<double>   m_stat_var;
+  std::atomic<int64_t>  m_stat_drift;
+};
+
+//! clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME), no accumulation of errors
+class ClockNanosleepCycleClock : public CycleClock
+{
+public:
+  using CycleClock::CycleClock;
+  Type type() const override { return CLOCK_NANOSLEEP; }
+protected:
+  uint64_t doWait(const struct timespec& deadline) override;
+};
+
+//! timerfd armed with an absolute start time and a period, it reports the expirations
+class TimerFdCycleClock : public CycleClock
+{
+public:
+  using CycleClock::CycleClock;
+  ~TimerFdCycleClock() override;
+  bool start(std::string& error) override;
+  Type type() const override { return TIMERFD; }
+protected:
+  uint64_t doWait(const struct timespec& deadline) override;
+private:
+  int m_fd = -1;
+};
+
+//! clock_nanosleep up to 'deadline - spin_threshold', then busy-wait on the deadline
+class HybridCycleClock : public CycleClock
+{
+public:
+  HybridCycleClock(const int64_t& period_ns, const int64_t& spin_threshold_ns);
+  Type type() const override { return HYBRID; }
+protected:
+  uint64_t doWait(const struct timespec& deadline) override;
+private:
+  int64_t m_spin_threshold_ns;
+};
+
+//! ros::WallRate-like behaviour: relative sleep, the grid is reset when a cycle is lost
+class WallRateCycleClock : public CycleClock
+{
+public:
+  using CycleClock::CycleClock;
+  Type type() const override { return WALLRATE; }
+protected:
+  uint64_t doWait(const struct timespec& deadline) override;
+  bool realign() const override { return true; }
+};
+
+}  // namespace cnr_hardware_driver_interface
+
+#endif  // CNR_HARDWARE_DRIVER_INTERFACE__CYCLE_CLOCK_H
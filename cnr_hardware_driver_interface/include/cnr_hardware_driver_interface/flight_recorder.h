@@ -0,0 +1,197 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_HARDWARE_DRIVER_INTERFACE__FLIGHT_RECORDER_H
+#define CNR_HARDWARE_DRIVER_INTERFACE__FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include <semaphore.h>
+
+#include <cnr_logger/cnr_logger.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+/** @brief One cycle of the loop read() -> update() -> write()
+ *
+ * The times are CLOCK_MONOTONIC [ns]. A phase that has not been executed (e.g., write() after an
+ * exception in update()) has time 0.
+ */
+struct CycleRecord
+{
+  enum Flags : uint32_t
+  {
+    OVERRUN      = 0x1,  //!< t_end - t_read longer than the sampling period
+    READ_ERROR   = 0x2,
+    UPDATE_ERROR = 0x4,
+    WRITE_ERROR  = 0x8,
+    HW_ERROR     = 0x10, //!< the RobotHW went in ERROR at the end of the cycle
+    MISSED       = 0x20, //!< the cycle clock missed some deadlines before this cycle
+    DEGRADED     = 0x40, //!< the loop is degraded (overrun policy 'degrade')
+    STALLED      = 0x80  //!< the watchdog detected the stall of this cycle
+  };
+
+  uint64_t cycle;       //!< cycles since the start of run()
+  int64_t  t_deadline;  //!< nominal wake-up time given by the cycle clock
+  int64_t  t_read;      //!< start of read()
+  int64_t  t_update;    //!< start of update()
+  int64_t  t_write;     //!< start of write()
+  int64_t  t_end;       //!< end of write()
+  uint32_t flags;
+  int32_t  state;       //!< cnr_hardware_interface::StatusHw at the end of the cycle
+};
+static_assert(std::is_trivially_copyable<CycleRecord>::value && sizeof(CycleRecord) == 56,
+              "The CycleRecord is dumped as it is, do not change its layout without changing the file version");
+
+/** @brief Header of the binary file written by the FlightRecorder (little endian, as in memory)
+ *
+ * The layout of the file is:
+ * - FlightRecorderHeader
+ * - the name of the hw (hw_name_size chars)
+ * - the names of the joints (for each joint: uint32_t size, then the chars)
+ * - n_records times: CycleRecord, then n_joints positions, n_joints velocities and n_joints efforts (double)
+ * The records are sorted from the oldest to the newest.
+ */
+struct FlightRecorderHeader
+{
+  char     magic[8];      //!< "CNRFLREC"
+  uint32_t version;
+  uint32_t record_size;   //!< sizeof(CycleRecord)
+  uint32_t n_joints;
+  uint32_t n_records;
+  int64_t  period;        //!< sampling period [ns]
+  int32_t  trigger_state; //!< the state that triggered the dump
+  uint32_t hw_name_size;
+};
+
+/** @brief Preallocated ring of the last cycles of the driver, dumped on file by a background thread
+ *
+ * push() and trigger() are called by the RT loop: they do not lock, do not allocate and do not
+ * perform I/O. The optional joint snapshot is read from the pointers given to init() (e.g., the
+ * ones of the JointStateHandles of the RobotHW).
+ */
+class FlightRecorder
+{
+public:
+  typedef std::shared_ptr<FlightRecorder> Ptr;
+
+  static constexpr uint32_t VERSION = 1;
+
+  FlightRecorder();
+  ~FlightRecorder();
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  /** @brief Allocate the ring and start the dump thread
+   *
+   * @param[in] capacity number of cycles stored, 0 disables the recorder
+   * @param[in] directory where the files '<hw_name>_<YYYYmmdd_HHMMSS>.flight' are written
+   * @param[in] joint_names, position, velocity, effort joint snapshot (empty vectors: no snapshot)
+   */
+  bool init(const std::string& hw_name,
+            const cnr_logger::TraceLoggerPtr& logger,
+            const size_t& capacity,
+            const int64_t& period_ns,
+            const std::string& directory,
+            const std::vector<std::string>& joint_names,
+            const std::vector<const double*>& position,
+            const std::vector<const double*>& velocity,
+            const std::vector<const double*>& effort,
+            std::string& error);
+  void shutdown();
+
+  bool enabled() const { return m_capacity > 0; }
+
+  //! RT-safe: store the record and the joint snapshot, overwriting the oldest cycle
+  void push(const CycleRecord& record);
+
+  //! RT-safe: ask the background thread to dump the ring
+  void trigger(const int32_t& state);
+
+  /** @brief Write the last cycles on 'path'. Non-RT, it can run while push() is called */
+  bool dump(const std::string& path, const int32_t& trigger_state, std::string& error) const;
+
+  //! Path of the last file written by the background thread (empty if none)
+  std::string lastDump() const;
+
+  uint64_t recorded() const { return m_head.load(std::memory_order_relaxed); }
+  size_t capacity() const { return m_capacity; }
+
+  /** @brief Read a file written by dump(). The joint values are stored as in the file (pos, vel, eff per record) */
+  static bool load(const std::string& path,
+                   FlightRecorderHeader& header,
+                   std::string& hw_name,
+                   std::vector<std::string>& joint_names,
+                   std::vector<CycleRecord>& records,
+                   std::vector<double>& joints,
+                   std::string& error);
+
+private:
+  void dumpThread();
+
+  std::string                 m_hw_name;
+  cnr_logger::TraceLoggerPtr  m_logger;
+  size_t                      m_capacity;
+  size_t                      m_slots;
+  int64_t                     m_period_ns;
+  std::string                 m_directory;
+
+  std::vector<std::string>    m_joint_names;
+  std::vector<const double*>  m_sources;   //!< positions, then velocities, then efforts
+  std::vector<CycleRecord>    m_records;
+  std::vector<double>         m_joints;    //!< m_capacity * m_sources.size()
+
+  std::atomic<uint64_t>       m_head;
+  std::atomic<bool>           m_pending;
+  std::atomic<int32_t>        m_trigger_state;
+  sem_t                       m_sem;
+
+  mutable std::mutex          m_mtx;
+  std::string                 m_last_dump;
+  std::atomic<bool>           m_stop_dump;
+  std::thread                 m_dump_thread;
+};
+
+typedef FlightRecorder::Ptr FlightRecorderPtr;
+
+}  // namespace cnr_hardware_driver_interface
+
+#endif  // CNR_HARDWARE_DRIVER_INTERFACE__FLIGHT_RECORDER_H
@@ -0,0 +1,69 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_HARDWARE_DRIVER_INTERFACE__INTERNAL__TIME_UTILS_H
+#define CNR_HARDWARE_DRIVER_INTERFACE__INTERNAL__TIME_UTILS_H
+
+#include <ctime>
+#include <cstdint>
+
+namespace cnr_hardware_driver_interface
+{
+
+constexpr int64_t NSEC_PER_SEC = 1000000000LL;
+
+inline int64_t to_nsec(const struct timespec& ts)
+{
+  return static_cast<int64_t>(ts.tv_sec) * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+inline struct timespec from_nsec(const int64_t& ns)
+{
+  struct timespec ts;
+  ts.tv_sec  = ns / NSEC_PER_SEC;
+  ts.tv_nsec = ns % NSEC_PER_SEC;
+  return ts;
+}
+
+//! CLOCK_MONOTONIC in ns (vDSO, no syscall): it is the time base of all the measures of the RT loop
+inline int64_t now_nsec()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return to_nsec(ts);
+}
+
+}  // namespace cnr_hardware_driver_interface
+
+#endif  // CNR_HARDWARE_DRIVER_INTERFACE__INTERNAL__TIME_UTILS_H
@@ -0,0 +1,139 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_HARDWARE_DRIVER_INTERFACE__LATENCY_HISTOGRAM_H
+#define CNR_HARDWARE_DRIVER_INTERFACE__LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+namespace cnr_hardware_driver_interface
+{
+
+/** @brief Summary of a LatencyHistogram. All the values are in ns */
+struct LatencySummary
+{
+  uint64_t count    = 0;
+  uint64_t overruns = 0;
+  double   mean     = 0.0;
+  int64_t  p50      = 0;
+  int64_t  p99      = 0;
+  int64_t  p999     = 0;
+  int64_t  max      = 0;
+};
+
+/** @brief Fixed-memory histogram with log-linear buckets (HDR-like)
+ *
+ * The values below 2^SUB_BITS ns have a bucket each, then every power of two is split
+ * in 2^SUB_BITS linear buckets: the relative error is below 1/2^SUB_BITS (~3%) from 1us to ~68s.
+ *
+ * There must be a single writer (the RT thread): record() is wait-free, it does not allocate
+ * and it does not use read-modify-write instructions. Any other thread can call summary()
+ * at any time; the result is consistent up to the samples recorded during the read.
+ */
+class LatencyHistogram
+{
+public:
+  static constexpr unsigned SUB_BITS    = 5;
+  static constexpr unsigned MAX_BITS    = 36;
+  static constexpr size_t   SUB_BUCKETS = size_t(1) << SUB_BITS;
+  static constexpr size_t   BUCKETS     = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+  explicit LatencyHistogram(const int64_t& overrun_threshold_ns = 0);
+
+  void setOverrunThreshold(const int64_t& overrun_threshold_ns) { m_overrun_threshold = overrun_threshold_ns; }
+  const int64_t& overrunThreshold() const { return m_overrun_threshold; }
+
+  /** @brief Record a value [ns]. RT-safe, single writer only */
+  void record(int64_t value)
+  {
+    if (value < 0)
+    {
+      value = 0;
+    }
+    increment(m_counts[index(static_cast<uint64_t>(value))]);
+    increment(m_count);
+    m_sum.store(m_sum.load(std::memory_order_relaxed) + static_cast<uint64_t>(value), std::memory_order_relaxed);
+    if (value > m_max.load(std::memory_order_relaxed))
+    {
+      m_max.store(value, std::memory_order_relaxed);
+    }
+    if (m_overrun_threshold > 0 && value > m_overrun_threshold)
+    {
+      increment(m_overruns);
+    }
+  }
+
+  /** @brief Percentiles, mean, max and overruns. Non RT-safe (it scans all the buckets) */
+  LatencySummary summary() const;
+
+  /** @brief The value in ns reported for the percentiles falling into the bucket (upper bound) */
+  static int64_t bucketUpperBound(const size_t& idx);
+
+  static size_t index(const uint64_t& value)
+  {
+    if (value < SUB_BUCKETS)
+    {
+      return static_cast<size_t>(value);
+    }
+    const unsigned msb   = 63u - static_cast<unsigned>(__builtin_clzll(value));
+    if (msb >= MAX_BITS)
+    {
+      return BUCKETS - 1;
+    }
+    const unsigned shift = msb - SUB_BITS;
+    return static_cast<size_t>(shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+  }
+
+private:
+  static void increment(std::atomic<uint64_t>& v)
+  {
+    v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  int64_t                                    m_overrun_threshold;
+  std::array<std::atomic<uint64_t>, BUCKETS> m_counts;
+  std::atomic<uint64_t>                      m_count;
+  std::atomic<uint64_t>                      m_sum;
+  std::atomic<uint64_t>                      m_overruns;
+  std::atomic<int64_t>                       m_max;
+};
+
+std::string to_string(const LatencySummary& summary);
+
+}  // namespace cnr_hardware_driver_interface
+
+#endif  // CNR_HARDWARE_DRIVER_INTERFACE__LATENCY_HISTOGRAM_H
@@ -0,0 +1,109 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_HARDWARE_DRIVER_INTERFACE__LOCKSTEP_CLOCK_H
+#define CNR_HARDWARE_DRIVER_INTERFACE__LOCKSTEP_CLOCK_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+#include <ros/ros.h>
+#include <rosgraph_msgs/Clock.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+/** @brief Setup of the lockstep mode, read from '/<hw_name>/lockstep/'
+ *
+ * In the lockstep mode the loop does not wait for the cycle clock: each cycle advances a simulated clock of one
+ * nominal period. 'real_time_factor' caps the speed (simulated seconds per wall second, 0: as fast as possible).
+ */
+struct LockstepConfig
+{
+  bool   enabled          = false;
+  double real_time_factor = 0.0;
+  bool   publish_clock    = true;   //!< publish the simulated time on '/clock'
+};
+
+bool load_lockstep_config(const std::string& hw_namespace, LockstepConfig& config, std::string& error);
+
+/** @brief Simulated clock of the lockstep mode
+ *
+ * tick() is called once per cycle by the loop: it computes the time of the cycle, that the driver passes
+ * explicitly to read(), update() and write() (CycleContext::time), and publishes it on '/clock'.
+ * The time of the process is never set: if the process follows '/clock' ('/use_sim_time' true at startup),
+ * tick() waits for roscpp to deliver the published time, so that ros::Time::now() matches the time of the cycle;
+ * otherwise, ros::Time::now() stays the wall time, and the controllers must use the time passed to update().
+ *
+ * '/clock' is process-wide: a single driver per process can publish it.
+ */
+class LockstepClock
+{
+public:
+  LockstepClock() = default;
+  LockstepClock(const LockstepClock&) = delete;
+  LockstepClock& operator=(const LockstepClock&) = delete;
+
+  /** @brief Non-RT. The simulated time starts from ros::Time::now() (from the wall time if it is zero) */
+  bool start(const int64_t& period, const LockstepConfig& config, std::string& error);
+
+  /** @brief Advance of one period.
+   * @return false if the published time did not reach the process within 1s of wall time
+   */
+  bool tick(ros::Time& time);
+
+  const int64_t& period() const { return m_period; }
+  uint64_t ticks() const { return m_ticks.load(std::memory_order_relaxed); }
+
+  //! Simulated seconds per wall second since start()
+  double realTimeFactor() const;
+
+private:
+  int64_t               m_period = 0;
+  LockstepConfig        m_config;
+  bool                  m_follow_clock_topic = false;
+  int64_t               m_t0_sim  = 0;
+  int64_t               m_t0_wall = 0;
+
+  std::atomic<uint64_t> m_ticks{0};
+  std::atomic<int64_t>  m_wall_elapsed{0};
+
+  ros::Publisher        m_clock_pub;
+  rosgraph_msgs::Clock  m_clock_msg;
+};
+
+}  // namespace cnr_hardware_driver_interface
+
+#endif  // CNR_HARDWARE_DRIVER_INTERFACE__LOCKSTEP_CLOCK_H
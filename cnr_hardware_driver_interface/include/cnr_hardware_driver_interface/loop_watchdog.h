@@ -0,0 +1,109 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_HARDWARE_DRIVER_INTERFACE__LOOP_WATCHDOG_H
+#define CNR_HARDWARE_DRIVER_INTERFACE__LOOP_WATCHDOG_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include <functional>
+
+#include <cnr_hardware_driver_interface/rt_config.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+/** @brief Setup of the watchdog of the loop, read from '/<hw_name>/watchdog/'
+ *
+ * The loop is stalled if it does not complete a cycle for 'missed_periods' sampling periods (0: no watchdog).
+ * When the stall is detected, the std_srvs/Trigger service 'safe_action_service' is called (if not empty).
+ */
+struct LoopWatchdogConfig
+{
+  uint32_t    missed_periods = 0;
+  std::string safe_action_service;
+};
+
+bool load_loop_watchdog_config(const std::string& hw_namespace, LoopWatchdogConfig& config, std::string& error);
+
+/** @brief Supervisor of the RT loop, running in its own thread
+ *
+ * The loop calls beat() at the end of each cycle (RT-safe: one atomic increment). The watchdog thread
+ * checks the heartbeat every max(1, missed_periods / 4) periods, so that a stall is detected within
+ * 1.25 * missed_periods periods, and it calls 'on_stall' once per stall, and 'on_resume' if the loop
+ * beats again. The handlers run in the watchdog thread.
+ */
+class LoopWatchdog
+{
+public:
+  typedef std::function<void(const int64_t& silence)> Handler;  //!< time since the last beat [ns]
+
+  LoopWatchdog() = default;
+  ~LoopWatchdog();
+  LoopWatchdog(const LoopWatchdog&) = delete;
+  LoopWatchdog& operator=(const LoopWatchdog&) = delete;
+
+  bool start(const int64_t& period, const uint32_t& missed_periods, const ThreadRtConfig& rt_config,
+             const Handler& on_stall, const Handler& on_resume, std::string& error);
+  void stop();
+  bool running() const { return m_thread.joinable(); }
+
+  //! RT-safe
+  void beat() { m_heartbeat.fetch_add(1, std::memory_order_release); }
+
+  bool     stalled() const     { return m_stalled.load(std::memory_order_acquire); }
+  uint64_t stalls() const      { return m_stalls.load(std::memory_order_relaxed); }
+  int64_t  maxSilence() const  { return m_max_silence.load(std::memory_order_relaxed); }
+
+private:
+  void watchdogThread(const ThreadRtConfig& rt_config);
+
+  int64_t               m_period = 0;
+  uint32_t              m_missed_periods = 0;
+  Handler               m_on_stall;
+  Handler               m_on_resume;
+
+  std::atomic<uint64_t> m_heartbeat{0};
+  std::atomic<bool>     m_stalled{false};
+  std::atomic<uint64_t> m_stalls{0};
+  std::atomic<int64_t>  m_max_silence{0};
+  std::atomic<bool>     m_stop{true};
+  std::thread           m_thread;
+};
+
+}  // namespace cnr_hardware_driver_interface
+
+#endif  // CNR_HARDWARE_DRIVER_INTERFACE__LOOP_WATCHDOG_H
@@ -0,0 +1,124 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_HARDWARE_DRIVER_INTERFACE__OVERRUN_POLICY_H
+#define CNR_HARDWARE_DRIVER_INTERFACE__OVERRUN_POLICY_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+#include <cnr_controller_interface_params/loop_status.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+/** @brief What the run() loop does when a cycle overruns, read from '/<hw_name>/overrun/'
+ *
+ * - CATCH_UP: the missed periods are executed back-to-back, at most 'max_burst' of them (negative: all),
+ *   the older ones are skipped. The loop stays on the grid 't0 + n * period'.
+ * - SKIP: the missed periods are skipped, the loop restarts at the next point of the grid.
+ * - DEGRADE: as SKIP, and after 'degrade_after' consecutive overruns the loop is marked as degraded
+ *   (the controllers that are not critical are not updated) until 'recover_after' consecutive cycles
+ *   are within the period.
+ */
+struct OverrunPolicy
+{
+  enum Type { CATCH_UP, SKIP, DEGRADE };
+
+  Type     type          = CATCH_UP;
+  int64_t  max_burst     = -1;
+  uint32_t degrade_after = 3;
+  uint32_t recover_after = 100;
+  uint32_t streak_limit  = 0;   //!< streak that raises the alarm for the ConfigurationManager, 0: never
+
+  //! The burst given to the CycleClock
+  int64_t clockMaxBurst() const { return type == CATCH_UP ? max_burst : 0; }
+};
+
+std::string to_string(const OverrunPolicy::Type& type);
+bool from_string(const std::string& str, OverrunPolicy::Type& type);
+std::string to_string(const OverrunPolicy& policy);
+
+//! Read the policy from the param server, and check it
+bool load_overrun_policy(const std::string& hw_namespace, OverrunPolicy& policy, std::string& error);
+
+/** @brief Track the streaks of overruns of the loop, and apply the degrade policy
+ *
+ * update() is called by the RT thread once per cycle (no locks, no allocations), the getters
+ * can be called by any thread.
+ */
+class OverrunMonitor
+{
+public:
+  //! 'status' may be null, otherwise its 'degraded' and 'overrun_streak' are kept updated
+  void init(const OverrunPolicy& policy, cnr::control::HwLoopStatus* status);
+
+  //! Clear the counters and leave the degraded mode (call it before the loop starts)
+  void reset();
+
+  /** @brief Account one cycle
+   * @return true if the degraded mode has been entered or left, or the alarm has been raised,
+   * i.e., when the change is worth a notification
+   */
+  bool update(const bool& overrun);
+
+  uint32_t streak() const       { return m_streak.load(std::memory_order_relaxed); }
+  uint32_t maxStreak() const    { return m_max_streak.load(std::memory_order_relaxed); }
+  uint64_t overruns() const     { return m_overruns.load(std::memory_order_relaxed); }
+  uint64_t degradations() const { return m_degradations.load(std::memory_order_relaxed); }
+  bool     degraded() const     { return m_degraded.load(std::memory_order_relaxed); }
+
+  //! Latched when the streak reaches 'streak_limit', cleared by reset() and clearAlarm()
+  bool     alarm() const        { return m_alarm.load(std::memory_order_relaxed); }
+  void     clearAlarm()         { m_alarm.store(false, std::memory_order_relaxed); }
+
+  const OverrunPolicy& policy() const { return m_policy; }
+
+private:
+  OverrunPolicy                m_policy;
+  cnr::control::HwLoopStatus*  m_status = nullptr;
+  uint32_t                     m_on_time = 0;
+
+  std::atomic<uint32_t> m_streak{0};
+  std::atomic<uint32_t> m_max_streak{0};
+  std::atomic<uint64_t> m_overruns{0};
+  std::atomic<uint64_t> m_degradations{0};
+  std::atomic<bool>     m_degraded{false};
+  std::atomic<bool>     m_alarm{false};
+};
+
+}  // namespace cnr_hardware_driver_interface
+
+#endif  // CNR_HARDWARE_DRIVER_INTERFACE__OVERRUN_POLICY_H
@@ -0,0 +1,101 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_HARDWARE_DRIVER_INTERFACE__RT_CONFIG_H
+#define CNR_HARDWARE_DRIVER_INTERFACE__RT_CONFIG_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace cnr_hardware_driver_interface
+{
+
+/** @brief Scheduling of one thread of the driver */
+struct ThreadRtConfig
+{
+  enum Policy { OTHER, FIFO, RR, DEADLINE };
+
+  std::vector<int> cpus;              //!< CPU affinity, empty: no constraint
+  Policy           policy   = OTHER;
+  int              priority = 0;      //!< FIFO and RR only
+  int64_t          runtime  = 0;      //!< DEADLINE only [ns]
+  int64_t          period   = 0;      //!< DEADLINE only [ns], it is the sampling period
+};
+
+/** @brief Real-time setup of a RobotHwDriverInterface, read from '/<hw_name>/realtime/'
+ *
+ * 'loop' is applied to the run() thread, 'io' to the I/O thread of the pipelined mode and 'worker' to the
+ * parallel workers of the controllers (same scheduling of the loop, their own CPU affinity; each worker is
+ * pinned on one of the 'worker' cores), 'non_rt' to the diagnostics and the callback threads.
+ * The memory settings are process-wide: mlockall() and the heap prefaulting are shared by all the
+ * drivers loaded in the same process, and they are idempotent.
+ */
+struct RtConfig
+{
+  ThreadRtConfig loop;
+  ThreadRtConfig io;
+  ThreadRtConfig worker;
+  ThreadRtConfig non_rt;
+  bool           lock_memory   = false;
+  size_t         prefault_heap  = 0;  //!< [bytes], touched and kept in the malloc arena
+  size_t         prefault_stack = 0;  //!< [bytes], touched by the run() thread before the loop
+};
+
+std::string to_string(const ThreadRtConfig::Policy& policy);
+bool from_string(const std::string& str, ThreadRtConfig::Policy& policy);
+std::string to_string(const ThreadRtConfig& config);
+
+/** @brief Read the config from the param server, and check it
+ *
+ * The defaults reproduce the behaviour of the PREEMPTIVE_RT build (RR at max-2, memory locked,
+ * 1MB of stack prefaulted) or of a standard build (nothing is changed).
+ * If the loop has a CPU affinity and 'non_rt_cpu_affinity' is not given, the non-RT threads are
+ * confined on the other CPUs of the affinity set of the process.
+ */
+bool load_rt_config(const std::string& hw_namespace, const int64_t& period_ns, RtConfig& config, std::string& error);
+
+//! Apply the affinity and the scheduling to the calling thread
+bool apply_to_this_thread(const ThreadRtConfig& config, std::string& error);
+
+//! mlockall() and heap prefaulting, call it from a non-RT context
+bool prepare_memory(const RtConfig& config, std::string& error);
+
+//! Touch 'size' bytes of the stack of the calling thread
+void prefault_stack(const size_t& size);
+
+}  // namespace cnr_hardware_driver_interface
+
+#endif  // CNR_HARDWARE_DRIVER_INTERFACE__RT_CONFIG_H
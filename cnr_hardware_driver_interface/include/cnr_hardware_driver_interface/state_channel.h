@@ -0,0 +1,165 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CNR_HARDWARE_DRIVER_INTERFACE__STATE_CHANNEL_H
+#define CNR_HARDWARE_DRIVER_INTERFACE__STATE_CHANNEL_H
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
+#include <condition_variable>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include <ros/ros.h>
+#include <cnr_logger/cnr_logger.h>
+#include <cnr_hardware_interface/cnr_robot_hw_status.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+struct HwStateTransition
+{
+  cnr_hardware_interface::StatusHw from;
+  cnr_hardware_interface::StatusHw to;
+  int64_t                          stamp;  //!< CLOCK_MONOTONIC [ns]
+};
+
+/** @brief In-process publication of the state of a RobotHwDriverInterface
+ *
+ * The state is an atomic, and each transition is pushed in a bounded ring. The producers (the thread that owns
+ * the driver lifecycle, and the watchdog that forces the ERROR on a stall) serialize on a priority-inheritance
+ * mutex held for the push only; set() does not allocate and does not talk to the ROS master, so it can be
+ * called from the RT loop.
+ *
+ * A background thread drains the ring, mirrors the state on the param server
+ * ('/<hw>/status/last_status' and the bounded history '/<hw>/status/status') and on the latched
+ * topic '/<hw>/status/state', and wakes up the threads blocked in waitFor().
+ *
+ * The channels are registered by name, so that hw_get_state() and the ConfigurationManager can
+ * wait on the state of a driver living in the same process without polling the param server.
+ */
+class HwStateChannel : public std::enable_shared_from_this<HwStateChannel>
+{
+public:
+  typedef std::shared_ptr<HwStateChannel> Ptr;
+
+  static constexpr size_t CAPACITY = 64;   //!< transitions not yet mirrored, power of two
+  static constexpr size_t HISTORY  = 32;   //!< transitions stored in '/<hw>/status/status'
+
+  HwStateChannel();
+  ~HwStateChannel();
+  HwStateChannel(const HwStateChannel&) = delete;
+  HwStateChannel& operator=(const HwStateChannel&) = delete;
+
+  /** @brief Register the channel as 'hw_name' and start the mirror thread */
+  bool init(const std::string& hw_name, const cnr_logger::TraceLoggerPtr& logger, std::string& error);
+  void shutdown();
+
+  cnr_hardware_interface::StatusHw get() const
+  {
+    return static_cast<cnr_hardware_interface::StatusHw>(m_state.load(std::memory_order_acquire));
+  }
+
+  /** @brief RT-safe and thread-safe. It stores a transition only if the state actually changes */
+  void set(const cnr_hardware_interface::StatusHw& status);
+
+  /** @brief RT-safe. Wake up the waiters (e.g., the ConfigurationManager) without a transition,
+   * when something else about the driver changed (e.g., the overrun streak)
+   */
+  void notify();
+
+  /** @brief Block until the state is one of the targets. A non-positive watchdog means no timeout
+   * @param[out] reached the state that unblocked the call (if not null)
+   */
+  bool waitFor(const std::vector<cnr_hardware_interface::StatusHw>& targets,
+               const ros::Duration& watchdog,
+               cnr_hardware_interface::StatusHw* reached = nullptr) const;
+
+  /** @brief Block until the state is different from 'status' */
+  bool waitForNot(const cnr_hardware_interface::StatusHw& status, const ros::Duration& watchdog) const;
+
+  uint64_t transitions() const { return m_head.load(std::memory_order_relaxed); }
+  uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+  static std::string state_topic_name(const std::string& hw_name)
+  {
+    return "/" + hw_name + "/status/state";
+  }
+
+  /** @brief The channel registered as 'hw_name' in this process, nullptr if none */
+  static Ptr find(const std::string& hw_name);
+
+  /** @brief Process-wide counter of the mirrored transitions (of all the channels) */
+  static uint64_t epoch();
+
+  /** @brief Block until epoch() differs from 'last_epoch' or the timeout expires; it updates 'last_epoch' */
+  static bool waitEpoch(uint64_t& last_epoch, const ros::WallDuration& timeout);
+
+  /** @brief Block until a channel is registered as 'hw_name' or the timeout expires */
+  static Ptr waitChannel(const std::string& hw_name, const ros::WallDuration& timeout);
+
+private:
+  template<class Predicate>
+  bool waitUntil(Predicate pred, const ros::Duration& watchdog) const;
+  void mirrorThread();
+
+  std::string                   m_hw_name;
+  cnr_logger::TraceLoggerPtr    m_logger;
+
+  std::atomic<int>              m_state;
+  pthread_mutex_t               m_producer_mtx;  //!< serializes the transitions and the pushes in the ring
+  std::array<HwStateTransition, CAPACITY> m_ring;
+  std::atomic<uint64_t>         m_head;
+  std::atomic<uint64_t>         m_tail;
+  std::atomic<uint64_t>         m_dropped;
+  sem_t                         m_sem;
+
+  mutable std::mutex              m_mtx;
+  mutable std::condition_variable m_cv;
+  std::deque<std::string>       m_history;
+  std::atomic<bool>             m_stop_mirror;
+  std::thread                   m_mirror_thread;
+};
+
+typedef HwStateChannel::Ptr HwStateChannelPtr;
+
+}  // namespace cnr_hardware_driver_interface
+
+#endif  // CNR_HARDWARE_DRIVER_INTERFACE__STATE_CHANNEL_H
@@ -33,21 +33,13 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 
-#if PREEMPTIVE_RT == 1
-  #include <cinttypes>
-  #include <csignal>
-  #define USE_TIMER_REALTIME_UTILS  1
-  #define PRE_ALLOCATION_SIZE       1024*1024*1024
-  #define RT_STACK_SIZE             1024*1024
-#else
-  //#define USE_TIMERFD
-  #define USE_WALLRATE
-#endif
-
+#include <cerrno>
 #include <cstring>
 #include <sstream>
+#include <algorithm>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include <ros/file_log.h>
 #include <pluginlib/class_list_macros.h>
 #include <diagnostic_msgs/DiagnosticArray.h>
 
@@ -55,62 +47,12 @@
 #include <rosparam_utilities/rosparam_utilities.h>
 #include <cnr_controller_interface_params/cnr_controller_interface_params.h>
 #include <cnr_hardware_interface/cnr_robot_hw.h>
+#include <hardware_interface/joint_state_interface.h>
 #include <configuration_msgs/SendMessage.h>
+#include <std_srvs/Trigger.h>
 
 #include <cnr_hardware_driver_interface/cnr_hardware_driver_interface.h>
-
-#if defined(USE_TIMERFD)
-
-#include <sys/time.h>
-#include <sys/timerfd.h>
-
-struct periodic_info {
-  int timer_fd;
-  unsigned long long wakeups_missed;
-};
-
-static int make_periodic(unsigned int period, struct periodic_info *info)
-{
-  int ret;
-  unsigned int ns;
-  unsigned int sec;
-  int fd;
-  struct itimerspec itval;
-
-  /* Create the timer */
-  fd = timerfd_create(CLOCK_MONOTONIC, 0);
-  info->wakeups_missed = 0;
-  info->timer_fd = fd;
-  if (fd == -1)
-    return fd;
-
-  /* Make the timer periodic */
-  sec = period / 1000000;
-  ns = (period - (sec * 1000000)) * 1000;
-  itval.it_interval.tv_sec = sec;
-  itval.it_interval.tv_nsec = ns;
-  itval.it_value.tv_sec = sec;
-  itval.it_value.tv_nsec = ns;
-  ret = timerfd_settime(fd, 0, &itval, NULL);
-  return ret;
-}
-
-static void wait_period(struct periodic_info *info)
-{
-  unsigned long long missed;
-  int ret;
-
-  /* Wait for the next timer event. If we have missed any the
-     number is written to "missed" */
-  ret = read(info->timer_fd, &missed, sizeof(missed));
-  if (ret == -1) {
-    perror("read timer");
-    return;
-  }
-
-  info->wakeups_missed += missed;
-}
-#endif
+#include <cnr_hardware_driver_interface/internal/time_utils.h>
 
 namespace cnr_hardware_driver_interface
 {
@@ -176,13 +118,29 @@ RobotHwDriverInterface::~RobotHwDriverInterface()
     {
       CNR_FATAL(m_logger, "Error in stopping the control loop!!!");
     }
-    
-    // m_callback_queue.disable();
-    // m_hw_nh.shutdown();
+
+    CNR_WARN(m_logger, "Join the callback thread");
+    m_stop_callback_thread = true;
+    if (m_callback_thread.joinable())
+    {
+      m_callback_thread.join();
+    }
+    if (m_flight_recorder)
+    {
+      m_flight_recorder->shutdown();
+    }
+    if (m_alloc_sentinel)
+    {
+      cnr::control::allocation_sentinel::disable();
+    }
     m_cmi.reset();
     m_cm.reset();
     m_hw.reset();
     m_cnr_hw = nullptr;
+    if (m_state_channel)
+    {
+      m_state_channel->shutdown();
+    }
   }
   catch (std::exception& e)
   {
@@ -214,8 +172,15 @@ bool RobotHwDriverInterface::init(const std::string& hw_name, const std::map<std
   }
 
   CNR_TRACE_START(m_logger);
-  double sampling_period = 0.001;
   std::string what;
+  m_state_channel.reset(new HwStateChannel());
+  if (!m_state_channel->init(m_hw_name, m_logger, what))
+  {
+    CNR_ERROR(m_logger, what);
+    CNR_RETURN_FALSE(m_logger);
+  }
+
+  double sampling_period = 0.001;
   if (!rosparam_utilities::get(m_hw_nh.getNamespace() +"/sampling_period", sampling_period,what,&sampling_period))
   {
     CNR_WARN(m_logger, m_hw_namespace + "/sampling_period' does not exist, set equal to 0.001");
@@ -223,12 +188,79 @@ bool RobotHwDriverInterface::init(const std::string& hw_name, const std::map<std
   }
 
   m_period = ros::Duration(sampling_period);
+
+  std::string cycle_clock = CycleClock::to_string(PREEMPTIVE_RT ? CycleClock::CLOCK_NANOSLEEP : CycleClock::WALLRATE);
+  if (!rosparam_utilities::get(m_hw_nh.getNamespace() +"/cycle_clock", cycle_clock, what, &cycle_clock))
+  {
+    CNR_WARN(m_logger, m_hw_namespace + "/cycle_clock' does not exist, set equal to '" << cycle_clock << "'");
+  }
+  CycleClock::Type cycle_clock_type;
+  if (!CycleClock::from_string(cycle_clock, cycle_clock_type))
+  {
+    CNR_ERROR(m_logger, m_hw_namespace + "/cycle_clock' is '" << cycle_clock << "', while the allowed values are "
+                  << "'clock_nanosleep', 'timerfd', 'hybrid' and 'wallrate'. Abort.");
+    CNR_RETURN_FALSE(m_logger);
+  }
+  double spin_threshold = 50.0e-6;
+  if (!rosparam_utilities::get(m_hw_nh.getNamespace() +"/cycle_clock_spin_threshold", spin_threshold, what, &spin_threshold))
+  {
+    spin_threshold = 50.0e-6;
+  }
+  m_cycle_clock = CycleClock::create(cycle_clock_type, m_period.toNSec(), static_cast<int64_t>(spin_threshold * 1e9));
+  CNR_INFO(m_logger, "Cycle clock: '" << CycleClock::to_string(m_cycle_clock->type()) << "'");
+
+  if (!load_rt_config(m_hw_namespace, m_period.toNSec(), m_rt_config, what))
+  {
+    CNR_ERROR(m_logger, what);
+    CNR_RETURN_FALSE(m_logger);
+  }
+  CNR_INFO(m_logger, "Loop thread: " << to_string(m_rt_config.loop) << ", non-RT threads: " << to_string(m_rt_config.non_rt));
+
+  OverrunPolicy overrun_policy;
+  if (!load_overrun_policy(m_hw_namespace, overrun_policy, what))
+  {
+    CNR_ERROR(m_logger, what);
+    CNR_RETURN_FALSE(m_logger);
+  }
+  m_loop_status = cnr::control::hw_loop_status(m_hw_name);
+  m_claim_groups = cnr::control::claim_groups(m_hw_name);
+  m_overrun.init(overrun_policy, m_loop_status);
+  m_cycle_clock->setMaxBurst(overrun_policy.clockMaxBurst());
+  CNR_INFO(m_logger, "Overrun policy: " << to_string(overrun_policy));
+
+  if (!load_loop_watchdog_config(m_hw_namespace, m_watchdog_config, what))
+  {
+    CNR_ERROR(m_logger, what);
+    CNR_RETURN_FALSE(m_logger);
+  }
+
+  if (!load_lockstep_config(m_hw_namespace, m_lockstep_config, what))
+  {
+    CNR_ERROR(m_logger, what);
+    CNR_RETURN_FALSE(m_logger);
+  }
+
+  m_alloc_sentinel = false;
+  if (!rosparam_utilities::get(m_hw_namespace + "/allocation_sentinel", m_alloc_sentinel, what, &m_alloc_sentinel))
+  {
+    m_alloc_sentinel = false;
+  }
+  if (m_alloc_sentinel && !cnr::control::allocation_sentinel::compiled())
+  {
+    CNR_WARN(m_logger, "The allocation sentinel is requested, but cnr_controller_interface_params has been compiled "
+                       "without -DALLOCATION_SENTINEL=ON: the allocations are not counted");
+  }
+  if (m_alloc_sentinel)
+  {
+    cnr::control::allocation_sentinel::enable();
+  }
+
   dumpState(cnr_hardware_interface::UNLOADED);
   realtime_utilities::DiagnosticsInterface::init(m_hw_name, "RobotHwDriverInterface", "Main Loop");
-  realtime_utilities::DiagnosticsInterface::addTimeTracker("cycle",sampling_period);
-  realtime_utilities::DiagnosticsInterface::addTimeTracker("read",sampling_period);
-  realtime_utilities::DiagnosticsInterface::addTimeTracker("write",sampling_period);
-  realtime_utilities::DiagnosticsInterface::addTimeTracker("update",sampling_period);
+  for (auto& histogram : m_histograms)
+  {
+    histogram.setOverrunThreshold(m_period.toNSec());
+  }
   
   m_robot_hw_loader.reset(
     new pluginlib::ClassLoader<hardware_interface::RobotHW>("hardware_interface", "hardware_interface::RobotHW"));
@@ -262,6 +294,7 @@ bool RobotHwDriverInterface::init(const std::string& hw_name, const std::map<std
     }
     CNR_INFO(m_logger, "m_hw set");
     m_cnr_hw = dynamic_cast<cnr_hardware_interface::RobotHW*>(m_hw.get()); // if not null, there are many fancy & funny functions
+    m_cycle_hw = dynamic_cast<cnr::control::CycleAwareHw*>(m_hw.get());
     if (m_cnr_hw) CNR_INFO(m_logger, "is m_cnr_hw");
     if (!m_cnr_hw) CNR_INFO(m_logger, "is not m_cnr_hw");
     dumpState( m_cnr_hw ? m_cnr_hw->getState() : cnr_hardware_interface::CREATED );
@@ -289,6 +322,57 @@ bool RobotHwDriverInterface::init(const std::string& hw_name, const std::map<std
     // CREATE THE CONTROLLER MANAGER INTERFACE FROM THE ControllerManager
     m_cmi.reset(new cnr_controller_manager_interface::ControllerManagerInterface(m_logger, m_hw_name, m_cm.get()));
     //==========================================================
+
+    //==========================================================
+    // PIPELINED I/O
+    bool pipeline = false;
+    if (!rosparam_utilities::get(m_hw_namespace + "/pipeline", pipeline, what, &pipeline))
+    {
+      pipeline = false;
+    }
+    m_pipelined_hw = pipeline ? dynamic_cast<cnr::control::PipelinedHw*>(m_hw.get()) : nullptr;
+    if (pipeline && !m_pipelined_hw)
+    {
+      CNR_WARN(m_logger, "The pipelined I/O is requested, but the RobotHw '" << robot_type << "' does not implement "
+                         "cnr::control::PipelinedHw: read(), update() and write() run sequentially");
+    }
+
+    m_parallel_workers = 0;
+    if (!rosparam_utilities::get(m_hw_namespace + "/parallel_workers", m_parallel_workers, what, &m_parallel_workers)
+     || (m_parallel_workers < 0))
+    {
+      m_parallel_workers = 0;
+    }
+
+    if (m_lockstep_config.enabled && !dynamic_cast<cnr::control::SimulatedHw*>(m_hw.get()))
+    {
+      CNR_ERROR(m_logger, "The lockstep mode is requested, but the RobotHw '" << robot_type << "' does not implement "
+                          "cnr::control::SimulatedHw: only the RobotHWs without physical I/O can run on a simulated "
+                          "clock. Abort.");
+      dumpState(cnr_hardware_interface::ERROR);
+      CNR_RETURN_FALSE(m_logger);
+    }
+    if (m_lockstep_config.enabled)
+    {
+      CNR_INFO(m_logger, "Lockstep mode, real-time factor: " << (m_lockstep_config.real_time_factor > 0
+                          ? to_string(m_lockstep_config.real_time_factor, 2) : std::string("unbounded")));
+    }
+    //==========================================================
+
+    //==========================================================
+    // FLIGHT RECORDER
+    if (!initFlightRecorder(what))
+    {
+      CNR_ERROR(m_logger, what);
+      CNR_RETURN_FALSE(m_logger);
+    }
+    //==========================================================
+
+    //==========================================================
+    // START THE NON-RT THREAD THAT SERVES THE CALLBACKS
+    m_stop_callback_thread = false;
+    m_callback_thread = std::thread(&RobotHwDriverInterface::callbackThread, this);
+    //==========================================================
   }
   catch (pluginlib::PluginlibException& ex)
   {
@@ -311,28 +395,117 @@ bool RobotHwDriverInterface::init(const std::string& hw_name, const std::map<std
 
 
 
+bool RobotHwDriverInterface::initFlightRecorder(std::string& error)
+{
+  int cycles = 2000;
+  if (!rosparam_utilities::get(m_hw_namespace + "/flight_recorder/cycles", cycles, error, &cycles))
+  {
+    cycles = 2000;
+  }
+  bool joint_snapshot = false;
+  if (!rosparam_utilities::get(m_hw_namespace + "/flight_recorder/joint_snapshot", joint_snapshot, error, &joint_snapshot))
+  {
+    joint_snapshot = false;
+  }
+  std::string directory = ros::file_log::getLogDirectory();
+  if (!rosparam_utilities::get(m_hw_namespace + "/flight_recorder/directory", directory, error, &directory))
+  {
+    directory = ros::file_log::getLogDirectory();
+  }
+  // a clean stop (SHUTDOWN) does not dump by default
+  const std::vector<std::string> default_dump_on = {cnr_hardware_interface::to_string(cnr_hardware_interface::ERROR),
+                                                    cnr_hardware_interface::to_string(cnr_hardware_interface::SRV_ERROR),
+                                                    cnr_hardware_interface::to_string(cnr_hardware_interface::CTRL_ERROR)};
+  std::vector<std::string> dump_on = default_dump_on;
+  if (!rosparam_utilities::get(m_hw_namespace + "/flight_recorder/dump_on", dump_on, error, &default_dump_on))
+  {
+    dump_on = default_dump_on;
+  }
+  m_flight_recorder_dump_on = 0;
+  for (const std::string& name : dump_on)
+  {
+    bool found = false;
+    for (const cnr_hardware_interface::StatusHw& it : cnr_hardware_interface::StatusHwIterator())
+    {
+      if (name == cnr_hardware_interface::to_string(it))
+      {
+        m_flight_recorder_dump_on |= 1u << static_cast<uint32_t>(it);
+        found = true;
+      }
+    }
+    if (!found)
+    {
+      error = "The state '" + name + "' in '" + m_hw_namespace + "/flight_recorder/dump_on' is not a state of the RobotHW";
+      return false;
+    }
+  }
+  error.clear();
+
+  std::vector<std::string> names;
+  std::vector<const double*> position, velocity, effort;
+  hardware_interface::JointStateInterface* jsi = m_hw->get<hardware_interface::JointStateInterface>();
+  if (joint_snapshot && jsi)
+  {
+    names = jsi->getNames();
+    for (const std::string& name : names)
+    {
+      hardware_interface::JointStateHandle handle = jsi->getHandle(name);
+      position.push_back(handle.getPositionPtr());
+      velocity.push_back(handle.getVelocityPtr());
+      effort.push_back(handle.getEffortPtr());
+    }
+  }
+  else if (joint_snapshot)
+  {
+    CNR_WARN(m_logger, "The RobotHW has not a JointStateInterface, the flight recorder does not store the joint states");
+  }
+
+  m_flight_recorder.reset(new FlightRecorder());
+  if (!m_flight_recorder->init(m_hw_name, m_logger, static_cast<size_t>(std::max(cycles, 0)), m_period.toNSec(),
+                               directory, names, position, velocity, effort, error))
+  {
+    return false;
+  }
+  if (m_flight_recorder->enabled())
+  {
+    CNR_INFO(m_logger, "Flight recorder: last " << cycles << " cycles (" << names.size() << " joints), dumped in '"
+                         << directory << "'");
+  }
+  return true;
+}
+
 void RobotHwDriverInterface::diagnosticsThread()
 {
   CNR_INFO(m_logger, "Diagnostics Thread Started");
+  std::string error;
+  if (!apply_to_this_thread(m_rt_config.non_rt, error))
+  {
+    CNR_WARN(m_logger, "Diagnostics Thread: " << error);
+  }
   diagnostic_updater::Updater   updater(m_hw_nh, ros::NodeHandle("~"), "/" + m_hw_name);
 
   updater.setHardwareID(m_hw_name);
   std::string id = "RobotHW | ";
 
   realtime_utilities::DiagnosticsInterfacePtr            hw_d  = std::dynamic_pointer_cast<realtime_utilities::DiagnosticsInterface>(m_hw);
-  realtime_utilities::DiagnosticsInterface*              hwn_d = dynamic_cast<realtime_utilities::DiagnosticsInterface*>(this);
 
   updater.add(id + "Info"      , hw_d.get(), &cnr_hardware_interface::RobotHW::diagnosticsInfo);
   updater.add(id + "Warning"   , hw_d.get(), &cnr_hardware_interface::RobotHW::diagnosticsWarn);
   updater.add(id + "Error"     , hw_d.get(), &cnr_hardware_interface::RobotHW::diagnosticsError);
   updater.add(id + "Timers"    , hw_d.get(), &cnr_hardware_interface::RobotHW::diagnosticsPerformance);
-  updater.add(id + "Main Loop (nodelet)", hwn_d, &RobotHwDriverInterface::diagnosticsPerformance);
+  updater.add(id + "Main Loop (nodelet)", this, &RobotHwDriverInterface::diagnosticsLoop);
+  updater.add(id + "Cycle Clock", this, &RobotHwDriverInterface::diagnosticsCycleClock);
+  if (m_alloc_sentinel)
+  {
+    updater.add(id + "Allocations", this, &RobotHwDriverInterface::diagnosticsAllocations);
+  }
 
   id = "Ctrl | ";
   updater.add(id + "Info"    , m_cmi.get(), &cnr_controller_manager_interface::ControllerManagerInterface::diagnosticsInfo);
   updater.add(id + "Warning" , m_cmi.get(), &cnr_controller_manager_interface::ControllerManagerInterface::diagnosticsWarn);
   updater.add(id + "Error"   , m_cmi.get(), &cnr_controller_manager_interface::ControllerManagerInterface::diagnosticsError);
   updater.add(id + "Timers"  , m_cmi.get(), &cnr_controller_manager_interface::ControllerManagerInterface::diagnosticsPerformance);
+  updater.add(id + "Cost"    , m_cmi.get(), &cnr_controller_manager_interface::ControllerManagerInterface::diagnosticsCost);
 
   ros::WallDuration wd(updater.getPeriod());
   m_diagnostics_thread_running = true;
@@ -345,31 +518,44 @@ void RobotHwDriverInterface::diagnosticsThread()
   CNR_DEBUG(m_logger, "Diagnostic finished.");
   return;
 }
+void RobotHwDriverInterface::callbackThread()
+{
+  CNR_DEBUG(m_logger, "Callback Thread Started");
+  std::string error;
+  if (!apply_to_this_thread(m_rt_config.non_rt, error))
+  {
+    CNR_WARN(m_logger, "Callback Thread: " << error);
+  }
+  while (ros::ok() && !m_stop_callback_thread)
+  {
+    m_callback_queue.callAvailable(ros::WallDuration(0.01));
+  }
+  CNR_DEBUG(m_logger, "Callback Thread finished.");
+}
+
 bool RobotHwDriverInterface::start(const ros::Duration& watchdog) 
 {
   CNR_TRACE_START(m_logger);
   m_stop_run = false; 
   m_thread_run = std::thread(&RobotHwDriverInterface::run, this);
-  ros::Time start = ros::Time::now();
-  while(ros::ok())
+  cnr_hardware_interface::StatusHw reached;
+  if (!waitForState({cnr_hardware_interface::RUNNING, cnr_hardware_interface::ERROR}, watchdog, &reached))
   {
-    if((ros::Time::now()-start) > watchdog)
-    {
-      CNR_RETURN_FALSE(m_logger);
-    }
-    if(retriveState() == cnr_hardware_interface::RUNNING)
-    {
-      CNR_WARN(m_logger, "RobotHW RT-Control Loop Started!");
-      break;
-    }
+    CNR_ERROR(m_logger, "The RobotHW RT-Control Loop did not start within the watchdog. Abort.");
+    CNR_RETURN_FALSE(m_logger);
+  }
+  if (reached != cnr_hardware_interface::RUNNING)
+  {
+    CNR_ERROR(m_logger, "The RobotHW RT-Control Loop failed in starting. Abort.");
+    CNR_RETURN_FALSE(m_logger);
   }
+  CNR_WARN(m_logger, "RobotHW RT-Control Loop Started!");
   CNR_RETURN_TRUE(m_logger);
 }
 bool RobotHwDriverInterface::stop(const ros::Duration& watchdog)
 {
   CNR_TRACE_START(m_logger);
   m_stop_run = true;
-  ros::Time start = ros::Time::now();
   if( m_thread_run.joinable() )
   {
     CNR_WARN(m_logger, "Waiting for joining the run() thread");
@@ -377,20 +563,13 @@ bool RobotHwDriverInterface::stop(const ros::Duration& watchdog)
   }
   else
   {
-    while(ros::ok())
+    CNR_WARN(m_logger, "Waiting for stopping the run()");
+    if (!m_state_channel || !m_state_channel->waitForNot(cnr_hardware_interface::RUNNING, watchdog))
     {
-      CNR_WARN(m_logger, "Waiting for stopping the run()");
-      if((ros::Time::now()-start) > watchdog)
-      {
-        CNR_ERROR(m_logger, "The thread did not stopped within the expected watchdog. Abort");
-        CNR_RETURN_FALSE(m_logger);
-      }
-      if(retriveState()!=cnr_hardware_interface::RUNNING)
-      {
-        CNR_WARN(m_logger, "RobotHW RT-Control Loop Ended!");
-        break;
-      }
+      CNR_ERROR(m_logger, "The thread did not stopped within the expected watchdog. Abort");
+      CNR_RETURN_FALSE(m_logger);
     }
+    CNR_WARN(m_logger, "RobotHW RT-Control Loop Ended!");
   }
   CNR_RETURN_TRUE(m_logger);
 }
@@ -405,12 +584,7 @@ void RobotHwDriverInterface::run()
 {
   CNR_TRACE_START(m_logger);
   std::string error;
-  if(!fetchState(error))
-  {
-    CNR_ERROR(m_logger, "Fetching the state failed: '" << error << "'");  
-    CNR_RETURN_NOTOK(m_logger, void());
-  }
-  if(retriveState()==cnr_hardware_interface::RUNNING)
+  if(getState()==cnr_hardware_interface::RUNNING)
   {
     CNR_ERROR(m_logger, "The Driver is already in running state.. have you called both 'start' and 'run'?");  
     CNR_RETURN_NOTOK(m_logger, void());
@@ -430,15 +604,16 @@ void RobotHwDriverInterface::run()
 
     m_diagnostics_thread_running = false;
     m_stop_diagnostic_thread     = false;
-    ros::Time start              = ros::Time::now();
+    ros::WallTime start          = ros::WallTime::now();
     m_diagnostics_thread         = std::thread(&cnr_hardware_driver_interface::RobotHwDriverInterface::diagnosticsThread, this);
     while(!m_diagnostics_thread_running)
     {
-      if ((ros::Time::now() - start).toSec() > 10.0)
+      // wall time: with '/use_sim_time', the ROS time may not run before the loop (e.g., in lockstep)
+      if ((ros::WallTime::now() - start).toSec() > 10.0)
       {
         CNR_RETURN_NOTOK(m_logger, void(), "Timeout Exipred. Main Thread did not started yet. Abort.");
       }
-      ros::Duration(0.05).sleep();
+      ros::WallDuration(0.05).sleep();
     }
   }
 
@@ -448,31 +623,53 @@ void RobotHwDriverInterface::run()
     dumpState(cnr_hardware_interface::RUNNING);
   }
 
-#if PREEMPTIVE_RT
-  realtime_utilities::period_info  pinfo;
-  if(!realtime_utilities::rt_init_thread(RT_STACK_SIZE, sched_get_priority_max(SCHED_RR)-2, SCHED_RR, &pinfo, m_period.toNSec()) )
+  if (!prepare_memory(m_rt_config, error) || !apply_to_this_thread(m_rt_config.loop, error))
   {
-    CNR_ERROR(m_logger, "Failed in setting thread rt properties. Exit. ");
-    std::raise(SIGINT);
-    return;
+    CNR_ERROR(m_logger, "Failed in setting thread rt properties: " << error);
+    dumpState(cnr_hardware_interface::ERROR);
+    CNR_RETURN_NOTOK(m_logger, void());
   }
-#endif
-
-#if defined(USE_TIMER_REALTIME_UTILS)
-  realtime_utilities::period_info ptarget;
-  ptarget.period_ns = m_period.toNSec();
+  prefault_stack(m_rt_config.prefault_stack);
 
-  clock_gettime(CLOCK_MONOTONIC, &(ptarget.next_period));
-  ptarget.next_period.tv_nsec  =  ( (ptarget.next_period.tv_nsec / 1000000) + 1 ) * 1000000 + 5e7;  // approx to ms
-  ptarget.next_period.tv_sec  += 0.0;
-#elif defined(USE_TIMERFD)
-  struct periodic_info info;
-  make_periodic( (m_period.toNSec() / 1000 ), &info);
-#elif defined(USE_WALLRATE)
-  ros::WallRate wr( m_period );
-#endif
+  if (m_lockstep_config.enabled ? !m_lockstep_clock.start(m_period.toNSec(), m_lockstep_config, error)
+                                 : !m_cycle_clock->start(error))
+  {
+    CNR_ERROR(m_logger, "Failed in starting the " << (m_lockstep_config.enabled ? "lockstep" : "cycle")
+                        << " clock: '" << error << "'");
+    dumpState(cnr_hardware_interface::ERROR);
+    CNR_RETURN_NOTOK(m_logger, void());
+  }
 
   m_stop_run = false;
+  m_overrun.reset();
+
+  // the I/O thread and the parallel workers (if any) are stopped at every exit of the loop
+  struct IoThreadGuard
+  {
+    RobotHwDriverInterface* driver;
+    ~IoThreadGuard() { driver->m_watchdog.stop(); driver->stopIoThread(); driver->stopExecutor(); }
+  } io_guard{this};
+  if (m_pipelined_hw && !startIoThread(error))
+  {
+    CNR_WARN(m_logger, error << ": read(), update() and write() run sequentially");
+  }
+  if (m_parallel_workers > 0 && !startExecutor(error))
+  {
+    CNR_WARN(m_logger, error << ": the controllers are updated serially");
+  }
+  if (m_watchdog_config.missed_periods > 0)
+  {
+    // as urgent as the loop, but on the non-RT cores
+    ThreadRtConfig watchdog_config = m_rt_config.loop.policy == ThreadRtConfig::DEADLINE ? m_rt_config.non_rt
+                                                                                         : m_rt_config.loop;
+    watchdog_config.cpus = m_rt_config.non_rt.cpus;
+    if (!m_watchdog.start(m_period.toNSec(), m_watchdog_config.missed_periods, watchdog_config,
+                          std::bind(&RobotHwDriverInterface::onLoopStall, this, std::placeholders::_1),
+                          std::bind(&RobotHwDriverInterface::onLoopResume, this, std::placeholders::_1), error))
+    {
+      CNR_WARN(m_logger, error << ": the loop runs without watchdog");
+    }
+  }
 
   try
   {
@@ -489,68 +686,173 @@ void RobotHwDriverInterface::run()
     dumpState(cnr_hardware_interface::ERROR);
     CNR_RETURN_NOTOK(m_logger, void());
   }
+  if (m_cnr_hw)
+  {
+    dumpState(m_cnr_hw->getState());
+  }
 
+  CycleRecord rec;
+  uint64_t cycle = 0;
   while (ros::ok() && !m_stop_run)
   {
-#if defined(USE_TIMER_REALTIME_UTILS)
-  realtime_utilities::timer_wait_rest_of_period(&(ptarget.next_period));
-  realtime_utilities::timer_inc_period(&ptarget);
-#elif defined(USE_TIMERFD)
-  wait_period(&info);
-#elif defined(USE_WALLRATE)
-  wr.sleep();
-#endif
+    const uint64_t missed = m_lockstep_config.enabled ? 0 : m_cycle_clock->wait();
+
+    // the only clock readings of the cycle passed to the RobotHW and to the controllers
+    cnr::control::CycleContext& ctx = m_loop_status->context;
+    const int64_t t_wake = now_nsec();
+    ctx.cycle     = cycle;
+    ctx.overruns  = m_overrun.overruns();
+    ctx.missed    = missed;
+    ctx.simulated = m_lockstep_config.enabled;
+    if (ctx.simulated)
+    {
+      if (!m_lockstep_clock.tick(ctx.time))
+      {
+        CNR_ERROR(m_logger, "The simulated time published on '/clock' did not reach the process within 1s. Abort.");
+        dumpState(cnr_hardware_interface::ERROR);
+        CNR_RETURN_NOTOK(m_logger, void());
+      }
+      ctx.dt       = m_period.toNSec();
+      ctx.stamp    = t_wake;
+      ctx.deadline = t_wake;
+    }
+    else
+    {
+      ctx.dt       = (cycle == 0) ? m_period.toNSec() : t_wake - ctx.stamp;
+      ctx.stamp    = t_wake;
+      ctx.deadline = to_nsec(m_cycle_clock->deadline());
+      ctx.time     = ros::Time::now();
+    }
+    ctx.period.fromNSec(ctx.dt);
 
-    m_callback_queue.callAvailable();
+    rec = CycleRecord();
+    rec.cycle = cycle++;
+    rec.t_deadline = ctx.deadline;
+    cnr::control::AllocationScope cycle_scope(m_alloc_sentinel ? &m_allocations[PHASE_CYCLE] : nullptr);
 
-    timeSpanStrakcer("cycle")->time_span();
     if (m_stop_run)
     {
       CNR_WARN(m_logger, "Exiting update thread of the hardware interface because a stop has been triggered.");
       break;
     }
 
-    try
+    // no update is forked between the cycles: the groups of the controllers registered since the last cycle
+    m_claim_groups->swap();
+    // a switch of the controllers is pending: the controller manager starts and stops them after their
+    // updates, within m_cmi->update(), hence they are not forked until the switch is done
+    const bool serial = m_loop_status->serial_requests.load(std::memory_order_acquire) != 0;
+    m_loop_status->serial.store(serial, std::memory_order_relaxed);
+    if (serial)
     {
-      timeSpanStrakcer("read")->tick();
-      m_hw->read(ros::Time::now(), m_period);
-      timeSpanStrakcer("read")->tock();
-    }
-    catch (std::exception& e)
-    {
-      CNR_ERROR(m_logger, "updateThread error call hardware interface read(): " << e.what());
-      dumpState(cnr_hardware_interface::ERROR);
-      CNR_RETURN_NOTOK(m_logger, void());
+      m_loop_status->serial_cycles.fetch_add(1, std::memory_order_release);
     }
 
-    try
+    int64_t t_start = 0;
+    if (m_pipelined)
     {
-      timeSpanStrakcer("update")->tick();
-      // 
-      // it executes the 
-      // hw->doSwitch() as needed, and the update of the control strategies
-      //
-      m_cmi->update(ros::Time::now(), m_period);
-      timeSpanStrakcer("update")->tock();
-    }
-    catch (std::exception& e)
-    {
-      CNR_WARN(m_logger, "updateThread error call controller manager update(): " << std::string(e.what()));
-      dumpState(cnr_hardware_interface::ERROR);
-      return;
-    }
+      // the state read in the previous cycle goes to the handles, and the commands of the previous update to the I/O
+      m_pipelined_hw->exchangeBuffers();
+      m_io_context = ctx;
+      sem_post(&m_io_go);
+
+      bool update_ok = true;
+      const int64_t t_update = now_nsec();
+      try
+      {
+        cnr::control::AllocationScope scope(m_alloc_sentinel ? &m_allocations[PHASE_UPDATE] : nullptr);
+        m_cmi->update(ctx.time, ctx.period);
+        m_executor.join();
+      }
+      catch (std::exception& e)
+      {
+        CNR_WARN(m_logger, "updateThread error call controller manager update(): " << std::string(e.what()));
+        update_ok = false;
+      }
+      const int64_t t_update_end = now_nsec();
 
-    try
-    {
-      timeSpanStrakcer("write")->tick();
-      m_hw->write(ros::Time::now(), m_period);
-      timeSpanStrakcer("write")->tock();
+      // the I/O is always waited for, so that the I/O thread is idle when the loop exits
+      while (sem_wait(&m_io_done) != 0 && errno == EINTR)
+      {
+      }
+
+      rec.t_write  = m_io_cycle.t_write;
+      rec.t_read   = m_io_cycle.t_read;
+      rec.t_update = t_update;
+      rec.t_end    = std::max(m_io_cycle.t_end, t_update_end);
+      t_start      = std::min(m_io_cycle.t_write, t_update);
+      if (!update_ok)
+      {
+        recordCycle(rec, CycleRecord::UPDATE_ERROR, cnr_hardware_interface::ERROR);
+        dumpState(cnr_hardware_interface::ERROR);
+        return;
+      }
+      if (m_io_cycle.error)
+      {
+        CNR_ERROR(m_logger, "updateThread error in the I/O thread: the " <<
+                  (m_io_cycle.error == CycleRecord::READ_ERROR ? "read()" : "write()") << " failed");
+        recordCycle(rec, m_io_cycle.error, cnr_hardware_interface::ERROR);
+        dumpState(cnr_hardware_interface::ERROR);
+        CNR_RETURN_NOTOK(m_logger, void());
+      }
+      m_histograms[PHASE_READ].record(m_io_cycle.t_end - m_io_cycle.t_read);
+      m_histograms[PHASE_UPDATE].record(t_update_end - t_update);
+      m_histograms[PHASE_WRITE].record(m_io_cycle.t_read - m_io_cycle.t_write);
+      m_histograms[PHASE_CYCLE].record(rec.t_end - t_start);
     }
-    catch (std::exception& e)
+    else
     {
-      CNR_ERROR(m_logger, "updateThread error call hardware interface write() " << e.what());
-      dumpState(cnr_hardware_interface::ERROR);
-      CNR_RETURN_NOTOK(m_logger, void());
+      try
+      {
+        cnr::control::AllocationScope scope(m_alloc_sentinel ? &m_allocations[PHASE_READ] : nullptr);
+        rec.t_read = now_nsec();
+        hwRead(ctx);
+        rec.t_update = now_nsec();
+        m_histograms[PHASE_READ].record(rec.t_update - rec.t_read);
+      }
+      catch (std::exception& e)
+      {
+        CNR_ERROR(m_logger, "updateThread error call hardware interface read(): " << e.what());
+        recordCycle(rec, CycleRecord::READ_ERROR, cnr_hardware_interface::ERROR);
+        dumpState(cnr_hardware_interface::ERROR);
+        CNR_RETURN_NOTOK(m_logger, void());
+      }
+
+      try
+      {
+        // 
+        // it executes the 
+        // hw->doSwitch() as needed, and the update of the control strategies
+        //
+        cnr::control::AllocationScope scope(m_alloc_sentinel ? &m_allocations[PHASE_UPDATE] : nullptr);
+        m_cmi->update(ctx.time, ctx.period);
+        m_executor.join();
+        rec.t_write = now_nsec();
+        m_histograms[PHASE_UPDATE].record(rec.t_write - rec.t_update);
+      }
+      catch (std::exception& e)
+      {
+        CNR_WARN(m_logger, "updateThread error call controller manager update(): " << std::string(e.what()));
+        recordCycle(rec, CycleRecord::UPDATE_ERROR, cnr_hardware_interface::ERROR);
+        dumpState(cnr_hardware_interface::ERROR);
+        return;
+      }
+
+      try
+      {
+        cnr::control::AllocationScope scope(m_alloc_sentinel ? &m_allocations[PHASE_WRITE] : nullptr);
+        hwWrite(ctx);
+        rec.t_end = now_nsec();
+        m_histograms[PHASE_WRITE].record(rec.t_end - rec.t_write);
+        m_histograms[PHASE_CYCLE].record(rec.t_end - rec.t_read);
+        t_start = rec.t_read;
+      }
+      catch (std::exception& e)
+      {
+        CNR_ERROR(m_logger, "updateThread error call hardware interface write() " << e.what());
+        recordCycle(rec, CycleRecord::WRITE_ERROR, cnr_hardware_interface::ERROR);
+        dumpState(cnr_hardware_interface::ERROR);
+        CNR_RETURN_NOTOK(m_logger, void());
+      }
     }
 
     // if (m_cmi)
@@ -583,12 +885,44 @@ void RobotHwDriverInterface::run()
     //   };
     // }
 
-    if (m_cnr_hw && m_cnr_hw->getState() == cnr_hardware_interface::ERROR)
+    // in lockstep, the wall-clock duration of the cycle is not bound to the period
+    const bool overrun = !ctx.simulated && (rec.t_end - t_start > m_period.toNSec());
+    if (m_overrun.update(overrun || (missed > 0)) && m_state_channel)
+    {
+      m_state_channel->notify();
+    }
+
+    const bool stalled = m_watchdog.stalled();
+    const cnr_hardware_interface::StatusHw hw_state = m_cnr_hw ? m_cnr_hw->getState() : getState();
+    recordCycle(rec, (overrun ? CycleRecord::OVERRUN : 0)
+                     | (missed > 0 ? CycleRecord::MISSED : 0)
+                     | (m_overrun.degraded() ? CycleRecord::DEGRADED : 0)
+                     | (stalled ? CycleRecord::STALLED : 0)
+                     | (hw_state == cnr_hardware_interface::ERROR ? CycleRecord::HW_ERROR : 0),
+                stalled ? cnr_hardware_interface::ERROR : hw_state);
+    if (stalled)
+    {
+      CNR_ERROR(m_logger, "The RT loop resumed after a stall detected by the watchdog. Abort.");
+      dumpState(cnr_hardware_interface::ERROR);
+      CNR_RETURN_NOTOK(m_logger, void());
+    }
+    m_watchdog.beat();
+    // a stall detected between the check above and the beat has already forced the ERROR: do not overwrite it
+    if (m_watchdog.stalled())
     {
-      CNR_ERROR_THROTTLE(m_logger, 1.0, "RobotHw is in error");
+      CNR_ERROR(m_logger, "The watchdog detected a stall of the RT loop. Abort.");
       dumpState(cnr_hardware_interface::ERROR);
       CNR_RETURN_NOTOK(m_logger, void());
     }
+    if (m_cnr_hw)
+    {
+      dumpState(hw_state);
+      if (hw_state == cnr_hardware_interface::ERROR)
+      {
+        CNR_ERROR_THROTTLE(m_logger, 1.0, "RobotHw is in error");
+        CNR_RETURN_NOTOK(m_logger, void());
+      }
+    }
   }
 
   dumpState(cnr_hardware_interface::SHUTDOWN);
@@ -597,47 +931,349 @@ void RobotHwDriverInterface::run()
 }
 
 
-//==================================================
-bool RobotHwDriverInterface::dumpState(const cnr_hardware_interface::StatusHw& status)
+void RobotHwDriverInterface::onLoopStall(const int64_t& silence)
 {
-  std::string last_status = cnr_hardware_interface::to_string(retriveState());
-  if(m_state_history.size() == 0)
+  CNR_FATAL(m_logger, "The RT loop is stalled: no cycle completed in the last " << to_string(1e-6 * silence, 1)
+                      << "ms (" << m_watchdog_config.missed_periods << " periods allowed)");
+  if (m_state_channel)
   {
-    m_state_history.push_back(last_status);
+    m_state_channel->set(cnr_hardware_interface::ERROR);
+  }
+  if (!m_watchdog_config.safe_action_service.empty())
+  {
+    std_srvs::Trigger srv;
+    if (!ros::service::call(m_watchdog_config.safe_action_service, srv) || !srv.response.success)
+    {
+      CNR_ERROR(m_logger, "The safe action '" << m_watchdog_config.safe_action_service << "' failed: '"
+                          << srv.response.message << "'");
+    }
+    else
+    {
+      CNR_WARN(m_logger, "Safe action '" << m_watchdog_config.safe_action_service << "' done");
+    }
+  }
+}
+
+void RobotHwDriverInterface::onLoopResume(const int64_t& silence)
+{
+  CNR_WARN(m_logger, "The RT loop beats again after " << to_string(1e-6 * silence, 1) << "ms");
+}
+
+void RobotHwDriverInterface::hwRead(const cnr::control::CycleContext& ctx)
+{
+  if (m_cycle_hw)
+  {
+    m_cycle_hw->readCycle(ctx);
   }
   else
   {
-    if(m_state_history.back() != last_status)
+    m_hw->read(ctx.time, ctx.period);
+  }
+}
+
+void RobotHwDriverInterface::hwWrite(const cnr::control::CycleContext& ctx)
+{
+  if (m_cycle_hw)
+  {
+    m_cycle_hw->writeCycle(ctx);
+  }
+  else
+  {
+    m_hw->write(ctx.time, ctx.period);
+  }
+}
+
+bool RobotHwDriverInterface::startExecutor(std::string& error)
+{
+  auto thread_init = [this](const size_t& i)
+  {
+    ThreadRtConfig config = m_rt_config.worker;
+    if (!config.cpus.empty())
+    {
+      config.cpus = { config.cpus.at(i % config.cpus.size()) };
+    }
+    std::string what;
+    if (!apply_to_this_thread(config, what))
     {
-      m_state_history.push_back(last_status);
-      ros::param::set(hw_last_status_param_name(m_hw_namespace), last_status);
-      ros::param::set(hw_status_param_name(m_hw_namespace), m_state_history);
-      CNR_DEBUG(m_logger, "RobotHW '" << m_hw_namespace
-                            << "' New Status " <<  cnr_hardware_interface::to_string(retriveState()));
+      CNR_WARN(m_logger, "Failed in setting the rt properties of the worker " << i << ": " << what);
     }
+    prefault_stack(m_rt_config.prefault_stack);
+  };
+  if (!m_executor.start(static_cast<size_t>(m_parallel_workers), thread_init, error))
+  {
+    return false;
   }
-  m_state = status;
+  m_loop_status->executor.store(&m_executor, std::memory_order_release);
   return true;
 }
 
-bool RobotHwDriverInterface::fetchState(std::string& error)
+void RobotHwDriverInterface::stopExecutor()
+{
+  m_loop_status->executor.store(nullptr, std::memory_order_release);
+  m_executor.stop();
+}
+
+bool RobotHwDriverInterface::startIoThread(std::string& error)
 {
-  std::string status;
-  if(!ros::param::get(hw_last_status_param_name(m_hw_namespace), status))
+  if (!m_pipelined_hw->enablePipeline(true))
   {
-    error = "The param status does not exists...";
+    error = "The RobotHw '" + m_hw_name + "' refused the pipelined I/O";
     return false;
   }
-  for (const cnr_hardware_interface::StatusHw& it : cnr_hardware_interface::StatusHwIterator())
+
+  // the first update() runs on this state, and there are no commands to write before it
+  try
+  {
+    m_hw->read(ros::Time::now(), m_period);
+  }
+  catch (std::exception& e)
+  {
+    m_pipelined_hw->enablePipeline(false);
+    error = "The first read() of the pipelined I/O failed: " + std::string(e.what());
+    return false;
+  }
+  m_io_skip_write = true;
+
+  sem_init(&m_io_go, 0, 0);
+  sem_init(&m_io_done, 0, 0);
+  m_stop_io_thread = false;
+  m_io_thread = std::thread(&RobotHwDriverInterface::ioThread, this);
+  m_pipelined = true;
+  return true;
+}
+
+void RobotHwDriverInterface::stopIoThread()
+{
+  if (!m_io_thread.joinable())
+  {
+    return;
+  }
+  m_stop_io_thread = true;
+  sem_post(&m_io_go);
+  m_io_thread.join();
+  sem_destroy(&m_io_go);
+  sem_destroy(&m_io_done);
+  m_pipelined = false;
+  m_pipelined_hw->enablePipeline(false);
+}
+
+void RobotHwDriverInterface::ioThread()
+{
+  std::string error;
+  if (!apply_to_this_thread(m_rt_config.io, error))
+  {
+    CNR_WARN(m_logger, "Failed in setting the rt properties of the I/O thread: " << error);
+  }
+  prefault_stack(m_rt_config.prefault_stack);
+
+  while (true)
   {
-    if (status == cnr_hardware_interface::to_string(it))
+    while (sem_wait(&m_io_go) != 0 && errno == EINTR)
+    {
+    }
+    if (m_stop_io_thread)
+    {
+      break;
+    }
+
+    m_io_cycle.error   = 0;
+    m_io_cycle.t_write = now_nsec();
+    if (!m_io_skip_write)
+    {
+      try
+      {
+        cnr::control::AllocationScope scope(m_alloc_sentinel ? &m_allocations[PHASE_WRITE] : nullptr);
+        hwWrite(m_io_context);
+      }
+      catch (std::exception& e)
+      {
+        CNR_ERROR(m_logger, "ioThread error call hardware interface write() " << e.what());
+        m_io_cycle.error = CycleRecord::WRITE_ERROR;
+      }
+    }
+    m_io_skip_write = false;
+
+    m_io_cycle.t_read = now_nsec();
+    if (!m_io_cycle.error)
     {
-      m_state = it;
+      try
+      {
+        cnr::control::AllocationScope scope(m_alloc_sentinel ? &m_allocations[PHASE_READ] : nullptr);
+        hwRead(m_io_context);
+      }
+      catch (std::exception& e)
+      {
+        CNR_ERROR(m_logger, "ioThread error call hardware interface read(): " << e.what());
+        m_io_cycle.error = CycleRecord::READ_ERROR;
+      }
     }
-    return true;
+    m_io_cycle.t_end = now_nsec();
+    sem_post(&m_io_done);
   }
-  error = "The param status '"+status+"' is unrecongnized...";
-  return false;
+}
+
+void RobotHwDriverInterface::diagnosticsCycleClock(diagnostic_updater::DiagnosticStatusWrapper& stat)
+{
+  if (!m_cycle_clock)
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::STALE, "Cycle clock not created");
+    return;
+  }
+  if (m_lockstep_config.enabled)
+  {
+    stat.add("Type", "lockstep");
+    stat.add("Period [us]", to_string(1e-3 * m_lockstep_clock.period(), 1));
+    stat.add("Cycles", m_lockstep_clock.ticks());
+    stat.add("Real-Time Factor", to_string(m_lockstep_clock.realTimeFactor(), 1));
+    stat.add("Real-Time Factor Max", m_lockstep_config.real_time_factor > 0
+                                       ? to_string(m_lockstep_config.real_time_factor, 1) : std::string("unbounded"));
+    stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Simulated clock (lockstep)");
+    return;
+  }
+  const CycleClockStats st = m_cycle_clock->stats();
+  stat.add("Type", CycleClock::to_string(m_cycle_clock->type()));
+  stat.add("Period [us]", to_string(1e-3 * m_cycle_clock->period(), 1));
+  stat.add("Cycles", st.cycles);
+  stat.add("Missed Wakeups", st.missed_wakeups);
+  stat.add("Latency Last [us]", to_string(1e-3 * st.last_latency, 1));
+  stat.add("Latency Mean [us]", to_string(1e-3 * st.mean_latency, 1));
+  stat.add("Latency StdDev [us]", to_string(1e-3 * st.stddev_latency, 1));
+  stat.add("Latency Max [us]", to_string(1e-3 * st.max_latency, 1));
+  stat.add("Drift [us]", to_string(1e-3 * st.drift, 1));
+  stat.add("Loop Thread", cnr_hardware_driver_interface::to_string(m_rt_config.loop));
+  stat.add("I/O Thread", m_pipelined ? cnr_hardware_driver_interface::to_string(m_rt_config.io) : std::string("none (sequential)"));
+  stat.add("Parallel Workers", m_executor.workers());
+  stat.add("Memory Locked", m_rt_config.lock_memory ? "yes" : "no");
+  if (st.missed_wakeups > 0)
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::WARN, std::to_string(st.missed_wakeups) + " wakeups missed");
+  }
+  else
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Cycle clock nominal");
+  }
+}
+
+void RobotHwDriverInterface::diagnosticsLoop(diagnostic_updater::DiagnosticStatusWrapper& stat)
+{
+  static const char* names[N_PHASES] = {"read", "update", "write", "cycle"};
+  uint64_t overruns = 0;
+  for (size_t i = 0; i < N_PHASES; i++)
+  {
+    const LatencySummary s = m_histograms[i].summary();
+    stat.add(std::string(names[i]) + " p50/p99/p99.9/max [us]",
+             to_string(1e-3 * s.p50, 1) + " / " + to_string(1e-3 * s.p99, 1) + " / "
+               + to_string(1e-3 * s.p999, 1) + " / " + to_string(1e-3 * s.max, 1));
+    stat.add(std::string(names[i]) + " mean [us]", to_string(1e-3 * s.mean, 1));
+    stat.add(std::string(names[i]) + " overruns", std::to_string(s.overruns) + "/" + std::to_string(s.count));
+    overruns = i == PHASE_CYCLE ? s.overruns : overruns;
+  }
+  stat.add("Overrun Policy", to_string(m_overrun.policy()));
+  stat.add("Overrun Streak (current/max)", std::to_string(m_overrun.streak()) + " / " + std::to_string(m_overrun.maxStreak()));
+  stat.add("Overrun Cycles", m_overrun.overruns());
+  stat.add("Degradations", m_overrun.degradations());
+  if (m_watchdog.running())
+  {
+    stat.add("Watchdog", std::to_string(m_watchdog_config.missed_periods) + " periods");
+    stat.add("Watchdog Stalls", m_watchdog.stalls());
+    stat.add("Watchdog Max Silence [us]", to_string(1e-3 * m_watchdog.maxSilence(), 1));
+  }
+  else
+  {
+    stat.add("Watchdog", "disabled");
+  }
+  if (m_watchdog.stalled())
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::ERROR, "The loop is stalled: the state is forced to ERROR");
+  }
+  else if (m_overrun.degraded())
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::WARN,
+                 "Degraded: only the critical controllers are updated (streak: " + std::to_string(m_overrun.streak()) + ")");
+  }
+  else if (m_overrun.alarm())
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::ERROR,
+                 "The overrun streak reached " + std::to_string(m_overrun.policy().streak_limit));
+  }
+  else if (overruns > 0)
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::WARN,
+                 std::to_string(overruns) + " cycles longer than the sampling period");
+  }
+  else
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "Main loop within the sampling period");
+  }
+}
+
+void RobotHwDriverInterface::diagnosticsAllocations(diagnostic_updater::DiagnosticStatusWrapper& stat)
+{
+  static const char* names[N_PHASES] = {"read", "update", "write", "cycle"};
+  uint64_t new_allocations = 0;
+  for (size_t i = 0; i < N_PHASES; i++)
+  {
+    const cnr::control::AllocationCount c = m_allocations[i].get();
+    stat.add(std::string(names[i]) + " allocations/frees [bytes]",
+             std::to_string(c.allocations) + " / " + std::to_string(c.frees) + " [" + std::to_string(c.bytes) + "]");
+    new_allocations += i != PHASE_CYCLE ? c.allocations - m_allocations_reported[i] : 0;
+    m_allocations_reported[i] = c.allocations;
+  }
+  for (const auto& ctrl : cnr::control::allocation_sentinel::registered(m_hw_name + "/"))
+  {
+    stat.add("ctrl '" + ctrl.first.substr(m_hw_name.size() + 1) + "' allocations/frees [bytes]",
+             std::to_string(ctrl.second.allocations) + " / " + std::to_string(ctrl.second.frees)
+               + " [" + std::to_string(ctrl.second.bytes) + "]");
+  }
+
+  if (!cnr::control::allocation_sentinel::compiled())
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::STALE, "Allocation hooks not compiled");
+  }
+  else if (new_allocations > 0)
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::WARN,
+                 std::to_string(new_allocations) + " heap allocations in the loop since the last report");
+  }
+  else
+  {
+    stat.summary(diagnostic_msgs::DiagnosticStatus::OK, "No heap allocations in the loop since the last report");
+  }
+}
+
+//==================================================
+bool RobotHwDriverInterface::dumpState(const cnr_hardware_interface::StatusHw& status)
+{
+  if (!m_state_channel)
+  {
+    return false;
+  }
+  const cnr_hardware_interface::StatusHw previous = m_state_channel->get();
+  m_state_channel->set(status);
+  if (m_flight_recorder && (previous == cnr_hardware_interface::RUNNING)
+      && (m_flight_recorder_dump_on & (1u << static_cast<uint32_t>(status))))
+  {
+    m_flight_recorder->trigger(status);
+  }
+  return true;
+}
+
+void RobotHwDriverInterface::recordCycle(CycleRecord& rec, const uint32_t& flags,
+                                         const cnr_hardware_interface::StatusHw& state)
+{
+  if (m_flight_recorder)
+  {
+    rec.flags |= flags;
+    rec.state = state;
+    m_flight_recorder->push(rec);
+  }
+}
+
+bool RobotHwDriverInterface::waitForState(const std::vector<cnr_hardware_interface::StatusHw>& targets,
+                                          const ros::Duration& watchdog,
+                                          cnr_hardware_interface::StatusHw* reached) const
+{
+  return m_state_channel ? m_state_channel->waitFor(targets, watchdog, reached) : false;
 }
 //==================================================
 
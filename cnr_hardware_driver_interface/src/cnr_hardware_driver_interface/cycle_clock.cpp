@@ -0,0 +1,302 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cmath>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include <cnr_hardware_driver_interface/cycle_clock.h>
+#include <cnr_hardware_driver_interface/internal/time_utils.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+namespace
+{
+inline void sleep_until(const struct timespec& deadline)
+{
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+  {
+  }
+}
+}  // namespace
+
+//==================================================
+CycleClock::CycleClock(const int64_t& period_ns)
+  : m_period_ns(period_ns)
+{
+  m_t0 = m_deadline = from_nsec(0);
+  resetStats();
+}
+
+bool CycleClock::start(std::string& error)
+{
+  if (m_period_ns <= 0)
+  {
+    error = "The period of the cycle clock must be positive (" + std::to_string(m_period_ns) + "ns)";
+    return false;
+  }
+  m_t0 = from_nsec(now());
+  m_deadline = m_t0;
+  resetStats();
+  return true;
+}
+
+uint64_t CycleClock::wait()
+{
+  int64_t deadline = to_nsec(m_deadline) + m_period_ns;
+  m_deadline = from_nsec(deadline);
+
+  uint64_t expirations = doWait(m_deadline);
+  if (expirations > 1)
+  {
+    // the source swallowed some periods: the actual deadline is the last expiration
+    deadline += static_cast<int64_t>(expirations - 1) * m_period_ns;
+    m_deadline = from_nsec(deadline);
+  }
+
+  const int64_t now = this->now();
+  const int64_t latency = now - deadline;
+  uint64_t missed = expirations > 1 ? expirations - 1 : 0;
+  if (latency >= m_period_ns)
+  {
+    // deadlines already elapsed at wake-up; the ones counted in a previous cycle are not counted again
+    const int64_t last_elapsed = deadline + (latency / m_period_ns) * m_period_ns;
+    const int64_t from = std::max(m_accounted, deadline);
+    if (last_elapsed > from)
+    {
+      missed += static_cast<uint64_t>((last_elapsed - from) / m_period_ns);
+      m_accounted = last_elapsed;
+    }
+    if (realign())
+    {
+      m_deadline = from_nsec(now);
+      m_accounted = now;
+    }
+    else if ((m_max_burst >= 0) && (latency / m_period_ns > m_max_burst))
+    {
+      // skip the older deadlines: the next 'max_burst' cycles start back-to-back, then the loop is on time
+      m_deadline = from_nsec(deadline + (latency / m_period_ns - m_max_burst) * m_period_ns);
+    }
+  }
+
+  m_cycles++;
+  const double delta = static_cast<double>(latency) - m_mean;
+  m_mean += delta / static_cast<double>(m_cycles);
+  m_m2   += delta * (static_cast<double>(latency) - m_mean);
+
+  m_stat_cycles.store(m_cycles, std::memory_order_relaxed);
+  m_stat_missed.store(m_stat_missed.load(std::memory_order_relaxed) + missed, std::memory_order_relaxed);
+  m_stat_last  .store(latency, std::memory_order_relaxed);
+  if (latency > m_stat_max.load(std::memory_order_relaxed))
+  {
+    m_stat_max.store(latency, std::memory_order_relaxed);
+  }
+  m_stat_mean  .store(m_mean, std::memory_order_relaxed);
+  m_stat_var   .store(m_cycles > 1 ? m_m2 / static_cast<double>(m_cycles - 1) : 0.0, std::memory_order_relaxed);
+  m_stat_drift .store(now - (to_nsec(m_t0) + static_cast<int64_t>(m_cycles) * m_period_ns), std::memory_order_relaxed);
+  return missed;
+}
+
+int64_t CycleClock::now() const
+{
+  return now_nsec();
+}
+
+CycleClockStats CycleClock::stats() const
+{
+  CycleClockStats ret;
+  ret.cycles         = m_stat_cycles.load(std::memory_order_relaxed);
+  ret.missed_wakeups = m_stat_missed.load(std::memory_order_relaxed);
+  ret.last_latency   = m_stat_last  .load(std::memory_order_relaxed);
+  ret.max_latency    = m_stat_max   .load(std::memory_order_relaxed);
+  ret.mean_latency   = m_stat_mean  .load(std::memory_order_relaxed);
+  ret.stddev_latency = std::sqrt(m_stat_var.load(std::memory_order_relaxed));
+  ret.drift          = m_stat_drift .load(std::memory_order_relaxed);
+  return ret;
+}
+
+void CycleClock::resetStats()
+{
+  m_accounted = to_nsec(m_deadline);
+  m_cycles = 0;
+  m_mean   = 0.0;
+  m_m2     = 0.0;
+  m_stat_cycles = 0;
+  m_stat_missed = 0;
+  m_stat_last   = 0;
+  m_stat_max    = 0;
+  m_stat_mean   = 0.0;
+  m_stat_var    = 0.0;
+  m_stat_drift  = 0;
+}
+
+std::string CycleClock::to_string(const CycleClock::Type& type)
+{
+  switch (type)
+  {
+    case CLOCK_NANOSLEEP: return "clock_nanosleep";
+    case TIMERFD:         return "timerfd";
+    case HYBRID:          return "hybrid";
+    case WALLRATE:        return "wallrate";
+  }
+  return "unknown";
+}
+
+bool CycleClock::from_string(const std::string& str, CycleClock::Type& type)
+{
+  for (const Type& t : {CLOCK_NANOSLEEP, TIMERFD, HYBRID, WALLRATE})
+  {
+    if (str == to_string(t))
+    {
+      type = t;
+      return true;
+    }
+  }
+  return false;
+}
+
+CycleClock::Ptr CycleClock::create(const CycleClock::Type& type, const int64_t& period_ns,
+                                   const int64_t& spin_threshold_ns)
+{
+  switch (type)
+  {
+    case CLOCK_NANOSLEEP: return Ptr(new ClockNanosleepCycleClock(period_ns));
+    case TIMERFD:         return Ptr(new TimerFdCycleClock(period_ns));
+    case HYBRID:          return Ptr(new HybridCycleClock(period_ns, spin_threshold_ns));
+    case WALLRATE:        return Ptr(new WallRateCycleClock(period_ns));
+  }
+  return nullptr;
+}
+//==================================================
+
+
+//==================================================
+uint64_t ClockNanosleepCycleClock::doWait(const struct timespec& deadline)
+{
+  sleep_until(deadline);
+  return 1;
+}
+//==================================================
+
+
+//==================================================
+TimerFdCycleClock::~TimerFdCycleClock()
+{
+  if (m_fd >= 0)
+  {
+    close(m_fd);
+  }
+}
+
+bool TimerFdCycleClock::start(std::string& error)
+{
+  if (!CycleClock::start(error))
+  {
+    return false;
+  }
+  if (m_fd < 0)
+  {
+    m_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (m_fd < 0)
+    {
+      error = "timerfd_create failed: " + std::string(std::strerror(errno));
+      return false;
+    }
+  }
+  struct itimerspec itval;
+  itval.it_interval = from_nsec(m_period_ns);
+  itval.it_value    = from_nsec(to_nsec(m_t0) + m_period_ns);
+  if (timerfd_settime(m_fd, TFD_TIMER_ABSTIME, &itval, nullptr) < 0)
+  {
+    error = "timerfd_settime failed: " + std::string(std::strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+uint64_t TimerFdCycleClock::doWait(const struct timespec& /*deadline*/)
+{
+  uint64_t expirations = 0;
+  ssize_t ret;
+  do
+  {
+    ret = read(m_fd, &expirations, sizeof(expirations));
+  }
+  while (ret < 0 && errno == EINTR);
+  return ret == sizeof(expirations) ? expirations : 0;
+}
+//==================================================
+
+
+//==================================================
+HybridCycleClock::HybridCycleClock(const int64_t& period_ns, const int64_t& spin_threshold_ns)
+  : CycleClock(period_ns), m_spin_threshold_ns(std::max(int64_t(0), std::min(spin_threshold_ns, period_ns)))
+{
+}
+
+uint64_t HybridCycleClock::doWait(const struct timespec& deadline)
+{
+  const int64_t target = to_nsec(deadline);
+  if (target - now_nsec() > m_spin_threshold_ns)
+  {
+    sleep_until(from_nsec(target - m_spin_threshold_ns));
+  }
+  while (now_nsec() < target)
+  {
+  }
+  return 1;
+}
+//==================================================
+
+
+//==================================================
+uint64_t WallRateCycleClock::doWait(const struct timespec& deadline)
+{
+  const int64_t rest = to_nsec(deadline) - now_nsec();
+  if (rest > 0)
+  {
+    struct timespec ts = from_nsec(rest);
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+    {
+    }
+  }
+  return 1;
+}
+//==================================================
+
+}  // namespace cnr_hardware_driver_interface
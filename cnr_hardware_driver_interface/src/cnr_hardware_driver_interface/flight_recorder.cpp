@@ -0,0 +1,316 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ctime>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#include <cnr_hardware_driver_interface/flight_recorder.h>
+#include <cnr_hardware_driver_interface/internal/time_utils.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+namespace
+{
+const char FLIGHT_RECORDER_MAGIC[8] = {'C', 'N', 'R', 'F', 'L', 'R', 'E', 'C'};
+
+template<typename T>
+void write_pod(std::ofstream& out, const T& value)
+{
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool read_pod(std::ifstream& in, T& value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+}  // namespace
+
+FlightRecorder::FlightRecorder()
+  : m_capacity(0), m_slots(0), m_period_ns(0), m_head(0), m_pending(false), m_trigger_state(0), m_stop_dump(true)
+{
+  sem_init(&m_sem, 0, 0);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+  shutdown();
+  sem_destroy(&m_sem);
+}
+
+bool FlightRecorder::init(const std::string& hw_name,
+                          const cnr_logger::TraceLoggerPtr& logger,
+                          const size_t& capacity,
+                          const int64_t& period_ns,
+                          const std::string& directory,
+                          const std::vector<std::string>& joint_names,
+                          const std::vector<const double*>& position,
+                          const std::vector<const double*>& velocity,
+                          const std::vector<const double*>& effort,
+                          std::string& error)
+{
+  if ((position.size() != joint_names.size()) || (velocity.size() != joint_names.size())
+      || (effort.size() != joint_names.size()))
+  {
+    error = "The joint snapshot of the flight recorder has inconsistent dimensions";
+    return false;
+  }
+  for (const std::vector<const double*>& v : {position, velocity, effort})
+  {
+    if (std::find(v.begin(), v.end(), nullptr) != v.end())
+    {
+      error = "The joint snapshot of the flight recorder has null sources";
+      return false;
+    }
+  }
+
+  m_hw_name     = hw_name;
+  m_logger      = logger;
+  m_capacity    = capacity;
+  m_period_ns   = period_ns;
+  m_directory   = directory;
+  m_joint_names = joint_names;
+  m_sources.clear();
+  m_sources.insert(m_sources.end(), position.begin(), position.end());
+  m_sources.insert(m_sources.end(), velocity.begin(), velocity.end());
+  m_sources.insert(m_sources.end(), effort.begin(), effort.end());
+
+  // the ring is allocated and touched here, so that push() does not page-fault.
+  // One slot more than the capacity: the slot written by push() is never one of the 'capacity' cycles read by dump()
+  m_slots = m_capacity > 0 ? m_capacity + 1 : 0;
+  m_records.assign(m_slots, CycleRecord());
+  m_joints.assign(m_slots * m_sources.size(), 0.0);
+  m_head = 0;
+
+  if (m_capacity > 0)
+  {
+    m_stop_dump = false;
+    m_dump_thread = std::thread(&FlightRecorder::dumpThread, this);
+  }
+  return true;
+}
+
+void FlightRecorder::shutdown()
+{
+  m_stop_dump = true;
+  sem_post(&m_sem);
+  if (m_dump_thread.joinable())
+  {
+    m_dump_thread.join();
+  }
+}
+
+void FlightRecorder::push(const CycleRecord& record)
+{
+  if (m_capacity == 0)
+  {
+    return;
+  }
+  const uint64_t head = m_head.load(std::memory_order_relaxed);
+  const size_t slot = head % m_slots;
+  m_records[slot] = record;
+  double* joints = m_joints.data() + slot * m_sources.size();
+  for (size_t i = 0; i < m_sources.size(); i++)
+  {
+    joints[i] = *m_sources[i];
+  }
+  m_head.store(head + 1, std::memory_order_release);
+}
+
+void FlightRecorder::trigger(const int32_t& state)
+{
+  if (m_capacity == 0)
+  {
+    return;
+  }
+  m_trigger_state.store(state, std::memory_order_relaxed);
+  m_pending.store(true, std::memory_order_release);
+  sem_post(&m_sem);
+}
+
+bool FlightRecorder::dump(const std::string& path, const int32_t& trigger_state, std::string& error) const
+{
+  const size_t n_values = m_sources.size();
+  if (m_capacity == 0)
+  {
+    error = "The flight recorder is disabled";
+    return false;
+  }
+
+  // copy the ring, then discard the cycles that have been overwritten during the copy
+  const uint64_t head = m_head.load(std::memory_order_acquire);
+  const uint64_t first = head > m_capacity ? head - m_capacity : 0;
+  std::vector<CycleRecord> records;
+  std::vector<double> joints;
+  records.reserve(head - first);
+  joints.reserve((head - first) * n_values);
+  for (uint64_t i = first; i < head; i++)
+  {
+    const size_t slot = i % m_slots;
+    records.push_back(m_records[slot]);
+    joints.insert(joints.end(), m_joints.begin() + slot * n_values, m_joints.begin() + (slot + 1) * n_values);
+  }
+  const uint64_t head_after = m_head.load(std::memory_order_acquire);
+  const uint64_t overwritten = std::min<uint64_t>(head_after > first + m_capacity ? head_after - first - m_capacity : 0,
+                                                  records.size());
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    error = "Error in opening '" + path + "': " + std::strerror(errno);
+    return false;
+  }
+  FlightRecorderHeader header;
+  std::memcpy(header.magic, FLIGHT_RECORDER_MAGIC, sizeof(header.magic));
+  header.version       = VERSION;
+  header.record_size   = sizeof(CycleRecord);
+  header.n_joints      = static_cast<uint32_t>(m_joint_names.size());
+  header.n_records     = static_cast<uint32_t>(records.size() - overwritten);
+  header.period        = m_period_ns;
+  header.trigger_state = trigger_state;
+  header.hw_name_size  = static_cast<uint32_t>(m_hw_name.size());
+  write_pod(out, header);
+  out.write(m_hw_name.data(), m_hw_name.size());
+  for (const std::string& name : m_joint_names)
+  {
+    write_pod(out, static_cast<uint32_t>(name.size()));
+    out.write(name.data(), name.size());
+  }
+  for (size_t i = overwritten; i < records.size(); i++)
+  {
+    write_pod(out, records[i]);
+    out.write(reinterpret_cast<const char*>(joints.data() + i * n_values), n_values * sizeof(double));
+  }
+  if (!out)
+  {
+    error = "Error in writing '" + path + "'";
+    return false;
+  }
+  return true;
+}
+
+std::string FlightRecorder::lastDump() const
+{
+  std::lock_guard<std::mutex> lock(m_mtx);
+  return m_last_dump;
+}
+
+bool FlightRecorder::load(const std::string& path,
+                          FlightRecorderHeader& header,
+                          std::string& hw_name,
+                          std::vector<std::string>& joint_names,
+                          std::vector<CycleRecord>& records,
+                          std::vector<double>& joints,
+                          std::string& error)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    error = "Error in opening '" + path + "'";
+    return false;
+  }
+  if (!read_pod(in, header) || std::memcmp(header.magic, FLIGHT_RECORDER_MAGIC, sizeof(header.magic)) != 0)
+  {
+    error = "'" + path + "' is not a flight recorder file";
+    return false;
+  }
+  if ((header.version != VERSION) || (header.record_size != sizeof(CycleRecord)))
+  {
+    error = "'" + path + "' has version " + std::to_string(header.version) + ", while the supported one is "
+          + std::to_string(VERSION);
+    return false;
+  }
+  hw_name.resize(header.hw_name_size);
+  in.read(&hw_name[0], header.hw_name_size);
+  joint_names.resize(header.n_joints);
+  for (std::string& name : joint_names)
+  {
+    uint32_t size = 0;
+    read_pod(in, size);
+    name.resize(size);
+    in.read(&name[0], size);
+  }
+  const size_t n_values = 3 * header.n_joints;
+  records.resize(header.n_records);
+  joints.resize(header.n_records * n_values);
+  for (size_t i = 0; i < header.n_records; i++)
+  {
+    read_pod(in, records[i]);
+    in.read(reinterpret_cast<char*>(joints.data() + i * n_values), n_values * sizeof(double));
+  }
+  if (!in)
+  {
+    error = "'" + path + "' is truncated";
+    return false;
+  }
+  return true;
+}
+
+void FlightRecorder::dumpThread()
+{
+  while (!m_stop_dump)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts = from_nsec(to_nsec(ts) + 100000000LL);
+    sem_timedwait(&m_sem, &ts);
+    if (!m_pending.exchange(false, std::memory_order_acq_rel))
+    {
+      continue;
+    }
+
+    char stamp[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+    const std::string path = m_directory + "/" + m_hw_name + "_" + stamp + ".flight";
+
+    std::string error;
+    if (dump(path, m_trigger_state.load(std::memory_order_relaxed), error))
+    {
+      CNR_WARN(m_logger, "Flight recorder: the last " << std::min<uint64_t>(recorded(), m_capacity)
+                           << " cycles have been dumped in '" << path << "'");
+      std::lock_guard<std::mutex> lock(m_mtx);
+      m_last_dump = path;
+    }
+    else
+    {
+      CNR_ERROR(m_logger, "Flight recorder: " << error);
+    }
+  }
+}
+
+}  // namespace cnr_hardware_driver_interface
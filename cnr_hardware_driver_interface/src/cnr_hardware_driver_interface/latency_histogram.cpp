@@ -0,0 +1,117 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <cnr_hardware_driver_interface/latency_histogram.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+LatencyHistogram::LatencyHistogram(const int64_t& overrun_threshold_ns)
+  : m_overrun_threshold(overrun_threshold_ns)
+{
+  for (auto& c : m_counts)
+  {
+    c.store(0, std::memory_order_relaxed);
+  }
+  m_count   .store(0, std::memory_order_relaxed);
+  m_sum     .store(0, std::memory_order_relaxed);
+  m_overruns.store(0, std::memory_order_relaxed);
+  m_max     .store(0, std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::bucketUpperBound(const size_t& idx)
+{
+  if (idx < SUB_BUCKETS)
+  {
+    return static_cast<int64_t>(idx);
+  }
+  const size_t   group = idx / SUB_BUCKETS;
+  const uint64_t sub   = idx % SUB_BUCKETS;
+  const uint64_t lower = (SUB_BUCKETS + sub) << (group - 1);
+  return static_cast<int64_t>(lower + (uint64_t(1) << (group - 1)) - 1);
+}
+
+LatencySummary LatencyHistogram::summary() const
+{
+  LatencySummary ret;
+  std::array<uint64_t, BUCKETS> counts;
+  uint64_t total = 0;
+  for (size_t i = 0; i < BUCKETS; i++)
+  {
+    counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  ret.count    = total;
+  ret.overruns = m_overruns.load(std::memory_order_relaxed);
+  ret.max      = m_max.load(std::memory_order_relaxed);
+  const uint64_t n = m_count.load(std::memory_order_relaxed);
+  ret.mean     = n > 0 ? static_cast<double>(m_sum.load(std::memory_order_relaxed)) / static_cast<double>(n) : 0.0;
+  if (total == 0)
+  {
+    return ret;
+  }
+
+  const double   quantiles[3] = {0.5, 0.99, 0.999};
+  int64_t*       values[3]    = {&ret.p50, &ret.p99, &ret.p999};
+  size_t         q            = 0;
+  uint64_t       cumulative   = 0;
+  for (size_t i = 0; i < BUCKETS && q < 3; i++)
+  {
+    cumulative += counts[i];
+    while (q < 3 && static_cast<double>(cumulative) >= quantiles[q] * static_cast<double>(total))
+    {
+      *values[q] = std::min(bucketUpperBound(i), ret.max);
+      q++;
+    }
+  }
+  return ret;
+}
+
+std::string to_string(const LatencySummary& summary)
+{
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1)
+     << "p50: "    << 1e-3 * summary.p50
+     << " p99: "   << 1e-3 * summary.p99
+     << " p99.9: " << 1e-3 * summary.p999
+     << " max: "   << 1e-3 * summary.max << " [us]"
+     << " overruns: " << summary.overruns << "/" << summary.count;
+  return ss.str();
+}
+
+}  // namespace cnr_hardware_driver_interface
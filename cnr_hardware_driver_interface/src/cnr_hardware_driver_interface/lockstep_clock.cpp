@@ -0,0 +1,149 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <thread>
+#include <cerrno>
+
+#include <rosparam_utilities/rosparam_utilities.h>
+#include <cnr_hardware_driver_interface/lockstep_clock.h>
+#include <cnr_hardware_driver_interface/internal/time_utils.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+bool load_lockstep_config(const std::string& hw_namespace, LockstepConfig& config, std::string& error)
+{
+  const std::string ns = hw_namespace + "/lockstep";
+  std::string what;
+
+  bool enabled = false;
+  if (!rosparam_utilities::get(ns + "/enabled", enabled, what, &enabled))
+  {
+    enabled = false;
+  }
+  config.enabled = enabled;
+
+  double real_time_factor = 0.0;
+  if (!rosparam_utilities::get(ns + "/real_time_factor", real_time_factor, what, &real_time_factor))
+  {
+    real_time_factor = 0.0;
+  }
+  if (real_time_factor < 0.0)
+  {
+    error = "The param '" + ns + "/real_time_factor' must be non-negative (0: as fast as possible)";
+    return false;
+  }
+  config.real_time_factor = real_time_factor;
+
+  bool publish_clock = true;
+  if (!rosparam_utilities::get(ns + "/publish_clock", publish_clock, what, &publish_clock))
+  {
+    publish_clock = true;
+  }
+  config.publish_clock = publish_clock;
+  return true;
+}
+
+bool LockstepClock::start(const int64_t& period, const LockstepConfig& config, std::string& error)
+{
+  if (period <= 0)
+  {
+    error = "The period of the lockstep clock must be positive (" + std::to_string(period) + "ns)";
+    return false;
+  }
+  m_period = period;
+  m_config = config;
+  m_follow_clock_topic = ros::Time::isSimTime();
+  if (m_follow_clock_topic && !m_config.publish_clock)
+  {
+    error = "The process follows '/clock' ('/use_sim_time' is true), so the lockstep clock must publish it";
+    return false;
+  }
+
+  ros::Time t0 = ros::Time::now();
+  m_t0_sim  = t0.isZero() ? static_cast<int64_t>(ros::WallTime::now().toNSec()) : static_cast<int64_t>(t0.toNSec());
+  m_t0_wall = now_nsec();
+  m_ticks = 0;
+  m_wall_elapsed = 0;
+  if (m_config.publish_clock && !m_clock_pub)
+  {
+    ros::NodeHandle nh;
+    m_clock_pub = nh.advertise<rosgraph_msgs::Clock>("/clock", 1);
+  }
+  return true;
+}
+
+bool LockstepClock::tick(ros::Time& time)
+{
+  const uint64_t n = m_ticks.load(std::memory_order_relaxed) + 1;
+  const int64_t elapsed = static_cast<int64_t>(n) * m_period;
+  if (m_config.real_time_factor > 0.0)
+  {
+    const struct timespec ts = from_nsec(m_t0_wall + static_cast<int64_t>(elapsed / m_config.real_time_factor));
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+    {
+    }
+  }
+
+  time.fromNSec(m_t0_sim + elapsed);
+  if (m_config.publish_clock)
+  {
+    m_clock_msg.clock = time;
+    m_clock_pub.publish(m_clock_msg);
+  }
+  if (m_follow_clock_topic)
+  {
+    const int64_t timeout = now_nsec() + NSEC_PER_SEC;
+    while (ros::Time::now() < time)
+    {
+      if (now_nsec() > timeout)
+      {
+        return false;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  m_ticks.store(n, std::memory_order_relaxed);
+  m_wall_elapsed.store(now_nsec() - m_t0_wall, std::memory_order_relaxed);
+  return true;
+}
+
+double LockstepClock::realTimeFactor() const
+{
+  const int64_t wall = m_wall_elapsed.load(std::memory_order_relaxed);
+  return wall > 0 ? static_cast<double>(ticks()) * static_cast<double>(m_period) / static_cast<double>(wall) : 0.0;
+}
+
+}  // namespace cnr_hardware_driver_interface
@@ -0,0 +1,168 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cerrno>
+#include <algorithm>
+#include <system_error>
+
+#include <rosparam_utilities/rosparam_utilities.h>
+#include <cnr_hardware_driver_interface/loop_watchdog.h>
+#include <cnr_hardware_driver_interface/internal/time_utils.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+bool load_loop_watchdog_config(const std::string& hw_namespace, LoopWatchdogConfig& config, std::string& error)
+{
+  const std::string ns = hw_namespace + "/watchdog";
+  std::string what;
+
+  int missed_periods = 0;
+  if (!rosparam_utilities::get(ns + "/missed_periods", missed_periods, what, &missed_periods))
+  {
+    missed_periods = 0;
+  }
+  if (missed_periods < 0)
+  {
+    error = "The param '" + ns + "/missed_periods' must be non-negative";
+    return false;
+  }
+  config.missed_periods = static_cast<uint32_t>(missed_periods);
+
+  std::string service;
+  if (!rosparam_utilities::get(ns + "/safe_action_service", service, what, &service))
+  {
+    service.clear();
+  }
+  config.safe_action_service = service;
+  return true;
+}
+
+LoopWatchdog::~LoopWatchdog()
+{
+  stop();
+}
+
+bool LoopWatchdog::start(const int64_t& period, const uint32_t& missed_periods, const ThreadRtConfig& rt_config,
+                         const Handler& on_stall, const Handler& on_resume, std::string& error)
+{
+  if (m_thread.joinable())
+  {
+    error = "The watchdog is already running";
+    return false;
+  }
+  if ((period <= 0) || (missed_periods == 0))
+  {
+    error = "The watchdog needs a positive period and a positive number of missed periods";
+    return false;
+  }
+  m_period         = period;
+  m_missed_periods = missed_periods;
+  m_on_stall       = on_stall;
+  m_on_resume      = on_resume;
+  m_stalled        = false;
+  m_stop           = false;
+  try
+  {
+    m_thread = std::thread(&LoopWatchdog::watchdogThread, this, rt_config);
+  }
+  catch (std::system_error& e)
+  {
+    m_stop = true;
+    error = "Failed in spawning the watchdog thread: " + std::string(e.what());
+    return false;
+  }
+  return true;
+}
+
+void LoopWatchdog::stop()
+{
+  m_stop = true;
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+}
+
+void LoopWatchdog::watchdogThread(const ThreadRtConfig& rt_config)
+{
+  std::string error;
+  apply_to_this_thread(rt_config, error);
+
+  const int64_t check   = m_period * std::max<int64_t>(1, m_missed_periods / 4);
+  const int64_t timeout = m_period * m_missed_periods;
+
+  uint64_t last_beat = m_heartbeat.load(std::memory_order_acquire);
+  int64_t  last_seen = now_nsec();
+  int64_t  next      = last_seen;
+  while (!m_stop)
+  {
+    next += check;
+    const struct timespec ts = from_nsec(next);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+    {
+    }
+
+    const int64_t  now  = now_nsec();
+    const uint64_t beat = m_heartbeat.load(std::memory_order_acquire);
+    if (next + check < now)
+    {
+      next = now;  // the watchdog has been late itself (e.g., blocked in a handler): no bursts
+    }
+    if (beat != last_beat)
+    {
+      const int64_t silence = now - last_seen;
+      last_beat = beat;
+      last_seen = now;
+      if (m_stalled.exchange(false) && m_on_resume)
+      {
+        m_on_resume(silence);
+      }
+      continue;
+    }
+
+    const int64_t silence = now - last_seen;
+    m_max_silence.store(std::max(m_max_silence.load(std::memory_order_relaxed), silence), std::memory_order_relaxed);
+    if ((silence >= timeout) && !m_stalled.exchange(true))
+    {
+      m_stalls.fetch_add(1, std::memory_order_relaxed);
+      if (m_on_stall)
+      {
+        m_on_stall(silence);
+      }
+    }
+  }
+}
+
+}  // namespace cnr_hardware_driver_interface
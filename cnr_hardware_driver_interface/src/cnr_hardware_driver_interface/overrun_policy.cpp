@@ -0,0 +1,207 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ros/ros.h>
+#include <rosparam_utilities/rosparam_utilities.h>
+#include <cnr_hardware_driver_interface/overrun_policy.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+std::string to_string(const OverrunPolicy::Type& type)
+{
+  switch (type)
+  {
+    case OverrunPolicy::CATCH_UP: return "catch_up";
+    case OverrunPolicy::SKIP:     return "skip";
+    case OverrunPolicy::DEGRADE:  return "degrade";
+  }
+  return "unknown";
+}
+
+bool from_string(const std::string& str, OverrunPolicy::Type& type)
+{
+  for (const OverrunPolicy::Type& t : {OverrunPolicy::CATCH_UP, OverrunPolicy::SKIP, OverrunPolicy::DEGRADE})
+  {
+    if (str == to_string(t))
+    {
+      type = t;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string to_string(const OverrunPolicy& policy)
+{
+  std::string ret = to_string(policy.type);
+  if (policy.type == OverrunPolicy::CATCH_UP)
+  {
+    ret += policy.max_burst < 0 ? " (unbounded burst)" : " (burst: " + std::to_string(policy.max_burst) + ")";
+  }
+  else if (policy.type == OverrunPolicy::DEGRADE)
+  {
+    ret += " (after " + std::to_string(policy.degrade_after) + ", recover after "
+         + std::to_string(policy.recover_after) + ")";
+  }
+  if (policy.streak_limit > 0)
+  {
+    ret += ", alarm at " + std::to_string(policy.streak_limit);
+  }
+  return ret;
+}
+
+bool load_overrun_policy(const std::string& hw_namespace, OverrunPolicy& policy, std::string& error)
+{
+  const std::string ns = hw_namespace + "/overrun";
+  std::string what;
+
+  std::string type = "catch_up";
+  if (!rosparam_utilities::get(ns + "/policy", type, what, &type))
+  {
+    type = "catch_up";
+  }
+  if (!from_string(type, policy.type))
+  {
+    error = "The param '" + ns + "/policy' is '" + type + "', while the allowed values are "
+          + "'catch_up', 'skip' and 'degrade'";
+    return false;
+  }
+
+  int max_burst = -1;
+  if (!rosparam_utilities::get(ns + "/max_burst", max_burst, what, &max_burst))
+  {
+    max_burst = -1;
+  }
+  policy.max_burst = max_burst;
+
+  int degrade_after = 3;
+  int recover_after = 100;
+  int streak_limit  = 0;
+  if (!rosparam_utilities::get(ns + "/degrade_after", degrade_after, what, &degrade_after))
+  {
+    degrade_after = 3;
+  }
+  if (!rosparam_utilities::get(ns + "/recover_after", recover_after, what, &recover_after))
+  {
+    recover_after = 100;
+  }
+  if (!rosparam_utilities::get(ns + "/streak_limit", streak_limit, what, &streak_limit))
+  {
+    streak_limit = 0;
+  }
+  if ((degrade_after < 1) || (recover_after < 1) || (streak_limit < 0))
+  {
+    error = "The params '" + ns + "/degrade_after' and '" + ns + "/recover_after' must be positive, and '"
+          + ns + "/streak_limit' must be non-negative";
+    return false;
+  }
+  policy.degrade_after = static_cast<uint32_t>(degrade_after);
+  policy.recover_after = static_cast<uint32_t>(recover_after);
+  policy.streak_limit  = static_cast<uint32_t>(streak_limit);
+  return true;
+}
+
+void OverrunMonitor::init(const OverrunPolicy& policy, cnr::control::HwLoopStatus* status)
+{
+  m_policy = policy;
+  m_status = status;
+  reset();
+}
+
+void OverrunMonitor::reset()
+{
+  m_on_time = 0;
+  m_streak.store(0, std::memory_order_relaxed);
+  m_max_streak.store(0, std::memory_order_relaxed);
+  m_overruns.store(0, std::memory_order_relaxed);
+  m_degradations.store(0, std::memory_order_relaxed);
+  m_degraded.store(false, std::memory_order_relaxed);
+  m_alarm.store(false, std::memory_order_relaxed);
+  if (m_status)
+  {
+    m_status->degraded.store(false, std::memory_order_relaxed);
+    m_status->overrun_streak.store(0, std::memory_order_relaxed);
+  }
+}
+
+bool OverrunMonitor::update(const bool& overrun)
+{
+  bool notify = false;
+  uint32_t streak = m_streak.load(std::memory_order_relaxed);
+  if (overrun)
+  {
+    streak++;
+    m_on_time = 0;
+    m_overruns.store(m_overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (streak > m_max_streak.load(std::memory_order_relaxed))
+    {
+      m_max_streak.store(streak, std::memory_order_relaxed);
+    }
+  }
+  else
+  {
+    streak = 0;
+    m_on_time++;
+  }
+  m_streak.store(streak, std::memory_order_relaxed);
+
+  const bool degraded = m_degraded.load(std::memory_order_relaxed);
+  if ((m_policy.type == OverrunPolicy::DEGRADE) && !degraded && (streak >= m_policy.degrade_after))
+  {
+    m_degraded.store(true, std::memory_order_relaxed);
+    m_degradations.store(m_degradations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    notify = true;
+  }
+  else if (degraded && (m_on_time >= m_policy.recover_after))
+  {
+    m_degraded.store(false, std::memory_order_relaxed);
+    notify = true;
+  }
+
+  if ((m_policy.streak_limit > 0) && (streak >= m_policy.streak_limit) && !m_alarm.load(std::memory_order_relaxed))
+  {
+    m_alarm.store(true, std::memory_order_relaxed);
+    notify = true;
+  }
+
+  if (m_status)
+  {
+    m_status->overrun_streak.store(streak, std::memory_order_relaxed);
+    m_status->degraded.store(m_degraded.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+  return notify;
+}
+
+}  // namespace cnr_hardware_driver_interface
@@ -0,0 +1,385 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sched.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#include <ros/ros.h>
+#include <rosparam_utilities/rosparam_utilities.h>
+#include <cnr_hardware_driver_interface/rt_config.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+namespace
+{
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+//! glibc does not always export it
+struct sched_attr_t
+{
+  uint32_t size;
+  uint32_t sched_policy;
+  uint64_t sched_flags;
+  int32_t  sched_nice;
+  uint32_t sched_priority;
+  uint64_t sched_runtime;
+  uint64_t sched_deadline;
+  uint64_t sched_period;
+};
+
+int policy_id(const ThreadRtConfig::Policy& policy)
+{
+  switch (policy)
+  {
+    case ThreadRtConfig::FIFO:     return SCHED_FIFO;
+    case ThreadRtConfig::RR:       return SCHED_RR;
+    case ThreadRtConfig::DEADLINE: return SCHED_DEADLINE;
+    default:                       return SCHED_OTHER;
+  }
+}
+
+//! the CPUs of the affinity set of the process, that may be narrower than the online ones (cpusets, containers)
+bool allowed_cpus(cpu_set_t& allowed, std::string& error)
+{
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+  {
+    error = "sched_getaffinity failed: " + std::string(strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool get_cpus(const std::string& param, std::vector<int>& cpus, std::string& error)
+{
+  cpus.clear();
+  if (!ros::param::has(param))
+  {
+    return true;
+  }
+  if (!ros::param::get(param, cpus))
+  {
+    error = "The param '" + param + "' is not a list of integers";
+    return false;
+  }
+  cpu_set_t allowed;
+  if (!allowed_cpus(allowed, error))
+  {
+    return false;
+  }
+  for (const int& cpu : cpus)
+  {
+    if ((cpu < 0) || (cpu >= CPU_SETSIZE) || !CPU_ISSET(cpu, &allowed))
+    {
+      error = "The param '" + param + "' has the cpu " + std::to_string(cpu) + ", that is not one of the "
+            + std::to_string(CPU_COUNT(&allowed)) + " cpus of the affinity set of the process";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::string to_string(const ThreadRtConfig::Policy& policy)
+{
+  switch (policy)
+  {
+    case ThreadRtConfig::FIFO:     return "fifo";
+    case ThreadRtConfig::RR:       return "rr";
+    case ThreadRtConfig::DEADLINE: return "deadline";
+    default:                       return "other";
+  }
+}
+
+bool from_string(const std::string& str, ThreadRtConfig::Policy& policy)
+{
+  for (const ThreadRtConfig::Policy& p : {ThreadRtConfig::OTHER, ThreadRtConfig::FIFO,
+                                          ThreadRtConfig::RR, ThreadRtConfig::DEADLINE})
+  {
+    if (str == to_string(p))
+    {
+      policy = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string to_string(const ThreadRtConfig& config)
+{
+  std::stringstream ss;
+  ss << "policy: " << to_string(config.policy);
+  if ((config.policy == ThreadRtConfig::FIFO) || (config.policy == ThreadRtConfig::RR))
+  {
+    ss << ", priority: " << config.priority;
+  }
+  if (config.policy == ThreadRtConfig::DEADLINE)
+  {
+    ss << ", runtime: " << config.runtime << "ns, period: " << config.period << "ns";
+  }
+  ss << ", cpus: [ ";
+  for (const int& cpu : config.cpus)
+  {
+    ss << cpu << " ";
+  }
+  ss << "]";
+  return ss.str();
+}
+
+bool load_rt_config(const std::string& hw_namespace, const int64_t& period_ns, RtConfig& config, std::string& error)
+{
+  const std::string ns = hw_namespace + "/realtime";
+  std::string what;
+
+  std::string policy = PREEMPTIVE_RT ? "rr" : "other";
+  if (!rosparam_utilities::get(ns + "/policy", policy, what, &policy))
+  {
+    policy = PREEMPTIVE_RT ? "rr" : "other";
+  }
+  if (!from_string(policy, config.loop.policy))
+  {
+    error = "The param '" + ns + "/policy' is '" + policy + "', while the allowed values are "
+          + "'other', 'fifo', 'rr' and 'deadline'";
+    return false;
+  }
+
+  if ((config.loop.policy == ThreadRtConfig::FIFO) || (config.loop.policy == ThreadRtConfig::RR))
+  {
+    const int sched = policy_id(config.loop.policy);
+    int priority = sched_get_priority_max(sched) - 2;
+    if (!rosparam_utilities::get(ns + "/priority", priority, what, &priority))
+    {
+      priority = sched_get_priority_max(sched) - 2;
+    }
+    if ((priority < sched_get_priority_min(sched)) || (priority > sched_get_priority_max(sched)))
+    {
+      error = "The param '" + ns + "/priority' is " + std::to_string(priority) + ", out of the range ["
+            + std::to_string(sched_get_priority_min(sched)) + ", " + std::to_string(sched_get_priority_max(sched)) + "]";
+      return false;
+    }
+    config.loop.priority = priority;
+  }
+
+  if (config.loop.policy == ThreadRtConfig::DEADLINE)
+  {
+    double runtime = 0.5e-9 * period_ns;
+    if (!rosparam_utilities::get(ns + "/deadline_runtime", runtime, what, &runtime))
+    {
+      runtime = 0.5e-9 * period_ns;
+    }
+    config.loop.runtime = static_cast<int64_t>(runtime * 1e9);
+    config.loop.period  = period_ns;
+    if ((config.loop.runtime <= 0) || (config.loop.runtime > period_ns))
+    {
+      error = "The param '" + ns + "/deadline_runtime' must be in (0, sampling_period]";
+      return false;
+    }
+  }
+
+  if (!get_cpus(ns + "/cpu_affinity", config.loop.cpus, error)
+   || !get_cpus(ns + "/non_rt_cpu_affinity", config.non_rt.cpus, error))
+  {
+    return false;
+  }
+  config.io = config.loop;
+  if (ros::param::has(ns + "/io_cpu_affinity") && !get_cpus(ns + "/io_cpu_affinity", config.io.cpus, error))
+  {
+    return false;
+  }
+  config.worker = config.loop;
+  if (ros::param::has(ns + "/worker_cpu_affinity") && !get_cpus(ns + "/worker_cpu_affinity", config.worker.cpus, error))
+  {
+    return false;
+  }
+  if ((config.loop.policy == ThreadRtConfig::DEADLINE)
+   && (!config.loop.cpus.empty() || !config.io.cpus.empty() || !config.worker.cpus.empty()))
+  {
+    error = "SCHED_DEADLINE threads cannot have a CPU affinity narrower than their root domain: "
+            "remove '" + ns + "/cpu_affinity' (and '" + ns + "/io_cpu_affinity', '" + ns + "/worker_cpu_affinity') "
+            "and isolate the cores with cpusets";
+    return false;
+  }
+  if (!config.loop.cpus.empty() && !ros::param::has(ns + "/non_rt_cpu_affinity"))
+  {
+    cpu_set_t allowed;
+    if (!allowed_cpus(allowed, error))
+    {
+      return false;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+      if (CPU_ISSET(cpu, &allowed)
+       && (std::find(config.loop.cpus.begin(), config.loop.cpus.end(), cpu) == config.loop.cpus.end())
+       && (std::find(config.io.cpus.begin(), config.io.cpus.end(), cpu) == config.io.cpus.end())
+       && (std::find(config.worker.cpus.begin(), config.worker.cpus.end(), cpu) == config.worker.cpus.end()))
+      {
+        config.non_rt.cpus.push_back(cpu);
+      }
+    }
+  }
+
+  bool lock_memory = PREEMPTIVE_RT;
+  if (!rosparam_utilities::get(ns + "/lock_memory", lock_memory, what, &lock_memory))
+  {
+    lock_memory = PREEMPTIVE_RT;
+  }
+  config.lock_memory = lock_memory;
+
+  double prefault_heap = 0.0;
+  if (!rosparam_utilities::get(ns + "/prefault_heap_mb", prefault_heap, what, &prefault_heap))
+  {
+    prefault_heap = 0.0;
+  }
+  double prefault_stack = PREEMPTIVE_RT ? 1024.0 : 0.0;
+  if (!rosparam_utilities::get(ns + "/prefault_stack_kb", prefault_stack, what, &prefault_stack))
+  {
+    prefault_stack = PREEMPTIVE_RT ? 1024.0 : 0.0;
+  }
+  if ((prefault_heap < 0) || (prefault_stack < 0))
+  {
+    error = "The params '" + ns + "/prefault_heap_mb' and '" + ns + "/prefault_stack_kb' must be non-negative";
+    return false;
+  }
+  config.prefault_heap  = static_cast<size_t>(prefault_heap * 1024 * 1024);
+  config.prefault_stack = static_cast<size_t>(prefault_stack * 1024);
+  return true;
+}
+
+bool apply_to_this_thread(const ThreadRtConfig& config, std::string& error)
+{
+  if (!config.cpus.empty())
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const int& cpu : config.cpus)
+    {
+      CPU_SET(cpu, &set);
+    }
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0)
+    {
+      error = "pthread_setaffinity_np failed: " + std::string(std::strerror(ret));
+      return false;
+    }
+  }
+
+  if (config.policy == ThreadRtConfig::DEADLINE)
+  {
+    sched_attr_t attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.sched_policy   = SCHED_DEADLINE;
+    attr.sched_runtime  = static_cast<uint64_t>(config.runtime);
+    attr.sched_deadline = static_cast<uint64_t>(config.period);
+    attr.sched_period   = static_cast<uint64_t>(config.period);
+    if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0)
+    {
+      error = "sched_setattr(SCHED_DEADLINE) failed: " + std::string(std::strerror(errno));
+      return false;
+    }
+  }
+  else if (config.policy != ThreadRtConfig::OTHER)
+  {
+    struct sched_param param;
+    param.sched_priority = config.priority;
+    int ret = pthread_setschedparam(pthread_self(), policy_id(config.policy), &param);
+    if (ret != 0)
+    {
+      error = "pthread_setschedparam(" + to_string(config.policy) + ", " + std::to_string(config.priority)
+            + ") failed: " + std::string(std::strerror(ret));
+      return false;
+    }
+  }
+  return true;
+}
+
+bool prepare_memory(const RtConfig& config, std::string& error)
+{
+  if (config.lock_memory && (mlockall(MCL_CURRENT | MCL_FUTURE) != 0))
+  {
+    error = "mlockall failed: " + std::string(std::strerror(errno));
+    return false;
+  }
+
+  if (config.prefault_heap > 0)
+  {
+    // the freed memory must stay in the arena: no trimming, no mmap for the big chunks
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    char* buffer = static_cast<char*>(malloc(config.prefault_heap));
+    if (!buffer)
+    {
+      error = "Prefaulting the heap failed: cannot allocate " + std::to_string(config.prefault_heap) + " bytes";
+      return false;
+    }
+    const long page = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < config.prefault_heap; i += page)
+    {
+      buffer[i] = 0;
+    }
+    free(buffer);
+  }
+  return true;
+}
+
+void prefault_stack(const size_t& size)
+{
+  if (size == 0)
+  {
+    return;
+  }
+  volatile char* buffer = static_cast<volatile char*>(alloca(size));
+  const long page = sysconf(_SC_PAGESIZE);
+  for (size_t i = 0; i < size; i += page)
+  {
+    buffer[i] = 0;
+  }
+}
+
+}  // namespace cnr_hardware_driver_interface
@@ -0,0 +1,302 @@
+/*
+ *  Software License Agreement (New BSD License)
+ *
+ *  Copyright 2020 National Council of Research of Italy (CNR)
+ *
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder(s) nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <std_msgs/String.h>
+
+#include <cnr_hardware_driver_interface/state_channel.h>
+#include <cnr_hardware_driver_interface/cnr_hardware_driver_interface.h>
+#include <cnr_hardware_driver_interface/internal/time_utils.h>
+
+namespace cnr_hardware_driver_interface
+{
+
+namespace
+{
+std::mutex                                          g_registry_mtx;
+std::condition_variable                             g_registry_cv;
+std::map<std::string, std::weak_ptr<HwStateChannel>> g_registry;
+uint64_t                                            g_epoch = 0;
+
+std::string normalize(const std::string& hw_name)
+{
+  return (!hw_name.empty() && hw_name.front() == '/') ? hw_name.substr(1) : hw_name;
+}
+}  // namespace
+
+HwStateChannel::HwStateChannel()
+  : m_state(cnr_hardware_interface::UNLOADED), m_head(0), m_tail(0), m_dropped(0), m_stop_mirror(true)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+  pthread_mutex_init(&m_producer_mtx, &attr);
+  pthread_mutexattr_destroy(&attr);
+  sem_init(&m_sem, 0, 0);
+}
+
+HwStateChannel::~HwStateChannel()
+{
+  shutdown();
+  sem_destroy(&m_sem);
+  pthread_mutex_destroy(&m_producer_mtx);
+}
+
+bool HwStateChannel::init(const std::string& hw_name, const cnr_logger::TraceLoggerPtr& logger, std::string& error)
+{
+  m_hw_name = normalize(hw_name);
+  m_logger  = logger;
+  {
+    std::lock_guard<std::mutex> lock(g_registry_mtx);
+    auto it = g_registry.find(m_hw_name);
+    if (it != g_registry.end() && !it->second.expired())
+    {
+      error = "A state channel for the hw '" + m_hw_name + "' is already registered in this process";
+      return false;
+    }
+    g_registry[m_hw_name] = weak_from_this();
+  }
+  g_registry_cv.notify_all();
+
+  m_stop_mirror = false;
+  m_mirror_thread = std::thread(&HwStateChannel::mirrorThread, this);
+  return true;
+}
+
+void HwStateChannel::shutdown()
+{
+  {
+    std::lock_guard<std::mutex> lock(g_registry_mtx);
+    auto it = g_registry.find(m_hw_name);
+    if (it != g_registry.end() && (it->second.expired() || it->second.lock().get() == this))
+    {
+      g_registry.erase(it);
+    }
+  }
+  m_stop_mirror = true;
+  sem_post(&m_sem);
+  if (m_mirror_thread.joinable())
+  {
+    m_mirror_thread.join();
+  }
+}
+
+void HwStateChannel::set(const cnr_hardware_interface::StatusHw& status)
+{
+  // the transitions are pushed in the order they are applied: e.g., the ERROR forced by the watchdog is in
+  // the history, and a later set(ERROR) of the loop does not produce a second transition
+  pthread_mutex_lock(&m_producer_mtx);
+  int prev = m_state.load(std::memory_order_relaxed);
+  do
+  {
+    if (prev == static_cast<int>(status))
+    {
+      pthread_mutex_unlock(&m_producer_mtx);
+      return;
+    }
+  }
+  while (!m_state.compare_exchange_weak(prev, static_cast<int>(status),
+                                        std::memory_order_release, std::memory_order_relaxed));
+
+  const uint64_t head = m_head.load(std::memory_order_relaxed);
+  if (head - m_tail.load(std::memory_order_acquire) >= CAPACITY)
+  {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+  else
+  {
+    m_ring[head & (CAPACITY - 1)] = {static_cast<cnr_hardware_interface::StatusHw>(prev), status, now_nsec()};
+    m_head.store(head + 1, std::memory_order_release);
+  }
+  pthread_mutex_unlock(&m_producer_mtx);
+  sem_post(&m_sem);
+}
+
+void HwStateChannel::notify()
+{
+  sem_post(&m_sem);
+}
+
+template<class Predicate>
+bool HwStateChannel::waitUntil(Predicate pred, const ros::Duration& watchdog) const
+{
+  const bool no_timeout = watchdog.toSec() <= 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(no_timeout ? 0 : watchdog.toNSec());
+  std::unique_lock<std::mutex> lock(m_mtx);
+  while (!pred())
+  {
+    if (!ros::ok())
+    {
+      return false;
+    }
+    // slices of 100ms to check ros::ok()
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+    if (!no_timeout)
+    {
+      if (std::chrono::steady_clock::now() >= deadline)
+      {
+        return pred();
+      }
+      until = std::min(until, deadline);
+    }
+    m_cv.wait_until(lock, until);
+  }
+  return true;
+}
+
+bool HwStateChannel::waitFor(const std::vector<cnr_hardware_interface::StatusHw>& targets,
+                             const ros::Duration& watchdog,
+                             cnr_hardware_interface::StatusHw* reached) const
+{
+  cnr_hardware_interface::StatusHw st = get();
+  bool ok = waitUntil([&]()
+  {
+    st = get();
+    return std::find(targets.begin(), targets.end(), st) != targets.end();
+  }, watchdog);
+  if (reached)
+  {
+    *reached = st;
+  }
+  return ok;
+}
+
+bool HwStateChannel::waitForNot(const cnr_hardware_interface::StatusHw& status, const ros::Duration& watchdog) const
+{
+  return waitUntil([&]() { return get() != status; }, watchdog);
+}
+
+void HwStateChannel::mirrorThread()
+{
+  ros::NodeHandle nh;
+  ros::Publisher pub = nh.advertise<std_msgs::String>(state_topic_name(m_hw_name), 1, true);
+  std_msgs::String msg;
+  std::vector<std::string> history;
+  history.reserve(HISTORY);
+
+  bool first = true;
+  while (!m_stop_mirror)
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts = from_nsec(to_nsec(ts) + 100000000LL);
+    int ret = sem_timedwait(&m_sem, &ts);
+    while (ret == 0 && sem_trywait(&m_sem) == 0)
+    {
+      // coalesce the pending posts
+    }
+    if (ret != 0 && !first)
+    {
+      continue;
+    }
+    first = false;
+
+    bool changed = false;
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    while (tail != m_head.load(std::memory_order_acquire))
+    {
+      const HwStateTransition tr = m_ring[tail & (CAPACITY - 1)];
+      m_tail.store(++tail, std::memory_order_release);
+      m_history.push_back(cnr_hardware_interface::to_string(tr.to));
+      if (m_history.size() > HISTORY)
+      {
+        m_history.pop_front();
+      }
+      CNR_DEBUG(m_logger, "RobotHW '" << m_hw_name << "' New Status " << cnr_hardware_interface::to_string(tr.to)
+                            << " (from " << cnr_hardware_interface::to_string(tr.from) << ")");
+      changed = true;
+    }
+
+    const std::string state = cnr_hardware_interface::to_string(get());
+    if (changed || msg.data != state)
+    {
+      history.assign(m_history.begin(), m_history.end());
+      ros::param::set(RobotHwDriverInterface::hw_last_status_param_name(m_hw_name), state);
+      ros::param::set(RobotHwDriverInterface::hw_status_param_name(m_hw_name), history);
+      msg.data = state;
+      pub.publish(msg);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mtx);
+    }
+    m_cv.notify_all();
+    {
+      std::lock_guard<std::mutex> lock(g_registry_mtx);
+      g_epoch++;
+    }
+    g_registry_cv.notify_all();
+  }
+}
+
+HwStateChannel::Ptr HwStateChannel::find(const std::string& hw_name)
+{
+  std::lock_guard<std::mutex> lock(g_registry_mtx);
+  auto it = g_registry.find(normalize(hw_name));
+  return it != g_registry.end() ? it->second.lock() : nullptr;
+}
+
+uint64_t HwStateChannel::epoch()
+{
+  std::lock_guard<std::mutex> lock(g_registry_mtx);
+  return g_epoch;
+}
+
+bool HwStateChannel::waitEpoch(uint64_t& last_epoch, const ros::WallDuration& timeout)
+{
+  std::unique_lock<std::mutex> lock(g_registry_mtx);
+  g_registry_cv.wait_for(lock, std::chrono::nanoseconds(static_cast<int64_t>(timeout.toSec() * 1e9)),
+                         [&]() { return g_epoch != last_epoch; });
+  bool changed = g_epoch != last_epoch;
+  last_epoch = g_epoch;
+  return changed;
+}
+
+HwStateChannel::Ptr HwStateChannel::waitChannel(const std::string& hw_name, const ros::WallDuration& timeout)
+{
+  const std::string name = normalize(hw_name);
+  std::unique_lock<std::mutex> lock(g_registry_mtx);
+  Ptr ret;
+  g_registry_cv.wait_for(lock, std::chrono::nanoseconds(static_cast<int64_t>(timeout.toSec() * 1e9)), [&]()
+  {
+    auto it = g_registry.find(name);
+    ret = it != g_registry.end() ? it->second.lock() : nullptr;
+    return ret != nullptr;
+  });
+  return ret;
+}
+
+}  // namespace cnr_hardware_driver_interface
@@ -34,9 +34,20 @@
  */
 
 #include <iostream>
+#include <thread>
+#include <algorithm>
+#include <sched.h>
 #include <ros/ros.h>
 #include <cnr_logger/cnr_logger.h>
 #include <gtest/gtest.h>
+#include <cnr_hardware_driver_interface/cycle_clock.h>
+#include <cnr_hardware_driver_interface/latency_histogram.h>
+#include <cnr_hardware_driver_interface/state_channel.h>
+#include <cnr_hardware_driver_interface/flight_recorder.h>
+#include <cnr_hardware_driver_interface/rt_config.h>
+#include <cnr_hardware_driver_interface/overrun_policy.h>
+#include <cnr_hardware_driver_interface/loop_watchdog.h>
+#include <cnr_hardware_driver_interface/lockstep_clock.h>
 
 std::shared_ptr<cnr_logger::TraceLogger> logger;
 
@@ -48,6 +59,310 @@ TEST(TestSuite, fullConstructor)
   EXPECT_NO_FATAL_FAILURE(logger.reset());
 }
 
+TEST(TestSuite, cycleClock)
+{
+  using cnr_hardware_driver_interface::CycleClock;
+  for (const CycleClock::Type& type : {CycleClock::CLOCK_NANOSLEEP, CycleClock::TIMERFD,
+                                       CycleClock::HYBRID, CycleClock::WALLRATE})
+  {
+    CycleClock::Type from_str;
+    EXPECT_TRUE(CycleClock::from_string(CycleClock::to_string(type), from_str));
+    EXPECT_EQ(from_str, type);
+
+    CycleClock::Ptr clock = CycleClock::create(type, 1000000, 100000);
+    std::string error;
+    EXPECT_TRUE(clock->start(error));
+    for (size_t i = 0; i < 10; i++)
+    {
+      clock->wait();
+    }
+    EXPECT_EQ(clock->stats().cycles, 10u);
+    EXPECT_GE(clock->stats().max_latency, 0);
+  }
+  CycleClock::Type type;
+  EXPECT_FALSE(CycleClock::from_string("walrate", type));
+}
+TEST(TestSuite, latencyHistogram)
+{
+  using cnr_hardware_driver_interface::LatencyHistogram;
+  for (size_t i = 1; i < LatencyHistogram::BUCKETS; i++)
+  {
+    EXPECT_EQ(LatencyHistogram::index(LatencyHistogram::bucketUpperBound(i)), i);
+  }
+
+  LatencyHistogram histogram(900000);
+  for (int64_t i = 1; i <= 1000; i++)
+  {
+    histogram.record(i * 1000);
+  }
+  cnr_hardware_driver_interface::LatencySummary summary = histogram.summary();
+  EXPECT_EQ(summary.count, 1000u);
+  EXPECT_EQ(summary.overruns, 100u);
+  EXPECT_EQ(summary.max, 1000000);
+  EXPECT_NEAR(summary.p50, 500000, 500000 / LatencyHistogram::SUB_BUCKETS);
+  EXPECT_NEAR(summary.p99, 990000, 990000 / LatencyHistogram::SUB_BUCKETS);
+  EXPECT_LE(summary.p999, summary.max);
+}
+
+TEST(TestSuite, stateChannel)
+{
+  using cnr_hardware_driver_interface::HwStateChannel;
+  std::string error;
+  cnr_logger::TraceLoggerPtr channel_logger(new cnr_logger::TraceLogger("log2", "/file_and_screen_different_appenders"));
+  HwStateChannel::Ptr channel(new HwStateChannel());
+  EXPECT_TRUE(channel->init("test_hw", channel_logger, error));
+  EXPECT_EQ(HwStateChannel::find("test_hw"), channel);
+  EXPECT_EQ(channel->get(), cnr_hardware_interface::UNLOADED);
+
+  uint64_t epoch = HwStateChannel::epoch();
+  std::thread producer([&channel]
+  {
+    ros::WallDuration(0.05).sleep();
+    channel->set(cnr_hardware_interface::INITIALIZED);
+    channel->set(cnr_hardware_interface::RUNNING);
+  });
+  cnr_hardware_interface::StatusHw reached;
+  EXPECT_TRUE(channel->waitFor({cnr_hardware_interface::RUNNING}, ros::Duration(2.0), &reached));
+  EXPECT_EQ(reached, cnr_hardware_interface::RUNNING);
+  producer.join();
+  EXPECT_TRUE(HwStateChannel::waitEpoch(epoch, ros::WallDuration(2.0)));
+  EXPECT_FALSE(channel->waitForNot(cnr_hardware_interface::RUNNING, ros::Duration(0.1)));
+  EXPECT_EQ(channel->transitions(), 2u);
+
+  // the watchdog and the loop both set the ERROR: one transition, recorded once
+  std::thread watchdog([&channel] { channel->set(cnr_hardware_interface::ERROR); });
+  channel->set(cnr_hardware_interface::ERROR);
+  watchdog.join();
+  EXPECT_EQ(channel->get(), cnr_hardware_interface::ERROR);
+  EXPECT_EQ(channel->transitions(), 3u);
+  EXPECT_EQ(channel->dropped(), 0u);
+
+  channel->shutdown();
+  channel.reset();
+  EXPECT_EQ(HwStateChannel::find("test_hw"), nullptr);
+}
+
+TEST(TestSuite, flightRecorder)
+{
+  using cnr_hardware_driver_interface::CycleRecord;
+  using cnr_hardware_driver_interface::FlightRecorder;
+  cnr_logger::TraceLoggerPtr recorder_logger(new cnr_logger::TraceLogger("log3", "/file_and_screen_different_appenders"));
+  double q[2] = {0.0, 0.0}, qd[2] = {1.0, 1.0}, eff[2] = {2.0, 2.0};
+  std::string error;
+  FlightRecorder recorder;
+  EXPECT_TRUE(recorder.init("test_hw", recorder_logger, 10, 1000000, "/tmp", {"j1", "j2"},
+                            {&q[0], &q[1]}, {&qd[0], &qd[1]}, {&eff[0], &eff[1]}, error));
+  for (uint64_t i = 0; i < 25; i++)
+  {
+    CycleRecord rec = CycleRecord();
+    rec.cycle = i;
+    q[0] = static_cast<double>(i);
+    recorder.push(rec);
+  }
+  EXPECT_TRUE(recorder.dump("/tmp/test_hw.flight", cnr_hardware_interface::ERROR, error));
+
+  cnr_hardware_driver_interface::FlightRecorderHeader header;
+  std::string hw_name;
+  std::vector<std::string> joint_names;
+  std::vector<CycleRecord> records;
+  std::vector<double> joints;
+  EXPECT_TRUE(FlightRecorder::load("/tmp/test_hw.flight", header, hw_name, joint_names, records, joints, error));
+  EXPECT_EQ(hw_name, "test_hw");
+  EXPECT_EQ(joint_names.size(), 2u);
+  ASSERT_EQ(records.size(), 10u);
+  EXPECT_EQ(records.front().cycle, 15u);
+  EXPECT_EQ(records.back().cycle, 24u);
+  EXPECT_EQ(joints.at(0), 15.0);
+  EXPECT_EQ(joints.at(2), 1.0);
+  EXPECT_EQ(header.trigger_state, static_cast<int32_t>(cnr_hardware_interface::ERROR));
+
+  recorder.trigger(cnr_hardware_interface::ERROR);
+  for (size_t i = 0; i < 50 && recorder.lastDump().empty(); i++)
+  {
+    ros::WallDuration(0.02).sleep();
+  }
+  EXPECT_FALSE(recorder.lastDump().empty());
+}
+
+TEST(TestSuite, rtConfig)
+{
+  using cnr_hardware_driver_interface::ThreadRtConfig;
+  for (const ThreadRtConfig::Policy& policy : {ThreadRtConfig::OTHER, ThreadRtConfig::FIFO,
+                                               ThreadRtConfig::RR, ThreadRtConfig::DEADLINE})
+  {
+    ThreadRtConfig::Policy from_str;
+    EXPECT_TRUE(cnr_hardware_driver_interface::from_string(cnr_hardware_driver_interface::to_string(policy), from_str));
+    EXPECT_EQ(from_str, policy);
+  }
+  ThreadRtConfig::Policy policy;
+  EXPECT_FALSE(cnr_hardware_driver_interface::from_string("sched_fifo", policy));
+
+  // pin on a CPU the test is allowed to use (e.g., not CPU 0 in a restricted cgroup)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+  int cpu = -1;
+  for (int i = 0; i < CPU_SETSIZE && cpu < 0; i++)
+  {
+    cpu = CPU_ISSET(i, &allowed) ? i : -1;
+  }
+  if (cpu < 0)
+  {
+    GTEST_SKIP() << "No CPU in the affinity set of the test";
+  }
+
+  std::string error;
+  ThreadRtConfig config;
+  config.cpus = {cpu};
+  std::thread worker([&config, &error, cpu]
+  {
+    EXPECT_TRUE(cnr_hardware_driver_interface::apply_to_this_thread(config, error));
+    EXPECT_EQ(sched_getcpu(), cpu);
+    cnr_hardware_driver_interface::prefault_stack(64 * 1024);
+  });
+  worker.join();
+}
+
+//! CycleClock on a simulated time: doWait() jumps to the deadline, the test moves the time forward
+class ManualCycleClock : public cnr_hardware_driver_interface::CycleClock
+{
+public:
+  using CycleClock::CycleClock;
+  Type type() const override { return CLOCK_NANOSLEEP; }
+  void advance(const int64_t& ns) { m_now += ns; }
+protected:
+  uint64_t doWait(const struct timespec& deadline) override
+  {
+    m_now = std::max<int64_t>(m_now, static_cast<int64_t>(deadline.tv_sec) * 1000000000LL + deadline.tv_nsec);
+    return 1;
+  }
+  int64_t now() const override { return m_now; }
+private:
+  int64_t m_now = 1000000000LL;
+};
+
+TEST(TestSuite, overrunPolicy)
+{
+  using cnr_hardware_driver_interface::OverrunPolicy;
+  OverrunPolicy::Type type;
+  EXPECT_TRUE(cnr_hardware_driver_interface::from_string("degrade", type));
+  EXPECT_EQ(type, OverrunPolicy::DEGRADE);
+  EXPECT_FALSE(cnr_hardware_driver_interface::from_string("drop", type));
+
+  OverrunPolicy policy;
+  policy.type = OverrunPolicy::DEGRADE;
+  policy.degrade_after = 2;
+  policy.recover_after = 3;
+  policy.streak_limit = 4;
+  cnr::control::HwLoopStatus status;
+  cnr_hardware_driver_interface::OverrunMonitor monitor;
+  monitor.init(policy, &status);
+
+  EXPECT_FALSE(monitor.update(true));
+  EXPECT_TRUE(monitor.update(true));   // degraded
+  EXPECT_TRUE(status.degraded);
+  EXPECT_FALSE(monitor.update(true));
+  EXPECT_TRUE(monitor.update(true));   // alarm
+  EXPECT_TRUE(monitor.alarm());
+  EXPECT_EQ(status.overrun_streak, 4u);
+  EXPECT_FALSE(monitor.update(false));
+  EXPECT_FALSE(monitor.update(false));
+  EXPECT_TRUE(monitor.update(false));  // recovered
+  EXPECT_FALSE(status.degraded);
+  EXPECT_EQ(monitor.maxStreak(), 4u);
+  EXPECT_EQ(monitor.degradations(), 1u);
+  EXPECT_TRUE(monitor.alarm());        // latched
+  monitor.clearAlarm();
+  EXPECT_FALSE(monitor.alarm());
+
+  // skip: after a stall, the clock goes back on the grid instead of bursting
+  ManualCycleClock clock(1000000);
+  clock.setMaxBurst(0);
+  std::string error;
+  EXPECT_TRUE(clock.start(error));
+  EXPECT_EQ(clock.wait(), 0u);
+  clock.advance(5500000);
+  EXPECT_EQ(clock.wait(), 4u);
+  EXPECT_EQ(clock.wait(), 0u);
+  EXPECT_EQ(clock.stats().last_latency, 0);
+  EXPECT_EQ(clock.stats().missed_wakeups, 4u);
+}
+
+//! polls 'pred' until it holds or the deadline expires, so that a loaded machine does not break the test
+template<class Predicate>
+bool wait_until(Predicate pred, const double& timeout)
+{
+  const ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(timeout);
+  while (!pred() && ros::WallTime::now() < deadline)
+  {
+    ros::WallDuration(0.001).sleep();
+  }
+  return pred();
+}
+
+TEST(TestSuite, loopWatchdog)
+{
+  using cnr_hardware_driver_interface::LoopWatchdog;
+  std::atomic<int> stalls{0};
+  std::atomic<int> resumes{0};
+  std::string error;
+  LoopWatchdog watchdog;
+  // 10ms period, 20 missed periods: a stall is a silence of 200ms, much longer than the beats below
+  EXPECT_TRUE(watchdog.start(10000000, 20, cnr_hardware_driver_interface::ThreadRtConfig(),
+                             [&stalls](const int64_t&) { stalls++; },
+                             [&resumes](const int64_t&) { resumes++; }, error));
+  EXPECT_FALSE(watchdog.start(10000000, 20, cnr_hardware_driver_interface::ThreadRtConfig(),
+                              nullptr, nullptr, error));  // already running
+
+  for (int i = 0; i < 100; i++)
+  {
+    watchdog.beat();
+    ros::WallDuration(0.001).sleep();
+  }
+  EXPECT_FALSE(watchdog.stalled());
+  EXPECT_EQ(stalls, 0);
+
+  // the loop stops beating
+  EXPECT_TRUE(wait_until([&watchdog] { return watchdog.stalled(); }, 5.0));
+  EXPECT_EQ(stalls, 1);
+  EXPECT_GE(watchdog.maxSilence(), 200000000);
+
+  watchdog.beat();
+  EXPECT_TRUE(wait_until([&watchdog] { return !watchdog.stalled(); }, 5.0));
+  EXPECT_EQ(resumes, 1);
+  EXPECT_EQ(watchdog.stalls(), 1u);
+  watchdog.stop();
+  EXPECT_FALSE(watchdog.running());
+}
+
+TEST(TestSuite, lockstepClock)
+{
+  cnr_hardware_driver_interface::LockstepConfig config;
+  config.enabled = true;
+  config.publish_clock = false;
+  cnr_hardware_driver_interface::LockstepClock clock;
+  std::string error;
+  EXPECT_FALSE(clock.start(0, config, error));
+  EXPECT_TRUE(clock.start(1000000, config, error));
+
+  const ros::WallTime start = ros::WallTime::now();
+  ros::Time first;
+  ros::Time time;
+  EXPECT_TRUE(clock.tick(first));
+  bool ok = true;
+  for (int i = 0; i < 9999; i++)
+  {
+    ok &= clock.tick(time);
+  }
+  EXPECT_TRUE(ok);
+  EXPECT_EQ((time - first).toNSec(), 9999000000LL);  // 10s of simulated time, one nominal period per tick
+  // the time of the process is not touched: without '/use_sim_time', it is still the wall time
+  EXPECT_FALSE(ros::Time::isSimTime());
+  EXPECT_LT(ros::Time::now(), time);
+  EXPECT_LT((ros::WallTime::now() - start).toSec(), 10.0);
+  EXPECT_GT(clock.realTimeFactor(), 1.0);
+  EXPECT_EQ(clock.ticks(), 10000u);
+}
 
 // Run all the tests that were declared with TEST()
 int main(int argc, char **argv)
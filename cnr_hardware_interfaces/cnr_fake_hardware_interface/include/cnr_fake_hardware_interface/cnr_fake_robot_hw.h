@@ -35,6 +35,7 @@
 #ifndef CNR_HARDWARE_INTERFACE_CNR_FAKE_ROBOT_HW
 #define CNR_HARDWARE_INTERFACE_CNR_FAKE_ROBOT_HW
 
+#include <array>
 #include <mutex>
 
 #include <cnr_hardware_interface/cnr_robot_hw.h>
@@ -47,23 +48,39 @@
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/WrenchStamped.h>
 #include <trajectory_msgs/JointTrajectoryPoint.h>
+#include <cnr_controller_interface_params/realtime_buffers.h>
+#include <cnr_controller_interface_params/cycle_context.h>
+#include <cnr_controller_interface_params/pipelined_hw.h>
 
 namespace cnr_hardware_interface
 {
 
-class FakeRobotHW: public cnr_hardware_interface::RobotHW
+//! No physical I/O: the driver can run it in lockstep with a simulated clock ('/<hw_name>/lockstep/enabled'),
+//! and pipelined ('/<hw_name>/pipeline')
+class FakeRobotHW: public cnr_hardware_interface::RobotHW, public cnr::control::SimulatedHw,
+                   public cnr::control::PipelinedHw, public cnr::control::CycleAwareHw
 {
 public:
   FakeRobotHW();
   ~FakeRobotHW();
 
   virtual bool doInit();
+  virtual bool doRead(const ros::Time& time, const ros::Duration& period);
   virtual bool doWrite(const ros::Time& time, const ros::Duration& period);
 
   virtual bool doPrepareSwitch(const std::list< hardware_interface::ControllerInfo >& start, 
                                const std::list< hardware_interface::ControllerInfo >& stop);
   virtual bool doCheckForConflict(const std::list<hardware_interface::ControllerInfo>& info);
 
+  bool enablePipeline(const bool& enable) override;
+  void exchangeBuffers() override;
+
+  void readCycle(const cnr::control::CycleContext& ctx) override;
+  void writeCycle(const cnr::control::CycleContext& ctx) override;
+
+  //! Context of the last readCycle()/writeCycle(): to be accessed from the thread of the I/O, or with the loop stopped
+  const cnr::control::CycleContext& lastCycle() const { return m_cycle; }
+
 protected:
   sensor_msgs::JointState* m_msg;
   void initialJointStateCallback(const sensor_msgs::JointState::ConstPtr& msg);
@@ -90,7 +107,27 @@ protected:
   std::vector<double> m_cmd_vel;   //target velocity
   std::vector<double> m_cmd_eff;   //target effort
 
+  //! Memory of the simulation in doRead() and doWrite(). Without the pipeline, it is copied from/to the handles
+  //! in doRead()/doWrite(), otherwise in exchangeBuffers()
+  std::vector<double> m_io_pos;
+  std::vector<double> m_io_vel;
+  std::vector<double> m_io_eff;
+  std::vector<double> m_io_ft_sensor;
+  std::vector<double> m_io_cmd_pos;
+  std::vector<double> m_io_cmd_vel;
+  std::vector<double> m_io_cmd_eff;
+  bool m_io_p_active;
+  bool m_io_v_active;
+  bool m_io_e_active;
+
+  bool m_pipelined;
+  cnr::control::CycleContext m_cycle;
+
+  void copyState();     //! I/O -> handles
+  void copyCommands();  //! handles -> I/O
+
   ros::Subscriber m_wrench_sub;
+  cnr::control::TripleBuffer<std::array<double, 6>> m_wrench;  // from wrenchCb() to doRead()
   std::string m_frame_id;
 
 
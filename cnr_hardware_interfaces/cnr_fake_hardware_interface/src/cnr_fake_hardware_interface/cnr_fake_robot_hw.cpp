@@ -32,6 +32,7 @@
  *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  *  POSSIBILITY OF SUCH DAMAGE.
  */
+#include <algorithm>
 #include <pluginlib/class_list_macros.h>
 
 
@@ -59,7 +60,7 @@ void setParam(FakeRobotHW* hw, const std::string& ns)
 }
 
 FakeRobotHW::FakeRobotHW()
-  : m_msg(nullptr)
+  : m_msg(nullptr), m_io_p_active(false), m_io_v_active(false), m_io_e_active(false), m_pipelined(false)
 {
   m_set_status_param = boost::bind(setParam, this, _1);
 }
@@ -85,12 +86,14 @@ void FakeRobotHW::wrenchCb(const geometry_msgs::WrenchStamped::ConstPtr &msg)
     CNR_WARN_THROTTLE(m_logger,1,"wrench has wrong frame_id. expected = "<<m_frame_id<<", received = "<<msg->header.frame_id);
     return;
   }
-  m_ft_sensor.at(0)=msg->wrench.force.x;
-  m_ft_sensor.at(1)=msg->wrench.force.y;
-  m_ft_sensor.at(2)=msg->wrench.force.z;
-  m_ft_sensor.at(3)=msg->wrench.torque.x;
-  m_ft_sensor.at(4)=msg->wrench.torque.y;
-  m_ft_sensor.at(5)=msg->wrench.torque.z;
+  std::array<double, 6>& wrench = m_wrench.writeBuffer();
+  wrench.at(0)=msg->wrench.force.x;
+  wrench.at(1)=msg->wrench.force.y;
+  wrench.at(2)=msg->wrench.force.z;
+  wrench.at(3)=msg->wrench.torque.x;
+  wrench.at(4)=msg->wrench.torque.y;
+  wrench.at(5)=msg->wrench.torque.z;
+  m_wrench.publish();
 
   CNR_TRACE_THROTTLE(m_logger,10,"received a wrench");
 }
@@ -110,6 +113,7 @@ bool FakeRobotHW::doInit()
 
   m_ft_sensor.resize(6);
   std::fill(m_ft_sensor.begin(), m_ft_sensor.end(), 0.0);
+  m_wrench.reset(std::array<double, 6>{});
 
   if (m_robothw_nh.hasParam("initial_position"))
   {
@@ -209,52 +213,69 @@ bool FakeRobotHW::doInit()
 
   m_p_jh_active = m_v_jh_active = m_e_jh_active = false;
 
+  m_io_pos = m_pos;
+  m_io_vel = m_vel;
+  m_io_eff = m_eff;
+  m_io_ft_sensor = m_ft_sensor;
+  m_io_cmd_pos = m_cmd_pos;
+  m_io_cmd_vel = m_cmd_vel;
+  m_io_cmd_eff = m_cmd_eff;
+  m_io_p_active = m_io_v_active = m_io_e_active = false;
+
   doRead(ros::Time::now(),ros::Duration(m_sampling_period));
 
   CNR_RETURN_TRUE(m_logger);
 }
 
+bool FakeRobotHW::doRead(const ros::Time& /*time*/, const ros::Duration& /*period*/)
+{
+  if (m_wrench.update())
+  {
+    std::copy(m_wrench.readBuffer().begin(), m_wrench.readBuffer().end(), m_io_ft_sensor.begin());
+  }
+  if (!m_pipelined)
+  {
+    copyState();
+  }
+  return true;
+}
+
 bool FakeRobotHW::doWrite(const ros::Time& /*time*/, const ros::Duration& period)
 {
   CNR_TRACE_START_THROTTLE_DEFAULT(m_logger);
-  if(m_p_jh_active)
+  if (!m_pipelined)
+  {
+    copyCommands();
+  }
+  if(m_io_p_active)
   {
-    m_pos = m_cmd_pos;
+    std::copy(m_io_cmd_pos.begin(), m_io_cmd_pos.end(), m_io_pos.begin());
   }
 
-  if (m_v_jh_active)
+  if (m_io_v_active)
   {
-    m_vel = m_cmd_vel;
-    if(!m_p_jh_active)
+    std::copy(m_io_cmd_vel.begin(), m_io_cmd_vel.end(), m_io_vel.begin());
+    if(!m_io_p_active)
     {
       for(size_t iAx=0; iAx<resourceNumber(); iAx++)
       {
-        m_pos.at(iAx) = m_pos.at(iAx) + m_cmd_vel.at(iAx) * period.toSec();
+        m_io_pos.at(iAx) = m_io_pos.at(iAx) + m_io_cmd_vel.at(iAx) * period.toSec();
       }
     }
   }
   else
   {
-    m_vel.resize(resourceNumber());
-    std::fill(m_vel.begin(), m_vel.end(), 0.0);
+    std::fill(m_io_vel.begin(), m_io_vel.end(), 0.0);
   }
 
-  if (m_e_jh_active)
+  if (m_io_e_active)
   {
-    m_eff = m_cmd_eff;
+    std::copy(m_io_cmd_eff.begin(), m_io_cmd_eff.end(), m_io_eff.begin());
   }
   else
   {
-    m_eff.resize(resourceNumber());
-    std::fill(m_eff.begin(), m_eff.end(), 0.0);
+    std::fill(m_io_eff.begin(), m_io_eff.end(), 0.0);
   }
-  std::string str = "a:";
-  for (int i = 0;i<m_pos.size();i++) str += std::to_string(m_pos[i]) + " ";
-  str += ",b:";
-  for (int i = 0;i<m_vel.size();i++) str += std::to_string(m_vel[i]) + " ";
-  // ROS_INFO_STREAM(str);
-  // ROS_INFO_STREAM("p:"<<m_pos[0]<<","<<m_pos[1]<<","<<m_pos[2]<<","<<m_pos[3]<<","<<m_pos[4]<<","<<m_pos[5]);
-  // ROS_INFO_STREAM("v:"<<m_vel[0]<<","<<m_vel[1]<<","<<m_vel[2]<<","<<m_vel[3]<<","<<m_vel[4]<<","<<m_vel[5]);
   CNR_RETURN_TRUE_THROTTLE_DEFAULT(m_logger);
 }
 
@@ -332,6 +353,48 @@ bool FakeRobotHW::doPrepareSwitch(const std::list< hardware_interface::Controlle
 
 }
 
+bool FakeRobotHW::enablePipeline(const bool& enable)
+{
+  m_pipelined = enable;
+  return true;
+}
+
+void FakeRobotHW::exchangeBuffers()
+{
+  copyState();
+  copyCommands();
+}
+
+void FakeRobotHW::readCycle(const cnr::control::CycleContext& ctx)
+{
+  m_cycle = ctx;
+  read(ctx.time, ctx.period);
+}
+
+void FakeRobotHW::writeCycle(const cnr::control::CycleContext& ctx)
+{
+  m_cycle = ctx;
+  write(ctx.time, ctx.period);
+}
+
+void FakeRobotHW::copyState()
+{
+  std::copy(m_io_pos.begin(), m_io_pos.end(), m_pos.begin());
+  std::copy(m_io_vel.begin(), m_io_vel.end(), m_vel.begin());
+  std::copy(m_io_eff.begin(), m_io_eff.end(), m_eff.begin());
+  std::copy(m_io_ft_sensor.begin(), m_io_ft_sensor.end(), m_ft_sensor.begin());
+}
+
+void FakeRobotHW::copyCommands()
+{
+  std::copy(m_cmd_pos.begin(), m_cmd_pos.end(), m_io_cmd_pos.begin());
+  std::copy(m_cmd_vel.begin(), m_cmd_vel.end(), m_io_cmd_vel.begin());
+  std::copy(m_cmd_eff.begin(), m_cmd_eff.end(), m_io_cmd_eff.begin());
+  m_io_p_active = m_p_jh_active;
+  m_io_v_active = m_v_jh_active;
+  m_io_e_active = m_e_jh_active;
+}
+
 bool FakeRobotHW::doCheckForConflict(const std::list< hardware_interface::ControllerInfo >& info)
 {
   std::stringstream report;
@@ -76,6 +76,84 @@ TEST(TestSuite, Handles)
   std::cout << "PosVelEffJointInterface :" << to_string(robot_hw->get<hardware_interface::PosVelEffJointInterface >()->getNames()) << std::endl;
   std::cout << "VelEffJointInterface    :" << to_string(robot_hw->get<hardware_interface::VelEffJointInterface    >()->getNames()) << std::endl;
 }
+//! pipelined cycle of the driver: exchangeBuffers(), then write()/read() in the I/O thread while the update runs
+TEST(TestSuite, Pipeline)
+{
+  cnr::control::PipelinedHw* pipelined = dynamic_cast<cnr::control::PipelinedHw*>(robot_hw.get());
+  ASSERT_TRUE(pipelined != nullptr);
+
+  hardware_interface::PositionJointInterface* pji = robot_hw->get<hardware_interface::PositionJointInterface>();
+  ASSERT_TRUE(pji != nullptr);
+  hardware_interface::InterfaceResources resources;
+  resources.hardware_interface = "hardware_interface::PositionJointInterface";
+  resources.resources.insert(pji->getNames().begin(), pji->getNames().end());
+  hardware_interface::ControllerInfo info;
+  info.claimed_resources.push_back(resources);
+  EXPECT_TRUE(robot_hw->doPrepareSwitch({info}, {}));
+
+  hardware_interface::JointHandle jh = pji->getHandle(pji->getNames().front());
+  const ros::Duration period(0.001);
+  auto io = [&]()
+  {
+    EXPECT_TRUE(robot_hw->doWrite(ros::Time(0), period));
+    EXPECT_TRUE(robot_hw->doRead(ros::Time(0), period));
+  };
+
+  EXPECT_TRUE(pipelined->enablePipeline(true));
+  pipelined->exchangeBuffers();
+  const double q0 = jh.getPosition();
+
+  // cycle 1: the update sets the command, the I/O does not touch the handles
+  jh.setCommand(q0 + 0.1);
+  io();
+  EXPECT_DOUBLE_EQ(jh.getPosition(), q0);
+
+  // cycle 2: the command is handed to the I/O, the position read is still in the I/O memory
+  pipelined->exchangeBuffers();
+  EXPECT_DOUBLE_EQ(jh.getPosition(), q0);
+  io();
+  EXPECT_DOUBLE_EQ(jh.getPosition(), q0);
+
+  // cycle 3: the update sees the effect of the command of cycle 1 (one cycle more than the sequential mode)
+  pipelined->exchangeBuffers();
+  EXPECT_DOUBLE_EQ(jh.getPosition(), q0 + 0.1);
+
+  // sequential: the command is applied by write() and read back by the next read()
+  EXPECT_TRUE(pipelined->enablePipeline(false));
+  jh.setCommand(q0 + 0.2);
+  io();
+  EXPECT_DOUBLE_EQ(jh.getPosition(), q0 + 0.2);
+
+  EXPECT_TRUE(robot_hw->doPrepareSwitch({}, {info}));
+}
+
+//! the driver calls readCycle()/writeCycle() in place of read()/write(): the context must reach the hw
+TEST(TestSuite, CycleContext)
+{
+  cnr::control::CycleAwareHw* cycle_hw = dynamic_cast<cnr::control::CycleAwareHw*>(robot_hw.get());
+  ASSERT_TRUE(cycle_hw != nullptr);
+
+  cnr::control::CycleContext ctx;
+  ctx.cycle    = 42;
+  ctx.stamp    = 1000000000;
+  ctx.deadline = ctx.stamp + 2000000;
+  ctx.dt       = 2000000;
+  ctx.time     = ros::Time(10.0);
+  ctx.period   = ros::Duration(0.002);
+
+  cycle_hw->writeCycle(ctx);
+  EXPECT_EQ(robot_hw->lastCycle().cycle, 42u);
+  EXPECT_EQ(robot_hw->lastCycle().deadline, ctx.deadline);
+
+  ctx.cycle    = 43;
+  ctx.deadline += ctx.dt;
+  cycle_hw->readCycle(ctx);
+  EXPECT_EQ(robot_hw->lastCycle().cycle, 43u);
+  EXPECT_EQ(robot_hw->lastCycle().deadline, ctx.deadline);
+  EXPECT_EQ(robot_hw->lastCycle().time, ctx.time);
+  EXPECT_EQ(robot_hw->lastCycle().period, ctx.period);
+}
+
 TEST(TestSuite, Desctructor)
 {
   EXPECT_NO_FATAL_FAILURE(robot_hw.reset());
@@ -43,6 +43,8 @@
 #include <geometry_msgs/PoseStamped.h>
 #include <trajectory_msgs/JointTrajectoryPoint.h>
 #include <name_sorting/name_sorting.h>
+#include <cnr_controller_interface_params/realtime_buffers.h>
+#include <cnr_controller_interface_params/pipelined_hw.h>
 #include <mutex>
 // namespace hardware_interface
 // {
@@ -55,7 +57,7 @@
 namespace cnr_hardware_interface
 {
 
-class TopicRobotHW: public cnr_hardware_interface::RobotHW
+class TopicRobotHW: public cnr_hardware_interface::RobotHW, public cnr::control::PipelinedHw
 {
 public:
   TopicRobotHW();
@@ -67,6 +69,9 @@ public:
   virtual bool doWrite(const ros::Time& time, const ros::Duration& period);
   virtual bool doPrepareSwitch(const std::list< hardware_interface::ControllerInfo >& start_list, const std::list< hardware_interface::ControllerInfo >& stop_list);
 
+  bool enablePipeline(const bool& enable) override;
+  void exchangeBuffers() override;
+
 protected:
   virtual void jointStateCallback(const sensor_msgs::JointStateConstPtr& msg);
 
@@ -89,10 +94,36 @@ protected:
   std::vector<double> m_vel; // feedback velocity
   std::vector<double> m_eff; // feedback effort
 
+  //! The callback runs in the non-RT spinner of the driver, the feedback is handed to doRead() without locks
+  struct Feedback
+  {
+    std::vector<double> pos;
+    std::vector<double> vel;
+    std::vector<double> eff;
+  };
+  cnr::control::TripleBuffer<Feedback> m_feedback;
+
   std::vector<double> m_cmd_pos; //target position
   std::vector<double> m_cmd_vel; //target velocity
   std::vector<double> m_cmd_eff; //target effort
 
+  //! Memory used by doRead() and doWrite(). Without the pipeline, it is copied from/to the handles in doRead()/doWrite(),
+  //! otherwise in exchangeBuffers()
+  std::vector<double> m_io_pos;
+  std::vector<double> m_io_vel;
+  std::vector<double> m_io_eff;
+  std::vector<double> m_io_cmd_pos;
+  std::vector<double> m_io_cmd_vel;
+  std::vector<double> m_io_cmd_eff;
+  bool m_io_p_active;
+  bool m_io_v_active;
+  bool m_io_e_active;
+  bool m_init_commands;  //! the first feedback initializes the commands of the handles
+  bool m_pipelined;
+
+  void copyState();     //! I/O -> handles
+  void copyCommands();  //! handles -> I/O
+
   unsigned int  m_warmup;
   unsigned int  m_missing_messages;
   unsigned int  m_max_missing_messages;
@@ -34,6 +34,7 @@
  */
 #include <sstream>
 #include <mutex>
+#include <algorithm>
 #include <cnr_hardware_interface/internal/vector_to_string.h>
 #include <cnr_topic_hardware_interface/cnr_topic_robot_hw.h>
 
@@ -58,6 +59,7 @@ void setParam(TopicRobotHW* hw, const std::string& ns)
 }
 
 TopicRobotHW::TopicRobotHW()
+  : m_io_p_active(false), m_io_v_active(false), m_io_e_active(false), m_init_commands(false), m_pipelined(false)
 {
   m_set_status_param = boost::bind(setParam, this, _1);
 }
@@ -114,6 +116,7 @@ bool TopicRobotHW::doInit()
 
   m_topic_received = false;
   m_first_topic_received = false;
+  m_feedback.reset(Feedback{m_pos, m_vel, m_eff});
 
   m_js_sub = m_robothw_nh.subscribe<sensor_msgs::JointState>(read_js_topic,
                                                              1,
@@ -139,6 +142,15 @@ bool TopicRobotHW::doInit()
   m_cmd_vel = m_vel;
   m_cmd_pos = m_eff;
 
+  m_io_pos = m_pos;
+  m_io_vel = m_vel;
+  m_io_eff = m_eff;
+  m_io_cmd_pos = m_cmd_pos;
+  m_io_cmd_vel = m_cmd_vel;
+  m_io_cmd_eff = m_cmd_eff;
+  m_io_p_active = m_io_v_active = m_io_e_active = false;
+  m_init_commands = false;
+
   for (const std::string& joint_name : resourceNames())
   {
     auto i = &joint_name - &resourceNames()[0];
@@ -193,37 +205,47 @@ void TopicRobotHW::jointStateCallback(const sensor_msgs::JointStateConstPtr& msg
     s += "Mismatch in msg size: p:" + std::to_string((int)(pos.size())) + ", v:"  + std::to_string((int)(vel.size()))
       + ", e:"  + std::to_string((int)(eff.size())) + ", names:" + std::to_string((int)(resourceNumber()));
     CNR_ERROR_THROTTLE(m_logger, 5.0, s);
-    m_topic_received = false;
     return;
   }
 
 
   if (!name_sorting::permutationName(resourceNames(), names, pos, vel, eff, &report))
   {
-    m_topic_received = false;
     CNR_WARN_THROTTLE(m_logger, 0.1, m_robot_name << "Feedback joint states names are wrong! "<< report.str() );
     return;
   }
-  m_topic_received = true;
 
-  for (unsigned int idx = 0; idx < resourceNumber(); idx++)
-  {
-    m_pos.at(idx) = pos.at(idx);
-    m_vel.at(idx) = vel.at(idx);
-    m_eff.at(idx) = eff.at(idx);
-  }
-  if(!m_first_topic_received)
-  {
-    m_first_topic_received = true;
-    m_cmd_pos = m_pos;
-    m_cmd_vel = m_vel;
-    m_cmd_eff = m_eff;
-  }
+  Feedback& feedback = m_feedback.writeBuffer();
+  std::copy(pos.begin(), pos.begin() + resourceNumber(), feedback.pos.begin());
+  std::copy(vel.begin(), vel.begin() + resourceNumber(), feedback.vel.begin());
+  std::copy(eff.begin(), eff.begin() + resourceNumber(), feedback.eff.begin());
+  m_feedback.publish();
 }
 
 bool TopicRobotHW::doRead(const ros::Time& time, const ros::Duration& /*period*/)
 {
   std::stringstream report;
+  m_topic_received = m_feedback.update();
+  if (m_topic_received)
+  {
+    const Feedback& feedback = m_feedback.readBuffer();
+    std::copy(feedback.pos.begin(), feedback.pos.end(), m_io_pos.begin());
+    std::copy(feedback.vel.begin(), feedback.vel.end(), m_io_vel.begin());
+    std::copy(feedback.eff.begin(), feedback.eff.end(), m_io_eff.begin());
+    if (!m_first_topic_received)
+    {
+      m_first_topic_received = true;
+      std::copy(m_io_pos.begin(), m_io_pos.end(), m_io_cmd_pos.begin());
+      std::copy(m_io_vel.begin(), m_io_vel.end(), m_io_cmd_vel.begin());
+      std::copy(m_io_eff.begin(), m_io_eff.end(), m_io_cmd_eff.begin());
+      m_init_commands = true;
+    }
+  }
+  if (!m_pipelined)
+  {
+    copyState();
+  }
+
   if ((!m_topic_received) && ((time - m_start_time).toSec() > 0.1))
   {
     m_missing_messages++;
@@ -253,21 +275,25 @@ bool TopicRobotHW::doRead(const ros::Time& time, const ros::Duration& /*period*/
 bool TopicRobotHW::doWrite(const ros::Time& /*time*/, const ros::Duration& /*period*/)
 {
   CNR_TRACE_START_THROTTLE_DEFAULT(m_logger);
-  if (!m_p_jh_active && !m_v_jh_active && !m_e_jh_active)
+  if (!m_pipelined)
+  {
+    copyCommands();
+  }
+  if (!m_io_p_active && !m_io_v_active && !m_io_e_active)
   {
     CNR_RETURN_TRUE_THROTTLE(m_logger, 5.0);
   }
 
   if(m_first_topic_received)
   {
-    if(m_p_jh_active)
+    if(m_io_p_active)
     {
-      m_msg->position = m_cmd_pos;
+      m_msg->position = m_io_cmd_pos;
     }
 
-    if(m_v_jh_active)
+    if(m_io_v_active)
     {
-      m_msg->velocity = m_cmd_vel;
+      m_msg->velocity = m_io_cmd_vel;
     }
     else
     {
@@ -275,9 +301,9 @@ bool TopicRobotHW::doWrite(const ros::Time& /*time*/, const ros::Duration& /*per
       std::fill(m_msg->velocity.begin(), m_msg->velocity.end(), 0.0);
     }
 
-    if (m_e_jh_active)
+    if (m_io_e_active)
     {
-      m_msg->effort   = m_cmd_eff;
+      m_msg->effort   = m_io_cmd_eff;
     }
     else
     {
@@ -359,6 +385,42 @@ bool TopicRobotHW::doPrepareSwitch(const std::list< hardware_interface::Controll
   CNR_RETURN_TRUE(m_logger);
 }
 
+bool TopicRobotHW::enablePipeline(const bool& enable)
+{
+  m_pipelined = enable;
+  return true;
+}
+
+void TopicRobotHW::exchangeBuffers()
+{
+  copyState();
+  copyCommands();
+}
+
+void TopicRobotHW::copyState()
+{
+  std::copy(m_io_pos.begin(), m_io_pos.end(), m_pos.begin());
+  std::copy(m_io_vel.begin(), m_io_vel.end(), m_vel.begin());
+  std::copy(m_io_eff.begin(), m_io_eff.end(), m_eff.begin());
+  if (m_init_commands)
+  {
+    m_init_commands = false;
+    std::copy(m_pos.begin(), m_pos.end(), m_cmd_pos.begin());
+    std::copy(m_vel.begin(), m_vel.end(), m_cmd_vel.begin());
+    std::copy(m_eff.begin(), m_eff.end(), m_cmd_eff.begin());
+  }
+}
+
+void TopicRobotHW::copyCommands()
+{
+  std::copy(m_cmd_pos.begin(), m_cmd_pos.end(), m_io_cmd_pos.begin());
+  std::copy(m_cmd_vel.begin(), m_cmd_vel.end(), m_io_cmd_vel.begin());
+  std::copy(m_cmd_eff.begin(), m_cmd_eff.end(), m_io_cmd_eff.begin());
+  m_io_p_active = m_p_jh_active;
+  m_io_v_active = m_v_jh_active;
+  m_io_e_active = m_e_jh_active;
+}
+
 bool TopicRobotHW::doShutdown()
 {
   if (!m_shutted_down)